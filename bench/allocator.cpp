@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/allocator.hpp"
+#include "../include/vector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// An elementwise pipeline d = (a + b) * c - a / b whose three temporaries are
+// allocated and freed on every pass, as in a typical loss evaluation.
+template <typename V> static auto pipeline(benchmark::State &state) -> void {
+  using ad::operator+;
+  using ad::operator-;
+  using ad::operator*;
+  using ad::operator/;
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const V a(n, 1.5);
+  const V b(n, 2.5);
+  const V c(n, 0.5);
+  for (auto _ : state) {
+    const V d = (a + b) * c - a / b;
+    benchmark::DoNotOptimize(d.data());
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * n *
+                                                    sizeof(double) * 4));
+}
+
+static void BM_StdAllocator(benchmark::State &state) {
+  pipeline<std::vector<double>>(state);
+}
+BENCHMARK(BM_StdAllocator)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+static void BM_PoolAllocator(benchmark::State &state) {
+  ad::BufferPool::huge_pages(false);
+  pipeline<ad::pooled_vector<double>>(state);
+}
+BENCHMARK(BM_PoolAllocator)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+static void BM_PoolAllocatorHugePages(benchmark::State &state) {
+  ad::BufferPool::local()->release();
+  ad::BufferPool::huge_pages(true);
+  pipeline<ad::pooled_vector<double>>(state);
+  ad::BufferPool::huge_pages(false);
+}
+BENCHMARK(BM_PoolAllocatorHugePages)->Arg(1 << 18)->Arg(1 << 20);
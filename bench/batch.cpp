@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/batchtape.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/tape.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// A minibatch of samples of a small regression model: every sample has its
+// own data (x, y) and shares the parameters w.
+constexpr std::size_t parameters = 8;
+constexpr std::size_t batch = 256;
+
+static auto sample_loss(const std::vector<ad::RSym<double>> &w,
+                        const ad::RSym<double> &x, const ad::RSym<double> &y)
+    -> ad::RSym<double> {
+  ad::RSym<double> p = w[0];
+  for (std::size_t k = 1; k < parameters; ++k) {
+    p = p * x + w[k];
+  }
+  return pow(tanh(p) - y, 2.0);
+}
+
+static auto data(std::size_t i) -> std::pair<double, double> {
+  const double x = 0.01 * static_cast<double>(i % 100);
+  return {x, x * x - 0.5};
+}
+
+static void BM_PerSampleGradient(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w(parameters, ad::RSym<double>{0.1});
+  for (auto _ : state) {
+    std::vector<double> total(parameters, 0.0);
+    for (std::size_t i = 0; i < batch; ++i) {
+      const auto [x, y] = data(i);
+      const auto df = ad::gradient(sample_loss(w, x, y), w);
+      for (std::size_t k = 0; k < parameters; ++k) {
+        total[k] += df[k];
+      }
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_PerSampleGradient);
+
+static auto record() -> ad::Tape<double> {
+  std::vector<ad::RSym<double>> v(parameters, ad::RSym<double>{0.1});
+  const ad::RSym<double> x{0.0};
+  const ad::RSym<double> y{0.0};
+  const auto c = sample_loss(v, x, y);
+  v.push_back(x);
+  v.push_back(y);
+  auto tape = ad::Tape<double>::record(c, v);
+  tape.optimize();
+  return tape;
+}
+
+static void BM_PerSampleTape(benchmark::State &state) {
+  auto tape = record();
+  std::vector<double> inputs(parameters + 2, 0.1);
+  for (auto _ : state) {
+    std::vector<double> total(parameters, 0.0);
+    for (std::size_t i = 0; i < batch; ++i) {
+      std::tie(inputs[parameters], inputs[parameters + 1]) = data(i);
+      const auto df = tape.gradient(inputs);
+      for (std::size_t k = 0; k < parameters; ++k) {
+        total[k] += df[k];
+      }
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_PerSampleTape);
+
+template <std::size_t B> static void BM_BatchTape(benchmark::State &state) {
+  ad::BatchTape<double, B> tape{record()};
+  for (std::size_t k = 0; k < parameters; ++k) {
+    tape.broadcast(k, 0.1);
+  }
+  for (auto _ : state) {
+    std::vector<double> total(parameters, 0.0);
+    for (std::size_t i = 0; i < batch; i += B) {
+      for (std::size_t l = 0; l < B; ++l) {
+        const auto [x, y] = data(i + l);
+        tape.set(parameters, l, x);
+        tape.set(parameters + 1, l, y);
+      }
+      tape.forward();
+      tape.backward();
+      const auto df = tape.gradient_sum();
+      for (std::size_t k = 0; k < parameters; ++k) {
+        total[k] += df[k];
+      }
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK_TEMPLATE(BM_BatchTape, 4);
+BENCHMARK_TEMPLATE(BM_BatchTape, 8);
+BENCHMARK_TEMPLATE(BM_BatchTape, 16);
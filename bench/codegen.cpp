@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+
+#include "loss_kernel.hpp"
+#include "recorders/loss.hpp"
+
+#include <vector>
+
+static void BM_CodegenGradient(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.3, 0.7};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::gradient(loss(w), w));
+  }
+}
+BENCHMARK(BM_CodegenGradient);
+
+static void BM_CodegenTapeReplay(benchmark::State &state) {
+  auto tape = record_loss();
+  tape.optimize();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+}
+BENCHMARK(BM_CodegenTapeReplay);
+
+static void BM_CodegenKernel(benchmark::State &state) {
+  const double w[2]{0.3, 0.7};
+  double gradient[2]{};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(loss_kernel(w, gradient));
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_CodegenKernel);
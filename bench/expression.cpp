@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/expression.hpp"
+#include "../include/forwardops.hpp"
+#include "../include/fsymbol.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+
+#include <vector>
+
+// gradient of f(x, y) = x sin(x) + y^2 at 1000 points
+
+static void BM_ExpressionGradient(benchmark::State &state) {
+  using namespace ad::expr;
+  using namespace ad::expr::literals;
+  constexpr auto f = X * sin(X) + pow(Y, 2_c);
+  constexpr auto dfdx = d<X>(f);
+  constexpr auto dfdy = d<Y>(f);
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (int i = 0; i < 1000; ++i) {
+      const double x = 0.001 * i;
+      sum += dfdx(x, 1.0 - x) + dfdy(x, 1.0 - x);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK(BM_ExpressionGradient);
+
+static void BM_ForwardGradient(benchmark::State &state) {
+  const auto f = [](const ad::FSym<double> &x, const ad::FSym<double> &y) {
+    return x * sin(x) + pow(y, 2.0);
+  };
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (int i = 0; i < 1000; ++i) {
+      const double x = 0.001 * i;
+      sum += f({x, 1.0}, {1.0 - x}).dot() + f({x}, {1.0 - x, 1.0}).dot();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK(BM_ForwardGradient);
+
+static void BM_ReverseGradient(benchmark::State &state) {
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (int i = 0; i < 1000; ++i) {
+      const double x = 0.001 * i;
+      const std::vector<ad::RSym<double>> w{x, 1.0 - x};
+      const auto df = ad::gradient(w[0] * sin(w[0]) + pow(w[1], 2.0), w);
+      sum += df[0] + df[1];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK(BM_ReverseGradient);
+
+// a rational expression and its second derivative, folded by the compiler
+static void BM_ExpressionConstexpr(benchmark::State &state) {
+  using namespace ad::expr;
+  using namespace ad::expr::literals;
+  constexpr auto p = (X * X * X + 3_c * X) / (X * X + 1_c);
+  constexpr double value = d<X>(d<X>(p))(2.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(value);
+  }
+  state.counters["d2p(2)"] = value;
+}
+BENCHMARK(BM_ExpressionConstexpr);
@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+
+#include <vector>
+
+// Mimics generated model code that recomputes the same activation of a few
+// parameters in every term of the loss.
+static auto loss(const std::vector<ad::RSym<double>> &w, std::size_t terms)
+    -> ad::RSym<double> {
+  std::vector<ad::RSym<double>> residuals{};
+  residuals.reserve(terms);
+  for (std::size_t i = 0; i < terms; ++i) {
+    const auto &a = w[i % w.size()];
+    const auto &b = w[(i + 1) % w.size()];
+    residuals.push_back(tanh(a * b) + exp(a) * sin(b));
+  }
+  return ad::sum(residuals);
+}
+
+static void BM_Plain(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7};
+  for (auto _ : state) {
+    const auto c = loss(w, state.range(0));
+    benchmark::DoNotOptimize(ad::gradient(c, w));
+  }
+}
+BENCHMARK(BM_Plain)->RangeMultiplier(10)->Range(1000, 100000);
+
+static void BM_HashCons(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7};
+  for (auto _ : state) {
+    ad::HashCons<double> scope{};
+    const auto c = loss(w, state.range(0));
+    benchmark::DoNotOptimize(ad::gradient(c, w));
+    state.counters["hit_rate"] = scope.stats().hit_rate();
+  }
+}
+BENCHMARK(BM_HashCons)->RangeMultiplier(10)->Range(1000, 100000);
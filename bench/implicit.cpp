@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/implicit.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// A contraction x = g(x, p) on n unknowns coupled to their neighbour, solved
+// by fixed point iteration.
+constexpr std::size_t unknowns = 16;
+
+template <typename S>
+static auto g(const std::vector<S> &x, const std::vector<S> &p)
+    -> std::vector<S> {
+  std::vector<S> result{};
+  result.reserve(x.size());
+  const S half{0.5};
+  const S tenth{0.1};
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    result.push_back(half * cos(x[i] + p[i]) + tenth * x[(i + 1) % x.size()]);
+  }
+  return result;
+}
+
+static auto loss(const std::vector<ad::RSym<double>> &x) -> ad::RSym<double> {
+  return ad::sum(x);
+}
+
+static void BM_UnrolledIterations(benchmark::State &state) {
+  const auto iterations = static_cast<std::size_t>(state.range(0));
+  std::size_t edges = 0;
+  for (auto _ : state) {
+    const std::vector<ad::RSym<double>> p(unknowns, ad::RSym<double>{0.3});
+    std::vector<ad::RSym<double>> x(unknowns, ad::RSym<double>{0.0});
+    for (std::size_t k = 0; k < iterations; ++k) {
+      x = g(x, p);
+    }
+    const auto y = loss(x);
+    edges = ad::topological_order(y).operands.size();
+    benchmark::DoNotOptimize(ad::gradient(y, p));
+  }
+  state.counters["edges"] = static_cast<double>(edges);
+}
+BENCHMARK(BM_UnrolledIterations)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_ImplicitSolution(benchmark::State &state) {
+  const auto iterations = static_cast<std::size_t>(state.range(0));
+  const auto F = [](const auto &x, const auto &p) {
+    const auto next = g(x, p);
+    auto residual = x;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      residual[i] = x[i] - next[i];
+    }
+    return residual;
+  };
+  std::size_t edges = 0;
+  for (auto _ : state) {
+    const std::vector<ad::RSym<double>> p(unknowns, ad::RSym<double>{0.3});
+    std::vector<double> x(unknowns, 0.0);
+    const std::vector<double> values(unknowns, 0.3);
+    for (std::size_t k = 0; k < iterations; ++k) {
+      x = g(x, values);
+    }
+    const auto y = loss(ad::implicit_solution(F, x, p));
+    edges = ad::topological_order(y).operands.size();
+    benchmark::DoNotOptimize(ad::gradient(y, p));
+  }
+  state.counters["edges"] = static_cast<double>(edges);
+}
+BENCHMARK(BM_ImplicitSolution)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_ImplicitNewton(benchmark::State &state) {
+  const auto F = [](const auto &x, const auto &p) {
+    const auto next = g(x, p);
+    auto residual = x;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      residual[i] = x[i] - next[i];
+    }
+    return residual;
+  };
+  for (auto _ : state) {
+    const std::vector<ad::RSym<double>> p(unknowns, ad::RSym<double>{0.3});
+    const auto x =
+        ad::implicit_solve(F, std::vector<double>(unknowns, 0.0), p);
+    benchmark::DoNotOptimize(ad::gradient(loss(x), p));
+  }
+}
+BENCHMARK(BM_ImplicitNewton)->Unit(benchmark::kMillisecond);
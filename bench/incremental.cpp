@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/incremental.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/tape.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// A least-squares loss with neighbour coupling over n inputs, of which 1%
+// change between gradient evaluations, as in coordinate descent.
+constexpr std::size_t inputs = 100000;
+constexpr std::size_t changed = inputs / 100;
+
+static auto loss(const std::vector<ad::RSym<double>> &x) -> ad::RSym<double> {
+  using R = ad::RSym<double>;
+  std::vector<R> terms{};
+  terms.reserve(2 * x.size());
+  const R one{1.0};
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const R residual = exp(R{0.001 * static_cast<double>(i % 7)} * x[i]) - one;
+    terms.push_back(residual * residual);
+    if (i + 1 < x.size()) {
+      terms.push_back(sin(x[i] * x[i + 1]));
+    }
+  }
+  return ad::sum(terms);
+}
+
+static auto step(std::vector<double> &t_values, std::size_t t_round)
+    -> std::size_t {
+  const std::size_t first = (t_round * 7919) % inputs;
+  for (std::size_t k = 0; k < changed; ++k) {
+    const std::size_t i = (first + k * 97) % inputs;
+    t_values[i] += 1e-3;
+  }
+  return first;
+}
+
+static void BM_RebuildGraph(benchmark::State &state) {
+  std::vector<double> values(inputs, 0.5);
+  std::size_t round = 0;
+  for (auto _ : state) {
+    step(values, round++);
+    const std::vector<ad::RSym<double>> x(values.begin(), values.end());
+    benchmark::DoNotOptimize(ad::gradient(loss(x), x));
+  }
+}
+BENCHMARK(BM_RebuildGraph)->Unit(benchmark::kMillisecond);
+
+static void BM_TapeReplay(benchmark::State &state) {
+  std::vector<double> values(inputs, 0.5);
+  const std::vector<ad::RSym<double>> x(values.begin(), values.end());
+  auto tape = ad::Tape<double>::record(loss(x), x);
+  std::size_t round = 0;
+  for (auto _ : state) {
+    step(values, round++);
+    benchmark::DoNotOptimize(tape.gradient(values));
+  }
+}
+BENCHMARK(BM_TapeReplay)->Unit(benchmark::kMillisecond);
+
+static void BM_IncrementalUpdate(benchmark::State &state) {
+  std::vector<double> values(inputs, 0.5);
+  const std::vector<ad::RSym<double>> x(values.begin(), values.end());
+  ad::IncrementalTape<double> tape{ad::Tape<double>::record(loss(x), x)};
+  std::size_t round = 0;
+  std::size_t evaluated = 0;
+  for (auto _ : state) {
+    const std::size_t first = step(values, round++);
+    for (std::size_t k = 0; k < changed; ++k) {
+      const std::size_t i = (first + k * 97) % inputs;
+      tape.set(i, values[i]);
+    }
+    tape.update();
+    evaluated = tape.last_update().evaluated;
+    benchmark::DoNotOptimize(tape.adjoint(first));
+  }
+  state.counters["evaluated"] = static_cast<double>(evaluated);
+  state.counters["instructions"] = static_cast<double>(tape.size());
+}
+BENCHMARK(BM_IncrementalUpdate)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,127 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/io.hpp"
+#include "../include/matrix.hpp"
+#include "../include/utils.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Saving and loading a 1000 x 1000 Jacobian of doubles, 8 MB in memory.
+constexpr std::size_t size = 1000;
+
+static auto jacobian() -> ad::RectMatrix<double> {
+  ad::RectMatrix<double> J(size, size);
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t j = 0; j < size; ++j) {
+      J.at(i, j) = std::sin(static_cast<double>(i * size + j)) * 1e-3;
+    }
+  }
+  return J;
+}
+
+static auto file_bytes(const std::string &t_path) -> std::size_t {
+  std::ifstream in(t_path, std::ios::binary | std::ios::ate);
+  return static_cast<std::size_t>(in.tellg());
+}
+
+static const std::string text_path = "bench_io.csv";
+static const std::string binary_path = "bench_io.bin";
+
+static void BM_WriteText(benchmark::State &state) {
+  const auto J = jacobian();
+  for (auto _ : state) {
+    ad::write_text(text_path, J);
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(
+      state.iterations() * file_bytes(text_path)));
+}
+BENCHMARK(BM_WriteText)->Unit(benchmark::kMillisecond);
+
+static void BM_ReadText(benchmark::State &state) {
+  ad::write_text(text_path, jacobian());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::read_text<double>(text_path));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(
+      state.iterations() * file_bytes(text_path)));
+}
+BENCHMARK(BM_ReadText)->Unit(benchmark::kMillisecond);
+
+// the same text through iostreams, with enough digits to read back exactly
+static void BM_OstreamText(benchmark::State &state) {
+  const auto J = jacobian();
+  for (auto _ : state) {
+    std::ofstream out(text_path);
+    out << std::setprecision(17);
+    for (std::size_t i = 0; i < size; ++i) {
+      for (std::size_t j = 0; j < size; ++j) {
+        out << J.at(i, j) << (j + 1 == size ? '\n' : ',');
+      }
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(
+      state.iterations() * file_bytes(text_path)));
+}
+BENCHMARK(BM_OstreamText)->Unit(benchmark::kMillisecond);
+
+static void BM_IstreamText(benchmark::State &state) {
+  ad::write_text(text_path, jacobian());
+  for (auto _ : state) {
+    std::ifstream in(text_path);
+    ad::RectMatrix<double> J(size, size);
+    char delimiter{};
+    for (std::size_t i = 0; i < size; ++i) {
+      for (std::size_t j = 0; j < size; ++j) {
+        in >> J.at(i, j);
+        in.get(delimiter);
+      }
+    }
+    benchmark::DoNotOptimize(J.at(size - 1, size - 1));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(
+      state.iterations() * file_bytes(text_path)));
+}
+BENCHMARK(BM_IstreamText)->Unit(benchmark::kMillisecond);
+
+static void BM_PrintMatrix(benchmark::State &state) {
+  const auto J = jacobian();
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    std::ostringstream out{};
+    out << J;
+    bytes = out.str().size();
+  }
+  state.SetBytesProcessed(
+      static_cast<std::int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_PrintMatrix)->Unit(benchmark::kMillisecond);
+
+static void BM_WriteBinary(benchmark::State &state) {
+  const auto J = jacobian();
+  for (auto _ : state) {
+    ad::write_binary(binary_path, J);
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(
+      state.iterations() * size * size * sizeof(double)));
+}
+BENCHMARK(BM_WriteBinary)->Unit(benchmark::kMillisecond);
+
+static void BM_ReadBinary(benchmark::State &state) {
+  ad::write_binary(binary_path, jacobian());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::read_binary<double>(binary_path));
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(
+      state.iterations() * size * size * sizeof(double)));
+  std::remove(text_path.c_str());
+  std::remove(binary_path.c_str());
+}
+BENCHMARK(BM_ReadBinary)->Unit(benchmark::kMillisecond);
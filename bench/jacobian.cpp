@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/jacobian.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// f: R^n -> R^m where every output mixes every input through a few
+// transcendental functions, so no mode is favoured by sparsity.
+static auto model(std::size_t m) {
+  return [m](const auto &x) {
+    using S = typename std::decay_t<decltype(x)>::value_type;
+    S mixed = x[0];
+    for (std::size_t j = 1; j < x.size(); ++j) {
+      mixed = mixed + sin(x[j]) * x[j - 1];
+    }
+    std::vector<S> y{};
+    y.reserve(m);
+    for (std::size_t i = 0; i < m; ++i) {
+      const S scale{0.1 * static_cast<double>(i + 1)};
+      y.push_back(exp(scale * mixed) + x[i % x.size()]);
+    }
+    return y;
+  };
+}
+
+static void run(benchmark::State &state, ad::JacobianMode mode, bool probe) {
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const auto m = static_cast<std::size_t>(state.range(1));
+  const std::vector<double> x(n, 0.5);
+  const auto f = model(m);
+  ad::JacobianMode used{};
+  for (auto _ : state) {
+    auto result = ad::jacobian(f, x, {mode, probe});
+    used = result.choice.mode;
+    benchmark::DoNotOptimize(result.matrix.at(0, 0));
+  }
+  state.SetLabel(ad::to_string(used));
+}
+
+static void BM_Forward(benchmark::State &state) {
+  run(state, ad::JacobianMode::Forward, false);
+}
+static void BM_Reverse(benchmark::State &state) {
+  run(state, ad::JacobianMode::Reverse, false);
+}
+static void BM_Mixed(benchmark::State &state) {
+  run(state, ad::JacobianMode::Mixed, false);
+}
+static void BM_Auto(benchmark::State &state) {
+  run(state, ad::JacobianMode::Auto, false);
+}
+static void BM_AutoProbe(benchmark::State &state) {
+  run(state, ad::JacobianMode::Auto, true);
+}
+
+#define SHAPES                                                                 \
+  Args({1, 64})->Args({4, 64})->Args({16, 16})->Args({64, 4})->Args({64, 1})  \
+      ->Args({256, 1})
+BENCHMARK(BM_Forward)->SHAPES;
+BENCHMARK(BM_Reverse)->SHAPES;
+BENCHMARK(BM_Mixed)->SHAPES;
+BENCHMARK(BM_Auto)->SHAPES;
+BENCHMARK(BM_AutoProbe)->SHAPES;
@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/linalg.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+static auto system(std::size_t n) -> ad::SquareMatrix<double> {
+  ad::SquareMatrix<double> A(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      A.at(i, j) = i == j ? static_cast<double>(n)
+                          : std::cos(static_cast<double>(i + j));
+    }
+  }
+  return A;
+}
+
+static auto symbols(const ad::SquareMatrix<double> &values)
+    -> ad::SquareMatrix<ad::RSym<double>> {
+  const std::size_t n = values.dims().first;
+  ad::SquareMatrix<ad::RSym<double>> A(n, ad::RSym<double>{0.0});
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      A.at(i, j) = ad::RSym<double>{values.at(i, j)};
+    }
+  }
+  return A;
+}
+
+// Gaussian elimination without pivoting on symbols: every multiply-add of
+// the O(n^3) elimination becomes tape nodes.
+static auto taped_solve(ad::SquareMatrix<ad::RSym<double>> A,
+                        std::vector<ad::RSym<double>> b)
+    -> std::vector<ad::RSym<double>> {
+  const std::size_t n = b.size();
+  for (std::size_t k = 0; k < n; ++k) {
+    for (std::size_t i = k + 1; i < n; ++i) {
+      const auto l = A.at(i, k) / A.at(k, k);
+      for (std::size_t j = k + 1; j < n; ++j) {
+        A.at(i, j) = A.at(i, j) - l * A.at(k, j);
+      }
+      b[i] = b[i] - l * b[k];
+    }
+  }
+  for (std::size_t i = n; i-- > 0;) {
+    for (std::size_t j = i + 1; j < n; ++j) {
+      b[i] = b[i] - A.at(i, j) * b[j];
+    }
+    b[i] = b[i] / A.at(i, i);
+  }
+  return b;
+}
+
+template <typename Solve>
+static void run(benchmark::State &state, Solve &&solve) {
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const auto values = system(n);
+  std::size_t edges = 0;
+  for (auto _ : state) {
+    const auto A = symbols(values);
+    const std::vector<ad::RSym<double>> b(n, ad::RSym<double>{1.0});
+    const auto x = solve(A, b);
+    const auto loss = ad::sum(x);
+    edges = ad::topological_order(loss).operands.size();
+    benchmark::DoNotOptimize(ad::gradient(loss, b));
+  }
+  state.counters["edges"] = static_cast<double>(edges);
+}
+
+static void BM_TapedElimination(benchmark::State &state) {
+  run(state, taped_solve);
+}
+BENCHMARK(BM_TapedElimination)
+    ->RangeMultiplier(2)
+    ->Range(16, 128)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_LuSolveNode(benchmark::State &state) {
+  run(state, [](const auto &A, const auto &b) { return ad::lu_solve(A, b); });
+}
+BENCHMARK(BM_LuSolveNode)
+    ->RangeMultiplier(2)
+    ->Range(16, 128)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_CholeskySolveNode(benchmark::State &state) {
+  run(state,
+      [](const auto &A, const auto &b) { return ad::cholesky_solve(A, b); });
+}
+BENCHMARK(BM_CholeskySolveNode)
+    ->RangeMultiplier(2)
+    ->Range(16, 128)
+    ->Unit(benchmark::kMillisecond);
+
+template <typename F> static void factor(benchmark::State &state) {
+  const auto n = static_cast<std::size_t>(state.range(0));
+  const auto A = system(n);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(F{A});
+  }
+  // LU takes 2/3 n^3 flops, Cholesky half of that
+  const double flops = std::is_same_v<F, ad::LuFactorization<double>>
+                           ? 2.0 / 3.0
+                           : 1.0 / 3.0;
+  state.counters["flops"] = benchmark::Counter(
+      flops * static_cast<double>(n * n * n) *
+          static_cast<double>(state.iterations()),
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(factor, ad::LuFactorization<double>)
+    ->Arg(256)
+    ->Arg(1024)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(factor, ad::CholeskyFactorization<double>)
+    ->Arg(256)
+    ->Arg(1024)
+    ->Unit(benchmark::kMillisecond);
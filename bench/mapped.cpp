@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/mappedtape.hpp"
+#include "recorders/loss.hpp"
+
+#include <fstream>
+#include <string>
+
+// Worker startup: recording the loss from scratch against mapping a tape file
+// written once, each followed by the first gradient.
+static auto tape_file() -> const std::string & {
+  static const std::string path = [] {
+    std::string name = "/tmp/bench_mapped_loss.tape";
+    auto tape = record_loss();
+    tape.optimize();
+    std::ofstream out(name, std::ios::binary);
+    ad::write_tape(out, tape);
+    return name;
+  }();
+  return path;
+}
+
+static void BM_Rerecord(benchmark::State &state) {
+  for (auto _ : state) {
+    auto tape = record_loss();
+    tape.optimize();
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+}
+BENCHMARK(BM_Rerecord);
+
+static void BM_MapAndReplay(benchmark::State &state) {
+  const auto &path = tape_file();
+  for (auto _ : state) {
+    auto tape = ad::MappedTape<double>::open(path);
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+}
+BENCHMARK(BM_MapAndReplay);
+
+static void BM_MappedReplay(benchmark::State &state) {
+  auto tape = ad::MappedTape<double>::open(tape_file());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+}
+BENCHMARK(BM_MappedReplay);
@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/ode.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Damped Lotka-Volterra on two species with four parameters, integrated over
+// t in [0, 10] with RK4.
+template <typename S>
+static auto rhs(const S &, const std::vector<S> &y, const std::vector<S> &p)
+    -> std::vector<S> {
+  return {p[0] * y[0] - p[1] * y[0] * y[1],
+          p[1] * y[0] * y[1] - p[2] * y[1] - p[3] * y[1] * y[1]};
+}
+
+static const auto f = [](const auto &t, const auto &y, const auto &p) {
+  return rhs(t, y, p);
+};
+
+static void BM_TapedSteps(benchmark::State &state) {
+  using R = ad::RSym<double>;
+  const auto steps = static_cast<std::size_t>(state.range(0));
+  const double h = 10.0 / static_cast<double>(steps);
+  std::size_t edges = 0;
+  for (auto _ : state) {
+    const std::vector<R> p{1.1, 0.4, 0.9, 0.05};
+    std::vector<R> y{1.0, 0.5};
+    const R dt{h};
+    const R half{0.5 * h};
+    const R sixth{h / 6.0};
+    const R two{2.0};
+    for (std::size_t i = 0; i < steps; ++i) {
+      const R t{h * static_cast<double>(i)};
+      const auto k1 = rhs(t, y, p);
+      const auto k2 = rhs(t, {y[0] + half * k1[0], y[1] + half * k1[1]}, p);
+      const auto k3 = rhs(t, {y[0] + half * k2[0], y[1] + half * k2[1]}, p);
+      const auto k4 = rhs(t, {y[0] + dt * k3[0], y[1] + dt * k3[1]}, p);
+      for (std::size_t k = 0; k < 2; ++k) {
+        y[k] = y[k] + sixth * (k1[k] + two * (k2[k] + k3[k]) + k4[k]);
+      }
+    }
+    const auto loss = y[0] + y[1];
+    edges = ad::topological_order(loss).operands.size();
+    benchmark::DoNotOptimize(ad::gradient(loss, p));
+  }
+  state.counters["edges"] = static_cast<double>(edges);
+}
+BENCHMARK(BM_TapedSteps)
+    ->RangeMultiplier(10)
+    ->Range(100, 10000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_OdeAdjoint(benchmark::State &state) {
+  const auto steps = static_cast<std::size_t>(state.range(0));
+  const std::vector<double> p{1.1, 0.4, 0.9, 0.05};
+  const std::vector<double> y0{1.0, 0.5};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        ad::ode_adjoint(f, y0, p, 0.0, 10.0, steps, {1.0, 1.0}));
+  }
+}
+BENCHMARK(BM_OdeAdjoint)
+    ->RangeMultiplier(10)
+    ->Range(100, 10000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_OdeAdjointAdaptive(benchmark::State &state) {
+  const std::vector<double> p{1.1, 0.4, 0.9, 0.05};
+  const std::vector<double> y0{1.0, 0.5};
+  ad::OdeOptions options{};
+  options.relative_tolerance = 1e-9;
+  std::size_t steps = 0;
+  for (auto _ : state) {
+    const auto result =
+        ad::ode_adjoint_adaptive(f, y0, p, 0.0, 10.0, {1.0, 1.0}, options);
+    benchmark::DoNotOptimize(result);
+  }
+  steps = ad::ode_integrate_adaptive(f, y0, p, 0.0, 10.0, options).steps;
+  state.counters["steps"] = static_cast<double>(steps);
+}
+BENCHMARK(BM_OdeAdjointAdaptive)->Unit(benchmark::kMillisecond);
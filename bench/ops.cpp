@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/forwardops.hpp"
+#include "../include/tape.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Inputs in [t_low, t_low + 0.8), inside the domain of the primitive.
+static auto inputs(double t_low) -> std::vector<double> {
+  std::vector<double> x(1024);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    x[i] = t_low + 0.8 * static_cast<double>(i) / x.size();
+  }
+  return x;
+}
+
+static auto low(ad::Op t_op) -> double {
+  return t_op == ad::Op::Asec || t_op == ad::Op::Acsc ||
+                 t_op == ad::Op::Acosh || t_op == ad::Op::Acoth
+             ? 1.1
+             : 0.1;
+}
+
+template <typename F>
+static void BM_Forward(benchmark::State &state, F f, double t_low) {
+  const auto x = inputs(t_low);
+  for (auto _ : state) {
+    double sum{};
+    for (const double xi : x) {
+      const auto y = f(ad::FSym<double>{xi, 1.0});
+      sum += y.value() + y.dot();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+static void BM_Local(benchmark::State &state, ad::Op t_op, double t_low) {
+  const auto x = inputs(t_low);
+  for (auto _ : state) {
+    double sum{};
+    for (const double xi : x) {
+      const auto [value, partial] = ad::local(t_op, xi, 0.0);
+      sum += value + partial;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+// one pair of benchmarks per row of the table in `ops.hpp`
+#define AD_BENCH_OP(NAME, OP, VALUE, PARTIAL)                                  \
+  BENCHMARK_CAPTURE(BM_Forward, NAME,                                          \
+                    [](const ad::FSym<double> &x) { return NAME(x); },         \
+                    low(ad::Op::OP));                                          \
+  BENCHMARK_CAPTURE(BM_Local, NAME, ad::Op::OP, low(ad::Op::OP));
+AD_UNARY_OPS(AD_BENCH_OP)
+#undef AD_BENCH_OP
@@ -0,0 +1,146 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/optimizer.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Adam written the obvious way, one pass and one temporary per expression
+static auto adam_unfused(std::vector<double> &w, const std::vector<double> &g,
+                         std::vector<double> &m, std::vector<double> &v,
+                         std::size_t t) -> void {
+  const double b1 = 0.9, b2 = 0.999, rate = 1e-3, eps = 1e-8;
+  std::vector<double> g2(g.size());
+  std::transform(g.begin(), g.end(), g2.begin(),
+                 [](double x) { return x * x; });
+  std::transform(m.begin(), m.end(), g.begin(), m.begin(),
+                 [&](double a, double b) { return b1 * a + (1 - b1) * b; });
+  std::transform(v.begin(), v.end(), g2.begin(), v.begin(),
+                 [&](double a, double b) { return b2 * a + (1 - b2) * b; });
+  std::vector<double> m_hat(m.size());
+  std::vector<double> v_hat(v.size());
+  const double c1 = 1 - std::pow(b1, static_cast<double>(t));
+  const double c2 = 1 - std::pow(b2, static_cast<double>(t));
+  std::transform(m.begin(), m.end(), m_hat.begin(),
+                 [&](double a) { return a / c1; });
+  std::transform(v.begin(), v.end(), v_hat.begin(),
+                 [&](double a) { return a / c2; });
+  for (std::size_t i = 0; i < w.size(); ++i) {
+    w[i] -= rate * m_hat[i] / (std::sqrt(v_hat[i]) + eps);
+  }
+}
+
+static auto make_gradient(std::size_t n) -> std::vector<double> {
+  std::vector<double> g(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    g[i] = std::sin(static_cast<double>(i));
+  }
+  return g;
+}
+
+static void BM_AdamUnfused(benchmark::State &state) {
+  const auto g = make_gradient(state.range(0));
+  std::vector<double> w(g.size()), m(g.size()), v(g.size());
+  std::size_t t = 0;
+  for (auto _ : state) {
+    adam_unfused(w, g, m, v, ++t);
+    benchmark::DoNotOptimize(w.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 4 * 8);
+}
+BENCHMARK(BM_AdamUnfused)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+static void BM_Adam(benchmark::State &state) {
+  const auto g = make_gradient(state.range(0));
+  std::vector<double> w(g.size());
+  ad::Adam<double> adam{g.size()};
+  for (auto _ : state) {
+    adam.step(w, g);
+    benchmark::DoNotOptimize(w.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 4 * 8);
+}
+BENCHMARK(BM_Adam)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+static void BM_Sgd(benchmark::State &state) {
+  const auto g = make_gradient(state.range(0));
+  std::vector<double> w(g.size());
+  ad::Sgd<double> sgd{g.size(), 1e-3, 0.9};
+  for (auto _ : state) {
+    sgd.step(w, g);
+    benchmark::DoNotOptimize(w.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 3 * 8);
+}
+BENCHMARK(BM_Sgd)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+static void BM_Lbfgs(benchmark::State &state) {
+  const auto g = make_gradient(state.range(0));
+  std::vector<double> w(g.size());
+  std::vector<double> moved(g.size());
+  ad::Lbfgs<double> lbfgs{g.size(), 10, 0.1};
+  std::size_t k = 0;
+  for (auto _ : state) {
+    // a gradient that changes between steps, so pairs are accepted
+    const double scale = 1.0 + 0.01 * static_cast<double>(++k % 7);
+    for (std::size_t i = 0; i < g.size(); ++i) {
+      moved[i] = scale * g[i] + w[i];
+    }
+    lbfgs.step(w, moved);
+    benchmark::DoNotOptimize(w.data());
+  }
+  state.counters["pairs"] = static_cast<double>(lbfgs.pairs());
+}
+BENCHMARK(BM_Lbfgs)->RangeMultiplier(32)->Range(1 << 10, 1 << 20);
+
+// End to end: fit y = sin(a x) + b to 1000 samples by reverse mode gradients
+constexpr std::size_t fit_samples = 1000;
+constexpr std::size_t fit_steps = 50;
+
+static auto fit_loss(const std::vector<ad::RSym<double>> &w)
+    -> ad::RSym<double> {
+  std::vector<ad::RSym<double>> residuals{};
+  residuals.reserve(fit_samples);
+  for (std::size_t i = 0; i < fit_samples; ++i) {
+    const double x = 0.001 * static_cast<double>(i);
+    const ad::RSym<double> sx{x};
+    const ad::RSym<double> sy{std::sin(1.3 * x) + 0.5};
+    residuals.push_back(pow(sin(w[0] * sx) + w[1] - sy, 2.0));
+  }
+  return ad::mean(residuals);
+}
+
+template <typename Optimizer>
+static auto fit(benchmark::State &state, Optimizer optimizer) -> void {
+  double loss = 0.0;
+  for (auto _ : state) {
+    std::vector<double> w{0.8, 0.0};
+    auto step = optimizer;
+    for (std::size_t k = 0; k < fit_steps; ++k) {
+      const std::vector<ad::RSym<double>> x(w.begin(), w.end());
+      const auto y = fit_loss(x);
+      loss = y.value();
+      step.step(w, ad::gradient(y, x));
+    }
+    benchmark::DoNotOptimize(w.data());
+  }
+  state.counters["loss"] = loss;
+}
+
+static void BM_FitSgd(benchmark::State &state) {
+  fit(state, ad::Sgd<double>{2, 0.5, 0.9});
+}
+BENCHMARK(BM_FitSgd)->Unit(benchmark::kMillisecond);
+
+static void BM_FitAdam(benchmark::State &state) {
+  fit(state, ad::Adam<double>{2, 0.05});
+}
+BENCHMARK(BM_FitAdam)->Unit(benchmark::kMillisecond);
+
+static void BM_FitLbfgs(benchmark::State &state) {
+  fit(state, ad::Lbfgs<double>{2, 5, 1.0});
+}
+BENCHMARK(BM_FitLbfgs)->Unit(benchmark::kMillisecond);
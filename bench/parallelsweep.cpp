@@ -0,0 +1,145 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/parallelsweep.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// A wide graph: `layers` layers of `width` nodes, each mixing two nodes of
+// the layer above, about 3 width layers nodes in all.
+constexpr std::size_t width = 100000;
+constexpr std::size_t layers = 8;
+
+struct WideGraph {
+  std::vector<ad::RSym<double>> inputs{};
+  ad::RSym<double> output{0.0};
+};
+
+static auto wide_graph() -> WideGraph {
+  using R = ad::RSym<double>;
+  WideGraph graph{};
+  for (std::size_t i = 0; i < width; ++i) {
+    graph.inputs.emplace_back(1e-5 * static_cast<double>(i));
+  }
+  auto layer = graph.inputs;
+  for (std::size_t l = 0; l < layers; ++l) {
+    std::vector<R> next{};
+    next.reserve(width);
+    for (std::size_t i = 0; i < width; ++i) {
+      next.push_back(sin(layer[i]) * layer[(i * 7 + l) % width] + layer[i]);
+    }
+    layer = std::move(next);
+  }
+  graph.output = ad::sum(layer);
+  return graph;
+}
+
+static void BM_SerialGradient(benchmark::State &state) {
+  const auto graph = wide_graph();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::gradient(graph.output, graph.inputs));
+  }
+}
+BENCHMARK(BM_SerialGradient)->Unit(benchmark::kMillisecond);
+
+// threads of the pool; the time is wall clock, as the workers' is not counted
+static void ThreadCounts(benchmark::internal::Benchmark *b) {
+  b->Arg(1)->Arg(4)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+static void BM_ParallelGradient(benchmark::State &state) {
+  const auto graph = wide_graph();
+  ad::ThreadPool pool{static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        ad::parallel_gradient(graph.output, graph.inputs, pool));
+  }
+}
+BENCHMARK(BM_ParallelGradient)->Apply(ThreadCounts);
+
+// the serial steps parallel_gradient takes before its sweep
+static void BM_TopologicalOrder(benchmark::State &state) {
+  const auto graph = wide_graph();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::topological_order(graph.output));
+  }
+}
+BENCHMARK(BM_TopologicalOrder)->Unit(benchmark::kMillisecond);
+
+static void BM_LevelSchedule(benchmark::State &state) {
+  const auto graph = wide_graph();
+  const auto order = ad::topological_order(graph.output);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::LevelSchedule{order});
+  }
+}
+BENCHMARK(BM_LevelSchedule)->Unit(benchmark::kMillisecond);
+
+// the backward sweeps alone, over an order and schedule built once
+static void BM_SerialSweep(benchmark::State &state) {
+  const auto graph = wide_graph();
+  const auto order = ad::topological_order(graph.output);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::backward(order));
+  }
+  state.counters["nodes"] = static_cast<double>(order.nodes.size());
+}
+BENCHMARK(BM_SerialSweep)->Unit(benchmark::kMillisecond);
+
+static void BM_LevelSweep(benchmark::State &state) {
+  const auto graph = wide_graph();
+  const auto order = ad::topological_order(graph.output);
+  const ad::LevelSchedule schedule{order};
+  const auto partials = ad::edge_partials(order);
+  std::vector<double> adjoints(order.nodes.size());
+  ad::ThreadPool pool{static_cast<std::size_t>(state.range(0))};
+  for (auto _ : state) {
+    std::fill(adjoints.begin(), adjoints.end(), 0.0);
+    schedule.backward(partials.data(), adjoints.data(), pool);
+    benchmark::DoNotOptimize(adjoints.data());
+  }
+  state.counters["levels"] = static_cast<double>(schedule.depth());
+}
+BENCHMARK(BM_LevelSweep)->Apply(ThreadCounts);
+
+// Replays of a tape for new inputs: the schedule is built once, and both
+// sweeps run level by level on the pool.
+static auto input_rounds(const WideGraph &t_graph)
+    -> std::vector<std::vector<double>> {
+  std::vector<std::vector<double>> result(7);
+  for (std::size_t r = 0; r < result.size(); ++r) {
+    for (const auto &input : t_graph.inputs) {
+      result[r].push_back(input.value() + 1e-3 * static_cast<double>(r));
+    }
+  }
+  return result;
+}
+
+static void BM_TapeGradient(benchmark::State &state) {
+  const auto graph = wide_graph();
+  auto tape = ad::Tape<double>::record(graph.output, graph.inputs);
+  const auto rounds = input_rounds(graph);
+  std::size_t round = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tape.gradient(rounds[round++ % rounds.size()]));
+  }
+}
+BENCHMARK(BM_TapeGradient)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_ParallelTape(benchmark::State &state) {
+  const auto graph = wide_graph();
+  ad::ParallelTape<double> tape{
+      ad::Tape<double>::record(graph.output, graph.inputs)};
+  ad::ThreadPool pool{static_cast<std::size_t>(state.range(0))};
+  const auto rounds = input_rounds(graph);
+  std::size_t round = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        tape.gradient(rounds[round++ % rounds.size()], pool));
+  }
+  state.counters["levels"] = static_cast<double>(tape.schedule().depth());
+}
+BENCHMARK(BM_ParallelTape)->Apply(ThreadCounts);
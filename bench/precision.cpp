@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/tape.hpp"
+#include "recorders/loss.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Replays the least squares loss with double storage and with float storage
+// and double adjoints, reporting the tape footprint and the largest relative
+// gradient error against the double tape.
+template <typename P> static void BM_Replay(benchmark::State &state) {
+  auto reference = record_loss();
+  auto tape = record_loss<P>();
+  if (state.range(0) != 0) {
+    reference.optimize();
+    tape.optimize();
+  }
+
+  double error{};
+  for (const double w0 : {0.1, 0.3, 0.5, 0.9}) {
+    const auto expected = reference.gradient({w0, 0.7});
+    const auto df = tape.gradient({w0, 0.7});
+    for (std::size_t i = 0; i < df.size(); ++i) {
+      error = std::max(error, std::abs(df[i] - expected[i]) /
+                                  std::abs(expected[i]));
+    }
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+  state.counters["bytes_per_node"] =
+      static_cast<double>(tape.bytes()) / tape.size();
+  state.counters["max_rel_error"] = error;
+}
+BENCHMARK_TEMPLATE(BM_Replay, ad::Precision<double>)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Replay, ad::MixedPrecision)->Arg(0)->Arg(1);
@@ -0,0 +1,15 @@
+#include "../../include/codegen.hpp"
+#include "loss.hpp"
+
+#include <fstream>
+
+auto main(int argc, char **argv) -> int {
+  if (argc != 2) {
+    return 1;
+  }
+  auto tape = record_loss();
+  tape.optimize();
+  std::ofstream out(argv[1]);
+  ad::write_header(out, tape, "loss_kernel");
+  return out ? 0 : 1;
+}
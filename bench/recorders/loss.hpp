@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../../include/reverseops.hpp"
+#include "../../include/rsymbol.hpp"
+#include "../../include/tape.hpp"
+
+#include <cstddef>
+#include <vector>
+
+/** @brief Number of samples baked into the generated loss kernel */
+constexpr std::size_t loss_samples = 1000;
+
+/** @brief Least squares loss of a small model over fixed samples */
+inline auto loss(const std::vector<ad::RSym<double>> &w) -> ad::RSym<double> {
+  std::vector<ad::RSym<double>> residuals{};
+  residuals.reserve(loss_samples);
+  for (std::size_t i = 0; i < loss_samples; ++i) {
+    const ad::RSym<double> x{0.01 * static_cast<double>(i)};
+    const auto y = exp(sin(w[0] * x)) + w[1] * x;
+    residuals.push_back(pow(y - ad::RSym<double>{1.0}, 2.0));
+  }
+  return ad::sum(residuals);
+}
+
+/** @brief Records the loss at its initial weights */
+template <typename P = ad::Precision<double>>
+inline auto record_loss() -> ad::Tape<double, P> {
+  const std::vector<ad::RSym<double>> w{0.3, 0.7};
+  return ad::Tape<double, P>::record(loss(w), w);
+}
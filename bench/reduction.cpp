@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/rsymbol.hpp"
+
+#include <vector>
+
+static auto make_inputs(std::size_t n) -> std::vector<ad::RSym<double>> {
+  std::vector<ad::RSym<double>> x{};
+  x.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x.emplace_back(0.5 + static_cast<double>(i % 7));
+  }
+  return x;
+}
+
+static void BM_FoldPlus(benchmark::State &state) {
+  const auto x = make_inputs(state.range(0));
+  for (auto _ : state) {
+    ad::RSym<double> c = x.front();
+    for (std::size_t i = 1; i < x.size(); ++i) {
+      c = c + x[i];
+    }
+    benchmark::DoNotOptimize(ad::gradient(c, x));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FoldPlus)->RangeMultiplier(10)->Range(1000, 100000)->Complexity();
+
+static void BM_Sum(benchmark::State &state) {
+  const auto x = make_inputs(state.range(0));
+  for (auto _ : state) {
+    const auto c = ad::sum(x);
+    benchmark::DoNotOptimize(ad::gradient(c, x));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Sum)->RangeMultiplier(10)->Range(1000, 1000000)->Complexity();
+
+static void BM_Dot(benchmark::State &state) {
+  const auto x = make_inputs(state.range(0));
+  const auto y = make_inputs(state.range(0));
+  for (auto _ : state) {
+    const auto c = ad::dot(x, y);
+    benchmark::DoNotOptimize(ad::gradient(c, x));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Dot)->RangeMultiplier(10)->Range(1000, 1000000)->Complexity();
+
+static void BM_Norm2(benchmark::State &state) {
+  const auto x = make_inputs(state.range(0));
+  for (auto _ : state) {
+    const auto c = ad::norm2(x);
+    benchmark::DoNotOptimize(ad::gradient(c, x));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_Norm2)->RangeMultiplier(10)->Range(1000, 1000000)->Complexity();
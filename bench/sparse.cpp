@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/sparse.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// The 5-point Laplacian of a side x side grid: 10^6 rows and about 5 10^6
+// nonzeros for the default side of 1000.
+static auto laplacian(std::size_t side) -> ad::CsrMatrix<double> {
+  std::vector<ad::SparseEntry<double>> entries{};
+  entries.reserve(5 * side * side);
+  for (std::size_t r = 0; r < side; ++r) {
+    for (std::size_t c = 0; c < side; ++c) {
+      const std::size_t i = r * side + c;
+      entries.push_back({i, i, 4.0});
+      if (r > 0) {
+        entries.push_back({i, i - side, -1.0});
+      }
+      if (r + 1 < side) {
+        entries.push_back({i, i + side, -1.0});
+      }
+      if (c > 0) {
+        entries.push_back({i, i - 1, -1.0});
+      }
+      if (c + 1 < side) {
+        entries.push_back({i, i + 1, -1.0});
+      }
+    }
+  }
+  return ad::CsrMatrix<double>::from_entries(side * side, side * side,
+                                             entries);
+}
+
+static const auto &csr() {
+  static const auto matrix = laplacian(1000);
+  return matrix;
+}
+
+static const auto &csc() {
+  static const auto matrix = csr().convert();
+  return matrix;
+}
+
+static auto counters(benchmark::State &state, std::size_t width) -> void {
+  const auto &A = csr();
+  state.counters["nonzeros"] = static_cast<double>(A.nonzeros());
+  // values, indices and the gathered operand; rows and offsets are minor
+  state.SetBytesProcessed(state.iterations() * A.nonzeros() *
+                          (sizeof(double) + sizeof(std::size_t) +
+                           width * sizeof(double)));
+}
+
+static void BM_CsrMultiply(benchmark::State &state) {
+  const std::vector<double> x(csr().cols(), 1.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::multiply(csr(), x));
+  }
+  counters(state, 1);
+}
+BENCHMARK(BM_CsrMultiply)->Unit(benchmark::kMillisecond);
+
+static void BM_CscMultiply(benchmark::State &state) {
+  const std::vector<double> x(csc().cols(), 1.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::multiply(csc(), x));
+  }
+  counters(state, 1);
+}
+BENCHMARK(BM_CscMultiply)->Unit(benchmark::kMillisecond);
+
+static void BM_CsrMultiplyTranspose(benchmark::State &state) {
+  const std::vector<double> x(csr().rows(), 1.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::multiply_transpose(csr(), x));
+  }
+  counters(state, 1);
+}
+BENCHMARK(BM_CsrMultiplyTranspose)->Unit(benchmark::kMillisecond);
+
+static void BM_CsrMultiplyAdjoint(benchmark::State &state) {
+  const std::vector<double> x(csr().cols(), 1.0);
+  const std::vector<double> adjoint(csr().rows(), 0.5);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::multiply_adjoint(csr(), x, adjoint));
+  }
+  counters(state, 2);
+}
+BENCHMARK(BM_CsrMultiplyAdjoint)->Unit(benchmark::kMillisecond);
+
+static void BM_CsrMultiplyDense(benchmark::State &state) {
+  const auto width = static_cast<std::size_t>(state.range(0));
+  ad::RectMatrix<double> B(csr().cols(), width);
+  for (std::size_t i = 0; i < csr().cols(); ++i) {
+    for (std::size_t j = 0; j < width; ++j) {
+      B.at(i, j) = 1.0;
+    }
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ad::multiply(csr(), B));
+  }
+  counters(state, width);
+}
+BENCHMARK(BM_CsrMultiplyDense)->Arg(4)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/forwardops.hpp"
+#include "../include/fsymbol.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/sparseops.hpp"
+#include "../include/ssymbol.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// The Jacobian of a chain of residuals r_i(x_i, x_i+1, x_i+2), a banded
+// matrix with three nonzeros per row, over n inputs.
+template <typename S>
+auto residuals(const std::vector<S> &x) -> std::vector<S> {
+  std::vector<S> r{};
+  r.reserve(x.size());
+  for (std::size_t i = 0; i + 2 < x.size(); ++i) {
+    r.push_back(x[i + 1] * x[i + 1] - x[i] * sin(x[i + 2]));
+  }
+  return r;
+}
+
+static auto point(std::size_t n) -> std::vector<double> {
+  std::vector<double> x(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = 0.5 + 1e-4 * static_cast<double>(i);
+  }
+  return x;
+}
+
+static void BM_SparseForward(benchmark::State &state) {
+  const auto x = point(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    const auto r = residuals(ad::sparse_variables(x));
+    benchmark::DoNotOptimize(r.back().df(x.size() - 1));
+  }
+}
+BENCHMARK(BM_SparseForward)->RangeMultiplier(10)->Range(1000, 100000);
+
+// one reverse sweep per row, over the graph of that row only
+static void BM_ReversePerRow(benchmark::State &state) {
+  const auto x = point(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    const std::vector<ad::RSym<double>> xs(x.begin(), x.end());
+    const auto r = residuals(xs);
+    for (std::size_t i = 0; i < r.size(); ++i) {
+      benchmark::DoNotOptimize(
+          ad::gradient(r[i], {xs[i], xs[i + 1], xs[i + 2]}));
+    }
+  }
+}
+BENCHMARK(BM_ReversePerRow)->RangeMultiplier(10)->Range(1000, 100000);
+
+// one dense forward pass per input
+static void BM_DenseForward(benchmark::State &state) {
+  const auto x = point(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    for (std::size_t j = 0; j < x.size(); ++j) {
+      std::vector<ad::FSym<double>> xs(x.begin(), x.end());
+      xs[j] = ad::FSym<double>{x[j], 1.0};
+      benchmark::DoNotOptimize(residuals(xs));
+    }
+  }
+}
+BENCHMARK(BM_DenseForward)->Arg(1000);
@@ -0,0 +1,48 @@
+// Same workloads as bench/reduction.cpp with the instrumentation compiled in
+#define AD_STATS
+
+#include <benchmark/benchmark.h>
+
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/stats.hpp"
+
+#include <vector>
+
+static auto make_inputs(std::size_t n) -> std::vector<ad::RSym<double>> {
+  std::vector<ad::RSym<double>> x{};
+  x.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x.emplace_back(0.5 + static_cast<double>(i % 7));
+  }
+  return x;
+}
+
+static void BM_FoldPlusStats(benchmark::State &state) {
+  const auto x = make_inputs(state.range(0));
+  for (auto _ : state) {
+    ad::RSym<double> c = x.front();
+    for (std::size_t i = 1; i < x.size(); ++i) {
+      c = c + x[i];
+    }
+    benchmark::DoNotOptimize(ad::gradient(c, x));
+  }
+  state.counters["depth"] =
+      static_cast<double>(ad::Stats::last().max_depth);
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FoldPlusStats)
+    ->RangeMultiplier(10)
+    ->Range(1000, 100000)
+    ->Complexity();
+
+static void BM_SumStats(benchmark::State &state) {
+  const auto x = make_inputs(state.range(0));
+  for (auto _ : state) {
+    const auto c = ad::sum(x);
+    benchmark::DoNotOptimize(ad::gradient(c, x));
+  }
+  state.counters["edges"] = static_cast<double>(ad::Stats::last().edges);
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_SumStats)->RangeMultiplier(10)->Range(1000, 1000000)->Complexity();
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/stream.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr std::size_t samples = 1000000;
+
+// 1e6 (x, y) samples of a noisy sine model, written once as raw doubles
+static auto sample_file() -> const std::string & {
+  static const std::string path = [] {
+    std::string name = "/tmp/bench_stream_samples.bin";
+    std::ofstream out(name, std::ios::binary);
+    for (std::size_t i = 0; i < samples; ++i) {
+      const double row[2] = {1e-6 * static_cast<double>(i),
+                             std::sin(1e-6 * static_cast<double>(i)) + 0.5};
+      out.write(reinterpret_cast<const char *>(row), sizeof(row));
+    }
+    return name;
+  }();
+  return path;
+}
+
+// drops the sample file from the page cache so every pass reads the disk
+static auto evict(const std::string &path) -> void {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+static auto loss(const std::vector<ad::RSym<double>> &w,
+                 const ad::SampleChunk<double> &chunk) -> ad::RSym<double> {
+  std::vector<ad::RSym<double>> residuals{};
+  residuals.reserve(chunk.rows);
+  for (std::size_t i = 0; i < chunk.rows; ++i) {
+    const ad::RSym<double> x{chunk.row(i)[0]};
+    const ad::RSym<double> y{chunk.row(i)[1]};
+    residuals.push_back(pow(sin(w[0] * x) + w[1] - y, 2.0));
+  }
+  return ad::sum(residuals);
+}
+
+static void BM_StreamGradient(benchmark::State &state) {
+  const auto &path = sample_file();
+  for (auto _ : state) {
+    state.PauseTiming();
+    evict(path);
+    state.ResumeTiming();
+    ad::BinaryReader<double> reader{path, 2};
+    benchmark::DoNotOptimize(
+        ad::stream_gradient(reader, std::vector<double>{0.9, 0.4},
+                            state.range(0), loss));
+  }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_StreamGradient)->RangeMultiplier(16)->Range(256, 65536);
+
+// the same chunks read and differentiated one after the other, relying on
+// the kernel's own read-ahead only
+static void BM_SequentialGradient(benchmark::State &state) {
+  const auto &path = sample_file();
+  for (auto _ : state) {
+    state.PauseTiming();
+    evict(path);
+    state.ResumeTiming();
+    ad::BinaryReader<double> reader{path, 2};
+    std::vector<double> rows{};
+    std::vector<double> gradient(2);
+    while (const std::size_t count = reader.read(rows, state.range(0))) {
+      const std::vector<ad::RSym<double>> w{0.9, 0.4};
+      const auto df = ad::gradient(loss(w, {rows.data(), count, 2}), w);
+      gradient[0] += df[0];
+      gradient[1] += df[1];
+    }
+    benchmark::DoNotOptimize(gradient);
+  }
+  state.SetItemsProcessed(state.iterations() * samples);
+}
+BENCHMARK(BM_SequentialGradient)->RangeMultiplier(16)->Range(256, 65536);
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/tape.hpp"
+
+#include <vector>
+
+// Least squares residuals of a small model, written the way generated code
+// tends to be: scaled by literal ones and squared through pow(x, 2).
+static auto loss(const std::vector<ad::RSym<double>> &w, std::size_t samples)
+    -> ad::RSym<double> {
+  const ad::RSym<double> one{1.0};
+  const ad::RSym<double> half{0.5};
+  std::vector<ad::RSym<double>> residuals{};
+  residuals.reserve(samples);
+  for (std::size_t i = 0; i < samples; ++i) {
+    const ad::RSym<double> x{0.01 * static_cast<double>(i)};
+    const auto y = exp(sin(w[0] * x)) * one + w[1] * x * (half + half);
+    residuals.push_back(pow(y - ad::RSym<double>{1.0}, 2.0));
+  }
+  return ad::sum(residuals);
+}
+
+static void BM_Gradient(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.3, 0.7};
+  for (auto _ : state) {
+    const auto c = loss(w, state.range(0));
+    benchmark::DoNotOptimize(ad::gradient(c, w));
+  }
+}
+BENCHMARK(BM_Gradient)->RangeMultiplier(10)->Range(100, 100000);
+
+static void BM_TapeReplay(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.3, 0.7};
+  auto tape = ad::Tape<double>::record(loss(w, state.range(0)), w);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+  state.counters["nodes"] = tape.size();
+}
+BENCHMARK(BM_TapeReplay)->RangeMultiplier(10)->Range(100, 100000);
+
+static void BM_OptimizedTapeReplay(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.3, 0.7};
+  auto tape = ad::Tape<double>::record(loss(w, state.range(0)), w);
+  const auto stats = tape.optimize();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+  state.counters["nodes_before"] = stats.nodes_before;
+  state.counters["nodes"] = stats.nodes_after;
+}
+BENCHMARK(BM_OptimizedTapeReplay)->RangeMultiplier(10)->Range(100, 100000);
@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/taylorops.hpp"
+#include "../include/tsymbol.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+// Nested dual numbers: Dual<Dual<double>> carries second derivatives and K
+// levels carry the K-th derivative in 2^K components.
+template <typename V> struct Dual {
+  V a;
+  V b;
+};
+
+template <typename V> auto constant(double x) -> V {
+  if constexpr (std::is_same_v<V, double>) {
+    return x;
+  } else {
+    return {constant<decltype(V::a)>(x), constant<decltype(V::a)>(0.0)};
+  }
+}
+
+template <typename V> auto operator+(const Dual<V> &x, const Dual<V> &y) {
+  return Dual<V>{x.a + y.a, x.b + y.b};
+}
+
+template <typename V> auto operator*(const Dual<V> &x, const Dual<V> &y) {
+  return Dual<V>{x.a * y.a, x.a * y.b + x.b * y.a};
+}
+
+using std::cos, std::exp, std::sin;
+
+template <typename V> auto exp(const Dual<V> &x) -> Dual<V> {
+  const V e = exp(x.a);
+  return {e, e * x.b};
+}
+
+template <typename V> auto cos(const Dual<V> &x) -> Dual<V>;
+
+template <typename V> auto sin(const Dual<V> &x) -> Dual<V> {
+  return {sin(x.a), cos(x.a) * x.b};
+}
+
+template <typename V> auto cos(const Dual<V> &x) -> Dual<V> {
+  return {cos(x.a), constant<V>(-1.0) * sin(x.a) * x.b};
+}
+
+// seeds every level with direction 1, so the last component is f^(K)(x)
+template <std::size_t K> auto seed(double x) {
+  if constexpr (K == 0) {
+    return x;
+  } else {
+    using V = decltype(seed<K - 1>(x));
+    const V inner = seed<K - 1>(x);
+    return Dual<V>{inner, constant<V>(1.0)};
+  }
+}
+
+// f(x) = exp(sin(x)) * cos(x) + x * x
+template <typename S> auto f(const S &x) -> S {
+  return exp(sin(x)) * cos(x) + x * x;
+}
+
+// the component of the K-th derivative, b.b...b
+template <typename V> auto last(const V &x) -> double {
+  if constexpr (std::is_same_v<V, double>) {
+    return x;
+  } else {
+    return last(x.b);
+  }
+}
+
+template <std::size_t K> static void BM_NestedDual(benchmark::State &state) {
+  double x = 0.4;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(x);
+    benchmark::DoNotOptimize(f(seed<K>(x)));
+  }
+  state.counters["derivative"] = last(f(seed<K>(x)));
+}
+BENCHMARK_TEMPLATE(BM_NestedDual, 2);
+BENCHMARK_TEMPLATE(BM_NestedDual, 4);
+BENCHMARK_TEMPLATE(BM_NestedDual, 6);
+BENCHMARK_TEMPLATE(BM_NestedDual, 8);
+BENCHMARK_TEMPLATE(BM_NestedDual, 10);
+
+template <std::size_t K> static void BM_Taylor(benchmark::State &state) {
+  double x = 0.4;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(x);
+    benchmark::DoNotOptimize(f(ad::TSym<double, K>{x, 1.0}));
+  }
+  state.counters["derivative"] = f(ad::TSym<double, K>{x, 1.0}).derivative(K);
+}
+BENCHMARK_TEMPLATE(BM_Taylor, 2);
+BENCHMARK_TEMPLATE(BM_Taylor, 4);
+BENCHMARK_TEMPLATE(BM_Taylor, 6);
+BENCHMARK_TEMPLATE(BM_Taylor, 8);
+BENCHMARK_TEMPLATE(BM_Taylor, 10);
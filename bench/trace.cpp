@@ -0,0 +1,54 @@
+// Workloads of bench/tape.cpp with the trace scopes compiled in
+#define AD_TRACE
+
+#include <benchmark/benchmark.h>
+
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/tape.hpp"
+#include "../include/trace.hpp"
+
+#include <sstream>
+#include <vector>
+
+static auto loss(const std::vector<ad::RSym<double>> &w, std::size_t samples)
+    -> ad::RSym<double> {
+  const ad::RSym<double> one{1.0};
+  const ad::RSym<double> half{0.5};
+  std::vector<ad::RSym<double>> residuals{};
+  residuals.reserve(samples);
+  for (std::size_t i = 0; i < samples; ++i) {
+    const ad::RSym<double> x{0.01 * static_cast<double>(i)};
+    const auto y = exp(sin(w[0] * x)) * one + w[1] * x * (half + half);
+    residuals.push_back(pow(y - ad::RSym<double>{1.0}, 2.0));
+  }
+  return ad::sum(residuals);
+}
+
+static void BM_TracedGradient(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.3, 0.7};
+  for (auto _ : state) {
+    const auto c = loss(w, state.range(0));
+    benchmark::DoNotOptimize(ad::gradient(c, w));
+  }
+}
+BENCHMARK(BM_TracedGradient)->RangeMultiplier(10)->Range(100, 100000);
+
+static void BM_TracedTapeReplay(benchmark::State &state) {
+  const std::vector<ad::RSym<double>> w{0.3, 0.7};
+  auto tape = ad::Tape<double>::record(loss(w, state.range(0)), w);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tape.gradient({0.3, 0.7}));
+  }
+  state.counters["nodes"] = tape.size();
+}
+BENCHMARK(BM_TracedTapeReplay)->RangeMultiplier(10)->Range(100, 100000);
+
+static void BM_TraceWrite(benchmark::State &state) {
+  for (auto _ : state) {
+    std::ostringstream os{};
+    ad::Trace::write(os);
+    benchmark::DoNotOptimize(os.str().size());
+  }
+}
+BENCHMARK(BM_TraceWrite)->Iterations(1);
@@ -0,0 +1,31 @@
+# autodiff_generate_header(<target> RECORDER <source> OUTPUT <header>)
+#
+# Builds the recorder program <source>, which records a tape and writes the
+# generated gradient kernel with ad::write_header to the path given as its
+# first argument, and runs it to produce <header> before <target> is compiled.
+# The directory of <header> is added to the include path of <target>, and the
+# recorder links AutoDiff::autodiff where it is defined, e.g. after
+# find_package(AutoDiff).
+function(autodiff_generate_header TARGET)
+    cmake_parse_arguments(ARG "" "RECORDER;OUTPUT" "" ${ARGN})
+
+    get_filename_component(RECORDER_NAME ${ARG_RECORDER} NAME_WE)
+    get_filename_component(OUTPUT_DIR ${ARG_OUTPUT} DIRECTORY)
+    set(RECORDER_TARGET ${TARGET}_${RECORDER_NAME}_recorder)
+
+    add_executable(${RECORDER_TARGET} ${ARG_RECORDER})
+    if(TARGET AutoDiff::autodiff)
+        target_link_libraries(${RECORDER_TARGET} PRIVATE AutoDiff::autodiff)
+    endif()
+
+    add_custom_command(
+        OUTPUT ${ARG_OUTPUT}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIR}
+        COMMAND ${RECORDER_TARGET} ${ARG_OUTPUT}
+        DEPENDS ${RECORDER_TARGET}
+        COMMENT "Generating gradient kernel ${ARG_OUTPUT}"
+        VERBATIM)
+
+    target_sources(${TARGET} PRIVATE ${ARG_OUTPUT})
+    target_include_directories(${TARGET} PRIVATE ${OUTPUT_DIR})
+endfunction()
@@ -0,0 +1,239 @@
+#ifndef __ALLOCATOR_H__
+#define __ALLOCATOR_H__
+
+#include "../include/vector.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace ad {
+
+/** @brief Alignment of every pooled buffer: one cache line, one AVX-512 row */
+constexpr std::size_t buffer_alignment = 64;
+
+/**
+ * @brief Buffers of at least this many bytes are aligned to it and, when
+ * `BufferPool::huge_pages` is on, advised to be backed by transparent huge
+ * pages.
+ */
+constexpr std::size_t huge_page_size = std::size_t{1} << 21;
+
+struct PoolStats {
+  /** @brief Allocations served from a free list */
+  std::size_t hits{};
+  /** @brief Allocations that went to the system */
+  std::size_t misses{};
+  /** @brief Bytes held on the free lists */
+  std::size_t cached{};
+};
+
+/**
+ * @brief Per-thread free lists of aligned buffers in power-of-two size
+ * classes, from `buffer_alignment` bytes up. Freed buffers are kept for the
+ * next allocation of their class until the cached bytes would exceed
+ * `capacity()`, and returned to the system when the thread exits. A buffer
+ * may be freed on another thread than the one that allocated it; it then
+ * joins that thread's free list.
+ */
+class BufferPool {
+public:
+  BufferPool() = default;
+  BufferPool(const BufferPool &) = delete;
+  auto operator=(const BufferPool &) -> BufferPool & = delete;
+  ~BufferPool() {
+    release();
+    destroyed() = true;
+  }
+
+  /** @brief The pool of the calling thread, or null once it is destroyed */
+  static auto local() noexcept -> BufferPool * {
+    if (destroyed()) {
+      return nullptr;
+    }
+    thread_local BufferPool pool{};
+    return &pool;
+  }
+
+  /** @brief Bytes of the size class holding `t_bytes` */
+  static constexpr auto size_class(std::size_t t_bytes) noexcept
+      -> std::size_t {
+    std::size_t bytes = buffer_alignment;
+    while (bytes < t_bytes) {
+      bytes <<= 1;
+    }
+    return bytes;
+  }
+
+  /** @brief Whether large buffers are advised to use huge pages; off */
+  static auto huge_pages() noexcept -> bool {
+    return huge_pages_flag().load(std::memory_order_relaxed);
+  }
+  static auto huge_pages(bool t_enabled) noexcept -> void {
+    huge_pages_flag().store(t_enabled, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief A buffer of at least `t_bytes` bytes aligned to
+   * `buffer_alignment`. Throws `std::bad_alloc` if the system has none.
+   */
+  auto allocate(std::size_t t_bytes) -> void * {
+    if (t_bytes > largest_class) {
+      throw std::bad_alloc{};
+    }
+    const std::size_t index = class_index(t_bytes);
+    auto &list = m_free[index];
+    if (!list.empty()) {
+      void *buffer = list.back();
+      list.pop_back();
+      m_stats.cached -= std::size_t{1} << index;
+      ++m_stats.hits;
+      return buffer;
+    }
+    ++m_stats.misses;
+    return system_allocate(std::size_t{1} << index);
+  }
+
+  /** @brief Takes back a buffer of `allocate(t_bytes)` */
+  auto deallocate(void *t_buffer, std::size_t t_bytes) noexcept -> void {
+    const std::size_t index = class_index(t_bytes);
+    const std::size_t bytes = std::size_t{1} << index;
+    if (m_stats.cached + bytes > m_capacity) {
+      std::free(t_buffer);
+      return;
+    }
+    try {
+      m_free[index].push_back(t_buffer);
+    } catch (...) {
+      std::free(t_buffer);
+      return;
+    }
+    m_stats.cached += bytes;
+  }
+
+  /** @brief Returns every cached buffer to the system */
+  auto release() noexcept -> void {
+    for (auto &list : m_free) {
+      for (void *buffer : list) {
+        std::free(buffer);
+      }
+      list.clear();
+    }
+    m_stats.cached = 0;
+  }
+
+  auto stats() const noexcept -> const PoolStats & { return m_stats; }
+
+  /** @brief Most bytes kept on the free lists, 256 MiB by default */
+  auto capacity() const noexcept -> std::size_t { return m_capacity; }
+  auto capacity(std::size_t t_bytes) noexcept -> void {
+    m_capacity = t_bytes;
+    if (m_stats.cached > m_capacity) {
+      release();
+    }
+  }
+
+  /** @brief Allocates outside of any pool, e.g. once the pool is destroyed */
+  static auto system_allocate(std::size_t t_bytes) -> void * {
+    if (t_bytes > largest_class) {
+      throw std::bad_alloc{};
+    }
+    const std::size_t bytes = size_class(t_bytes);
+    const bool huge = bytes >= huge_page_size;
+    void *buffer =
+        std::aligned_alloc(huge ? huge_page_size : buffer_alignment, bytes);
+    if (buffer == nullptr) {
+      throw std::bad_alloc{};
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge && huge_pages()) {
+      ::madvise(buffer, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    return buffer;
+  }
+
+private:
+  static constexpr std::size_t class_count =
+      std::numeric_limits<std::size_t>::digits;
+  static constexpr std::size_t largest_class = std::size_t{1}
+                                               << (class_count - 1);
+
+  static auto class_index(std::size_t t_bytes) noexcept -> std::size_t {
+    std::size_t index = 0;
+    for (std::size_t bytes = size_class(t_bytes); bytes > 1; bytes >>= 1) {
+      ++index;
+    }
+    return index;
+  }
+
+  static auto destroyed() noexcept -> bool & {
+    thread_local bool flag = false;
+    return flag;
+  }
+
+  static auto huge_pages_flag() noexcept -> std::atomic<bool> & {
+    static std::atomic<bool> flag{false};
+    return flag;
+  }
+
+  std::array<std::vector<void *>, class_count> m_free{};
+  std::size_t m_capacity{std::size_t{1} << 28};
+  PoolStats m_stats{};
+};
+
+/**
+ * @brief Standard allocator handing out `BufferPool` buffers of the calling
+ * thread. It is stateless, so containers using it swap and move their
+ * buffers freely, e.g. `ad::vector<double, ad::PoolAllocator<double>>` or
+ * `ad::RectMatrix<double, ad::PoolAllocator<double>>`.
+ */
+template <typename T> struct PoolAllocator {
+  static_assert(alignof(T) <= buffer_alignment,
+                "ad::PoolAllocator: over-aligned value type");
+  using value_type = T;
+
+  PoolAllocator() noexcept = default;
+  template <typename U>
+  constexpr PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+  auto allocate(std::size_t n) -> T * {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_alloc{};
+    }
+    auto *pool = BufferPool::local();
+    void *buffer = pool != nullptr ? pool->allocate(n * sizeof(T))
+                                   : BufferPool::system_allocate(n * sizeof(T));
+    return static_cast<T *>(buffer);
+  }
+
+  auto deallocate(T *t_buffer, std::size_t n) noexcept -> void {
+    if (auto *pool = BufferPool::local()) {
+      pool->deallocate(t_buffer, n * sizeof(T));
+    } else {
+      std::free(t_buffer);
+    }
+  }
+
+  template <typename U>
+  constexpr auto operator==(const PoolAllocator<U> &) const noexcept -> bool {
+    return true;
+  }
+  template <typename U>
+  constexpr auto operator!=(const PoolAllocator<U> &) const noexcept -> bool {
+    return false;
+  }
+};
+
+/** @brief `ad::vector` on pooled, 64-byte aligned buffers */
+template <typename T> using pooled_vector = vector<T, PoolAllocator<T>>;
+
+} // namespace ad
+
+#endif // __ALLOCATOR_H__
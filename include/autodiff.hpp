@@ -0,0 +1,53 @@
+#ifndef __AUTODIFF_H__
+#define __AUTODIFF_H__
+
+// Every header of the library. Targets linking the precompiled `autodiff`
+// library get `AD_EXTERN_TEMPLATES` defined, and this header then declares
+// its float and double instantiations `extern`, so that they are compiled
+// once in the library instead of in every translation unit. It must be
+// included before any of them is used.
+
+#include "../include/allocator.hpp"
+#include "../include/batchtape.hpp"
+#include "../include/codegen.hpp"
+#include "../include/expression.hpp"
+#include "../include/forwardops.hpp"
+#include "../include/fsymbol.hpp"
+#include "../include/implicit.hpp"
+#include "../include/incremental.hpp"
+#include "../include/io.hpp"
+#include "../include/jacobian.hpp"
+#include "../include/linalg.hpp"
+#include "../include/mappedtape.hpp"
+#include "../include/matrix.hpp"
+#include "../include/ode.hpp"
+#include "../include/ops.hpp"
+#include "../include/optimizer.hpp"
+#include "../include/parallel.hpp"
+#include "../include/parallelsweep.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/sparse.hpp"
+#include "../include/sparseops.hpp"
+#include "../include/ssymbol.hpp"
+#include "../include/stats.hpp"
+#include "../include/stream.hpp"
+#include "../include/tape.hpp"
+#include "../include/taylorops.hpp"
+#include "../include/trace.hpp"
+#include "../include/tsymbol.hpp"
+#include "../include/utils.hpp"
+#include "../include/vector.hpp"
+
+#ifdef AD_EXTERN_TEMPLATES
+#define AD_EXTERN extern
+#define AD_SCALAR float
+#include "../include/instantiate.hpp"
+#undef AD_SCALAR
+#define AD_SCALAR double
+#include "../include/instantiate.hpp"
+#undef AD_SCALAR
+#undef AD_EXTERN
+#endif
+
+#endif // __AUTODIFF_H__
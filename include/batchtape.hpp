@@ -0,0 +1,311 @@
+#ifndef __BATCHTAPE_H__
+#define __BATCHTAPE_H__
+
+#include "../include/ops.hpp"
+#include "../include/tape.hpp"
+#include "../include/trace.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/**
+ * @brief Replays a recorded `Tape` for `B` samples at once. Every instruction
+ * owns a lane of `B` values, partials and adjoints stored contiguously and
+ * aligned (structure of arrays), so each instruction of the forward and
+ * backward sweeps is a fixed-length loop over the lanes that the compiler
+ * turns into vector instructions. This suits minibatches, where every sample
+ * produces a graph of the same structure: record it once with the per-sample
+ * data as inputs, then replay the whole batch with one sweep each way.
+ *
+ * @tparam T
+ * @tparam B the number of samples per replay, a power of two
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
+template <typename T, std::size_t B,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class BatchTape {
+  static_assert(B > 0 && (B & (B - 1)) == 0,
+                "the lane width must be a power of two");
+
+public:
+  static constexpr std::size_t lanes = B;
+
+  /** @brief One value per sample, aligned to at most a cache line */
+  struct alignas(sizeof(T) * B < 64 ? sizeof(T) * B : 64) Lane {
+    T v[B];
+  };
+
+  /**
+   * @brief Prepares the replay of `t_tape`. All lanes start at the input
+   * values the tape was recorded with.
+   */
+  explicit BatchTape(const Tape<T> &t_tape)
+      : m_tape(t_tape), m_values(t_tape.size()),
+        m_partials(t_tape.edge_count()), m_adjoints(t_tape.size()) {
+    for (const auto index : m_tape.inputs()) {
+      broadcast_slot(index, m_tape.value(index));
+    }
+  }
+
+  /** @brief Sets input `t_input` of sample `t_lane` */
+  auto set(std::size_t t_input, std::size_t t_lane, T t_value) -> void {
+    assert(t_input < input_count() && t_lane < B);
+    m_values[m_tape.inputs()[t_input]].v[t_lane] = t_value;
+  }
+
+  /** @brief Sets input `t_input` of every sample, e.g. a shared parameter */
+  auto broadcast(std::size_t t_input, T t_value) -> void {
+    assert(t_input < input_count());
+    broadcast_slot(m_tape.inputs()[t_input], t_value);
+  }
+
+  /**
+   * @brief Sets input `t_input` of all samples from `t_values`, one value per
+   * lane.
+   */
+  auto set(std::size_t t_input, const T *t_values) -> void {
+    assert(t_input < input_count());
+    T *lane = m_values[m_tape.inputs()[t_input]].v;
+    for (std::size_t l = 0; l < B; ++l) {
+      lane[l] = t_values[l];
+    }
+  }
+
+  /**
+   * @brief Replays the forward pass of all samples, storing the values and
+   * the local partials of every instruction.
+   */
+  auto forward() -> void {
+    AD_TRACE_SCOPE("ad::BatchTape::forward");
+    const auto tape = m_tape.view();
+    for (std::size_t i = 0; i < tape.size; ++i) {
+      const std::size_t offset = tape.offsets[i];
+      const std::size_t arity = tape.offsets[i + 1] - offset;
+      const auto *args = tape.operands + offset;
+      T *value = m_values[i].v;
+      Lane *partials = m_partials.data() + offset;
+
+      switch (tape.ops[i]) {
+      case Op::Variable:
+        break;
+      case Op::Constant:
+        fill(value, tape.constants[i]);
+        break;
+      case Op::Add:
+      case Op::Sub: {
+        const T *x = m_values[args[0]].v;
+        const T *y = m_values[args[1]].v;
+        const T sign = tape.ops[i] == Op::Add ? T{1} : T{-1};
+        for (std::size_t l = 0; l < B; ++l) {
+          value[l] = x[l] + sign * y[l];
+        }
+        fill(partials[0].v, T{1});
+        fill(partials[1].v, sign);
+        break;
+      }
+      case Op::Mul: {
+        const T *x = m_values[args[0]].v;
+        const T *y = m_values[args[1]].v;
+        for (std::size_t l = 0; l < B; ++l) {
+          value[l] = x[l] * y[l];
+          partials[0].v[l] = y[l];
+          partials[1].v[l] = x[l];
+        }
+        break;
+      }
+      case Op::Pow: {
+        const T *x = m_values[args[0]].v;
+        const T *y = m_values[args[1]].v;
+        for (std::size_t l = 0; l < B; ++l) {
+          value[l] = std::pow(x[l], y[l]);
+          const auto [dx, dy] = pow_partials(x[l], y[l], value[l]);
+          partials[0].v[l] = dx;
+          partials[1].v[l] = dy;
+        }
+        break;
+      }
+      case Op::Sum:
+      case Op::Mean: {
+        const T weight =
+            tape.ops[i] == Op::Sum ? T{1} : T{1} / static_cast<T>(arity);
+        fill(value, T{});
+        for (std::size_t k = 0; k < arity; ++k) {
+          const T *x = m_values[args[k]].v;
+          for (std::size_t l = 0; l < B; ++l) {
+            value[l] += x[l];
+          }
+          fill(partials[k].v, weight);
+        }
+        for (std::size_t l = 0; l < B; ++l) {
+          value[l] *= weight;
+        }
+        break;
+      }
+      case Op::Dot: {
+        fill(value, T{});
+        for (std::size_t k = 0; k < arity; k += 2) {
+          const T *x = m_values[args[k]].v;
+          const T *y = m_values[args[k + 1]].v;
+          for (std::size_t l = 0; l < B; ++l) {
+            value[l] += x[l] * y[l];
+            partials[k].v[l] = y[l];
+            partials[k + 1].v[l] = x[l];
+          }
+        }
+        break;
+      }
+      case Op::Norm2: {
+        fill(value, T{});
+        for (std::size_t k = 0; k < arity; ++k) {
+          const T *x = m_values[args[k]].v;
+          for (std::size_t l = 0; l < B; ++l) {
+            value[l] += x[l] * x[l];
+          }
+        }
+        Lane scale{};
+        for (std::size_t l = 0; l < B; ++l) {
+          value[l] = std::sqrt(value[l]);
+          scale.v[l] = value[l] == T{} ? T{} : T{1} / value[l];
+        }
+        for (std::size_t k = 0; k < arity; ++k) {
+          const T *x = m_values[args[k]].v;
+          for (std::size_t l = 0; l < B; ++l) {
+            partials[k].v[l] = x[l] * scale.v[l];
+          }
+        }
+        break;
+      }
+      case Op::Chain: {
+        // the steps alternate between the instruction's lane and a scratch
+        // lane, as the primitives cannot update their operand in place
+        Lane scratch = m_values[args[0]];
+        Lane step{};
+        T *x = scratch.v;
+        T *y = value;
+        fill(partials[0].v, T{1});
+        for (std::size_t s = tape.chain_offsets[i];
+             s < tape.chain_offsets[i + 1]; ++s) {
+          unary(tape.chain_ops[s], x, tape.chain_constants[s], y, step.v);
+          for (std::size_t l = 0; l < B; ++l) {
+            partials[0].v[l] *= step.v[l];
+          }
+          std::swap(x, y);
+        }
+        if (x != value) {
+          m_values[i] = scratch;
+        }
+        break;
+      }
+      default:
+        unary(tape.ops[i], m_values[args[0]].v, tape.constants[i], value,
+              partials[0].v);
+        break;
+      }
+    }
+  }
+
+  /**
+   * @brief Sweeps the adjoints of the last forward pass of all samples back to
+   * the inputs.
+   */
+  auto backward() -> void {
+    AD_TRACE_SCOPE("ad::BatchTape::backward");
+    const auto tape = m_tape.view();
+    for (auto &lane : m_adjoints) {
+      fill(lane.v, T{});
+    }
+    fill(m_adjoints[tape.output].v, T{1});
+    for (std::size_t i = tape.output + 1; i-- > 0;) {
+      const T *adjoint = m_adjoints[i].v;
+      for (std::size_t k = tape.offsets[i]; k < tape.offsets[i + 1]; ++k) {
+        T *target = m_adjoints[tape.operands[k]].v;
+        const T *partial = m_partials[k].v;
+        for (std::size_t l = 0; l < B; ++l) {
+          target[l] += adjoint[l] * partial[l];
+        }
+      }
+    }
+  }
+
+  /** @brief The value of the output for sample `t_lane` */
+  auto value(std::size_t t_lane) const noexcept -> T {
+    return m_values[m_tape.output()].v[t_lane];
+  }
+
+  /** @brief The outputs of all samples, one per lane */
+  auto values() const noexcept -> const Lane & {
+    return m_values[m_tape.output()];
+  }
+
+  /** @brief The derivative of the output of sample `t_lane` by `t_input` */
+  auto adjoint(std::size_t t_input, std::size_t t_lane) const noexcept -> T {
+    return m_adjoints[m_tape.inputs()[t_input]].v[t_lane];
+  }
+
+  /** @brief The gradient of sample `t_lane`, one entry per input */
+  auto gradient(std::size_t t_lane) const -> std::vector<T> {
+    assert(t_lane < B);
+    std::vector<T> result{};
+    result.reserve(input_count());
+    for (const auto index : m_tape.inputs()) {
+      result.push_back(m_adjoints[index].v[t_lane]);
+    }
+    return result;
+  }
+
+  /**
+   * @brief The gradient of the sum of the outputs of all samples, i.e. the
+   * per-sample gradients summed over the batch.
+   */
+  auto gradient_sum() const -> std::vector<T> {
+    std::vector<T> result{};
+    result.reserve(input_count());
+    for (const auto index : m_tape.inputs()) {
+      T sum{};
+      for (std::size_t l = 0; l < B; ++l) {
+        sum += m_adjoints[index].v[l];
+      }
+      result.push_back(sum);
+    }
+    return result;
+  }
+
+  auto size() const noexcept -> std::size_t { return m_tape.size(); }
+  auto input_count() const noexcept -> std::size_t {
+    return m_tape.input_count();
+  }
+
+private:
+  static auto fill(T *t_lane, T t_value) noexcept -> void {
+    for (std::size_t l = 0; l < B; ++l) {
+      t_lane[l] = t_value;
+    }
+  }
+
+  static auto unary(Op t_op, const T *x, T t_constant, T *t_values,
+                    T *t_partials) -> void {
+    visit_unary(t_op, [&](auto op) {
+      local_batch<decltype(op)::value>(x, t_constant, t_values, t_partials,
+                                       B);
+    });
+  }
+
+  auto broadcast_slot(std::size_t t_index, T t_value) -> void {
+    fill(m_values[t_index].v, t_value);
+  }
+
+  Tape<T> m_tape;
+  std::vector<Lane> m_values;
+  std::vector<Lane> m_partials;
+  std::vector<Lane> m_adjoints;
+};
+
+} // namespace ad
+
+#endif // __BATCHTAPE_H__
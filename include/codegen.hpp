@@ -0,0 +1,410 @@
+#ifndef __CODEGEN_H__
+#define __CODEGEN_H__
+
+#include "../include/ops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/tape.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto type_name() -> std::string {
+  if constexpr (std::is_same_v<T, float>) {
+    return "float";
+  } else if constexpr (std::is_same_v<T, double>) {
+    return "double";
+  } else {
+    return "long double";
+  }
+}
+
+/** @brief The suffix of floating-point literals of type `T` */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto literal_suffix() -> std::string {
+  if constexpr (std::is_same_v<T, float>) {
+    return "f";
+  } else if constexpr (std::is_same_v<T, long double>) {
+    return "L";
+  } else {
+    return "";
+  }
+}
+
+/**
+ * @brief Spells `t_value` as an exact C++ literal of type `T`.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto literal(T t_value) -> std::string {
+  if (std::isnan(t_value)) {
+    return "std::numeric_limits<" + type_name<T>() + ">::quiet_NaN()";
+  }
+  if (std::isinf(t_value)) {
+    return std::string(t_value < 0 ? "-" : "") + "std::numeric_limits<" +
+           type_name<T>() + ">::infinity()";
+  }
+  std::ostringstream os{};
+  os << std::hexfloat << t_value;
+  return "(" + os.str() + literal_suffix<T>() + ")";
+}
+
+/**
+ * @brief A scalar whose arithmetic spells C++ source instead of computing
+ * values, used to print the rules of `ops.hpp` into generated kernels.
+ * Constants are spelled as literals of type `T`, e.g. `3.0f`, so that calls
+ * such as `std::pow(x, 3.0f)` pick the overload the tape evaluates with.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class Code {
+public:
+  explicit Code(T t_value)
+      : m_text(t_value == std::trunc(t_value) && std::abs(t_value) < 1e6
+                   ? std::to_string(static_cast<long>(t_value)) + ".0" +
+                         literal_suffix<T>()
+                   : literal(t_value)) {
+    if (t_value < 0) {
+      m_text = "(" + m_text + ")";
+    }
+  }
+
+  /** @brief An expression spelled as `t_text` */
+  static auto verbatim(std::string t_text) -> Code {
+    Code code{T{}};
+    code.m_text = std::move(t_text);
+    return code;
+  }
+
+  auto text() const noexcept -> const std::string & { return m_text; }
+
+private:
+  std::string m_text;
+};
+
+template <typename T>
+auto operator-(const Code<T> &rhs) -> Code<T> {
+  return Code<T>::verbatim("(-" + rhs.text() + ")");
+}
+
+#define AD_CODE_OPERATOR(OP)                                                   \
+  template <typename T>                                                        \
+  auto operator OP(const Code<T> &lhs, const Code<T> &rhs)->Code<T> {          \
+    return Code<T>::verbatim("(" + lhs.text() + " " #OP " " + rhs.text() +     \
+                             ")");                                             \
+  }
+AD_CODE_OPERATOR(+)
+AD_CODE_OPERATOR(-)
+AD_CODE_OPERATOR(*)
+AD_CODE_OPERATOR(/)
+#undef AD_CODE_OPERATOR
+
+#define AD_CODE_FUNCTION(NAME)                                                 \
+  template <typename T> auto NAME(const Code<T> &x)->Code<T> {                 \
+    return Code<T>::verbatim("std::" #NAME "(" + x.text() + ")");              \
+  }
+AD_CODE_FUNCTION(abs)
+AD_CODE_FUNCTION(acos)
+AD_CODE_FUNCTION(acosh)
+AD_CODE_FUNCTION(asin)
+AD_CODE_FUNCTION(asinh)
+AD_CODE_FUNCTION(atan)
+AD_CODE_FUNCTION(atanh)
+AD_CODE_FUNCTION(cos)
+AD_CODE_FUNCTION(cosh)
+AD_CODE_FUNCTION(exp)
+AD_CODE_FUNCTION(log)
+AD_CODE_FUNCTION(sin)
+AD_CODE_FUNCTION(sinh)
+AD_CODE_FUNCTION(sqrt)
+AD_CODE_FUNCTION(tan)
+AD_CODE_FUNCTION(tanh)
+#undef AD_CODE_FUNCTION
+
+template <typename T>
+auto pow(const Code<T> &base, const Code<T> &exponent) -> Code<T> {
+  return Code<T>::verbatim("std::pow(" + base.text() + ", " + exponent.text() +
+                           ")");
+}
+
+/**
+ * @brief Spells the unary primitive `t_op` applied to the variable `x`.
+ * `v` names the value once computed, so that partials may reuse it.
+ *
+ * @return the pair (value expression, partial expression).
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto unary_expression(Op t_op, const std::string &x, const std::string &v,
+                      T t_constant) -> std::pair<std::string, std::string> {
+  const auto cx = Code<T>::verbatim(x);
+  const auto cv = Code<T>::verbatim(v);
+  const Code<T> cc{t_constant};
+  return visit_unary(t_op, [&](auto op) {
+    constexpr Op rule = decltype(op)::value;
+    return std::pair{primal<rule>(cx, cc).text(),
+                     partial<rule>(cx, cv, cc).text()};
+  });
+}
+
+/**
+ * @brief Emits a straight-line C++ function computing the output of `t_tape`
+ * and its gradient with respect to the tape inputs:
+ *
+ *     inline auto <t_name>(const T *x, T *gradient) -> T;
+ *
+ * The function contains no interpretation of op codes: every instruction that
+ * reaches the output is spelled out, with its partials inlined into the
+ * adjoint updates. Constants
+ * are emitted as exact hexadecimal literals, so the generated code matches
+ * replaying the tape.
+ */
+template <typename T, typename P,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto generate(std::ostream &os, const Tape<T, P> &t_tape,
+              const std::string &t_name) -> std::ostream & {
+  const std::string type = type_name<T>();
+  const auto v = [](std::size_t i) { return "v" + std::to_string(i); };
+  const auto step = [](std::size_t i, std::size_t s) {
+    return "v" + std::to_string(i) + "_" + std::to_string(s);
+  };
+  const auto a = [](std::size_t i) { return "a" + std::to_string(i); };
+  const std::size_t output = t_tape.output();
+
+  os << "inline auto " << t_name << "(const " << type << " *x, " << type
+     << " *gradient) -> " << type << " {\n";
+
+  std::vector<std::size_t> input_of(t_tape.size(), t_tape.size());
+  for (std::size_t j = 0; j < t_tape.inputs().size(); ++j) {
+    input_of[t_tape.inputs()[j]] = j;
+  }
+
+  // only the instructions reaching the output are emitted, and adjoints are
+  // only kept for the ones that are not constant. Folded constants do not read
+  // their operands, so those are not emitted for them.
+  std::vector<bool> live(t_tape.size(), false);
+  live[output] = true;
+  for (std::size_t i = output + 1; i-- > 0;) {
+    if (t_tape.op(i) == Op::Constant) {
+      continue;
+    }
+    const auto [first, last] = t_tape.operands(i);
+    for (auto it = first; live[i] && it != last; ++it) {
+      live[*it] = true;
+    }
+  }
+  const auto has_adjoint = [&](std::size_t i) {
+    return live[i] && t_tape.op(i) != Op::Constant;
+  };
+  const auto update = [&](std::size_t i, const char *t_op,
+                          const std::string &t_rhs) {
+    if (has_adjoint(i)) {
+      os << "  " << a(i) << " " << t_op << " " << t_rhs << ";\n";
+    }
+  };
+
+  // forward sweep
+  for (std::size_t i = 0; i <= output; ++i) {
+    if (!live[i]) {
+      continue;
+    }
+    const auto [first, last] = t_tape.operands(i);
+    const std::size_t arity = last - first;
+    const std::string lhs = "  const " + type + " ";
+
+    switch (t_tape.op(i)) {
+    case Op::Variable:
+      os << lhs << v(i) << " = x[" << input_of[i] << "];\n";
+      break;
+    case Op::Constant:
+      os << lhs << v(i) << " = " << literal(t_tape.constant(i)) << ";\n";
+      break;
+    case Op::Add:
+      os << lhs << v(i) << " = " << v(first[0]) << " + " << v(first[1])
+         << ";\n";
+      break;
+    case Op::Sub:
+      os << lhs << v(i) << " = " << v(first[0]) << " - " << v(first[1])
+         << ";\n";
+      break;
+    case Op::Mul:
+      os << lhs << v(i) << " = " << v(first[0]) << " * " << v(first[1])
+         << ";\n";
+      break;
+    case Op::Pow:
+      os << lhs << v(i) << " = std::pow(" << v(first[0]) << ", "
+         << v(first[1]) << ");\n";
+      break;
+    case Op::Sum:
+    case Op::Mean:
+    case Op::Norm2: {
+      const bool norm = t_tape.op(i) == Op::Norm2;
+      os << lhs << "s" << i << " = ";
+      for (std::size_t k = 0; k < arity; ++k) {
+        os << (k == 0 ? "" : " + ") << v(first[k]);
+        if (norm) {
+          os << " * " << v(first[k]);
+        }
+      }
+      os << (arity == 0 ? "0" : "") << ";\n";
+
+      if (t_tape.op(i) == Op::Sum) {
+        os << lhs << v(i) << " = s" << i << ";\n";
+      } else if (t_tape.op(i) == Op::Mean) {
+        os << lhs << v(i) << " = s" << i << " * "
+           << literal(T{1} / static_cast<T>(arity)) << ";\n";
+      } else {
+        os << lhs << v(i) << " = std::sqrt(s" << i << ");\n";
+        os << lhs << "r" << i << " = " << v(i) << " == 0 ? 0 : 1 / " << v(i)
+           << ";\n";
+      }
+      break;
+    }
+    case Op::Dot:
+      os << lhs << v(i) << " = ";
+      for (std::size_t k = 0; k < arity; k += 2) {
+        os << (k == 0 ? "" : " + ") << v(first[k]) << " * " << v(first[k + 1]);
+      }
+      os << (arity == 0 ? "0" : "") << ";\n";
+      break;
+    case Op::Chain: {
+      const auto steps = t_tape.chain(i);
+      for (std::size_t s = 0; s < steps.size(); ++s) {
+        const std::string x = s == 0 ? v(first[0]) : step(i, s - 1);
+        const std::string value = s + 1 == steps.size() ? v(i) : step(i, s);
+        os << lhs << value << " = "
+           << unary_expression(steps[s].first, x, value, steps[s].second)
+                  .first
+           << ";\n";
+      }
+      break;
+    }
+    default:
+      os << lhs << v(i) << " = "
+         << unary_expression(t_tape.op(i), v(first[0]), v(i),
+                             t_tape.constant(i))
+                .first
+         << ";\n";
+      break;
+    }
+  }
+
+  // reverse sweep
+  os << "\n";
+  for (std::size_t i = 0; i <= output; ++i) {
+    if (has_adjoint(i)) {
+      os << "  " << type << " " << a(i) << " = " << (i == output ? "1" : "0")
+         << ";\n";
+    }
+  }
+  for (std::size_t i = output + 1; i-- > 0;) {
+    if (!has_adjoint(i)) {
+      continue;
+    }
+    const auto [first, last] = t_tape.operands(i);
+    const std::size_t arity = last - first;
+
+    switch (t_tape.op(i)) {
+    case Op::Variable:
+      break;
+    case Op::Add:
+    case Op::Sub:
+      update(first[0], "+=", a(i));
+      update(first[1], t_tape.op(i) == Op::Add ? "+=" : "-=", a(i));
+      break;
+    case Op::Mul:
+      update(first[0], "+=", a(i) + " * " + v(first[1]));
+      update(first[1], "+=", a(i) + " * " + v(first[0]));
+      break;
+    case Op::Pow: {
+      const auto [df_base, df_exp] = pow_partials(
+          Code<T>::verbatim(v(first[0])), Code<T>::verbatim(v(first[1])),
+          Code<T>::verbatim(v(i)));
+      update(first[0], "+=", a(i) + " * " + df_base.text());
+      update(first[1], "+=", a(i) + " * " + df_exp.text());
+      break;
+    }
+    case Op::Chain: {
+      const auto steps = t_tape.chain(i);
+      std::string df{};
+      for (std::size_t s = 0; s < steps.size(); ++s) {
+        const std::string x = s == 0 ? v(first[0]) : step(i, s - 1);
+        const std::string value = s + 1 == steps.size() ? v(i) : step(i, s);
+        df += (s == 0 ? "(" : " * (") +
+              unary_expression(steps[s].first, x, value, steps[s].second)
+                  .second +
+              ")";
+      }
+      update(first[0], "+=", a(i) + " * (" + df + ")");
+      break;
+    }
+    case Op::Sum:
+      for (std::size_t k = 0; k < arity; ++k) {
+        update(first[k], "+=", a(i));
+      }
+      break;
+    case Op::Mean:
+      for (std::size_t k = 0; k < arity; ++k) {
+        update(first[k], "+=",
+               a(i) + " * " + literal(T{1} / static_cast<T>(arity)));
+      }
+      break;
+    case Op::Dot:
+      for (std::size_t k = 0; k < arity; ++k) {
+        update(first[k], "+=", a(i) + " * " + v(first[k ^ 1]));
+      }
+      break;
+    case Op::Norm2:
+      for (std::size_t k = 0; k < arity; ++k) {
+        update(first[k], "+=",
+               a(i) + " * (" + v(first[k]) + " * r" + std::to_string(i) + ")");
+      }
+      break;
+    default:
+      update(first[0], "+=",
+             a(i) + " * " +
+                 unary_expression(t_tape.op(i), v(first[0]), v(i),
+                                  t_tape.constant(i))
+                     .second);
+      break;
+    }
+  }
+
+  for (std::size_t j = 0; j < t_tape.inputs().size(); ++j) {
+    const std::size_t index = t_tape.inputs()[j];
+    os << "  gradient[" << j << "] = "
+       << (index <= output && live[index] ? a(index) : "0") << ";\n";
+  }
+  os << "  return " << v(output) << ";\n}\n";
+  return os;
+}
+
+/**
+ * @brief Emits a self-contained header holding the function produced by
+ * `generate`, suitable for the `autodiff_generate_header` CMake helper.
+ */
+template <typename T, typename P,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto write_header(std::ostream &os, const Tape<T, P> &t_tape,
+                  const std::string &t_name) -> std::ostream & {
+  os << "// Generated by ad::write_header. Do not edit.\n"
+     << "#pragma once\n\n"
+     << "#include <cmath>\n"
+     << "#include <limits>\n\n";
+  return generate(os, t_tape, t_name);
+}
+
+} // namespace ad
+
+#endif // __CODEGEN_H__
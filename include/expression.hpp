@@ -0,0 +1,453 @@
+#ifndef __EXPRESSION_H__
+#define __EXPRESSION_H__
+
+#include "../include/ops.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Expressions encoded in types, e.g.
+ * `auto f = X * sin(X) + pow(Y, 2_c)`. Every node is an empty type, so
+ * `d<X>(f)` builds the derivative as another type while compiling, simplified
+ * by the constructors below, and evaluating `f(x, y)` involves no graph.
+ * Evaluation is `constexpr` as long as the expression is rational with
+ * integral powers; the functions of the table in `ops.hpp` are evaluated
+ * through `primal` at run time.
+ *
+ * The API lives in its own namespace so that its overloads of `sin`, `pow`,
+ * ... never hide the ones of the other modes from code in `ad`.
+ */
+namespace ad::expr {
+
+struct Expr {};
+
+template <typename E> constexpr bool is_expr_v = std::is_base_of_v<Expr, E>;
+
+/**
+ * @brief Base of every node, evaluating `E::eval` with its arguments as the
+ * values of `Var<0>`, `Var<1>`, ...
+ */
+template <typename E> struct Expression : Expr {
+  template <typename... A> constexpr auto operator()(A... t_args) const {
+    using T = std::common_type_t<A...>;
+    return E::eval(std::array<T, sizeof...(A)>{static_cast<T>(t_args)...});
+  }
+};
+
+/** @brief The rational constant N / D, kept in lowest terms with D > 0 */
+template <std::intmax_t N, std::intmax_t D = 1>
+struct Const : Expression<Const<N, D>> {
+  static_assert(D > 0, "use make_const to normalize the sign");
+  static constexpr std::intmax_t num = N;
+  static constexpr std::intmax_t den = D;
+
+  template <typename T, std::size_t M>
+  static constexpr auto eval(const std::array<T, M> &) -> T {
+    return static_cast<T>(N) / static_cast<T>(D);
+  }
+};
+
+/** @brief The `I`th argument of the expression */
+template <std::size_t I> struct Var : Expression<Var<I>> {
+  template <typename T, std::size_t M>
+  static constexpr auto eval(const std::array<T, M> &x) -> T {
+    static_assert(I < M, "too few arguments for the expression");
+    return x[I];
+  }
+};
+
+template <typename E> struct Neg : Expression<Neg<E>> {
+  template <typename T, std::size_t M>
+  static constexpr auto eval(const std::array<T, M> &x) -> T {
+    return -E::eval(x);
+  }
+};
+
+#define AD_EXPR_BINARY(NAME, OP)                                               \
+  template <typename L, typename R>                                            \
+  struct NAME : Expression<NAME<L, R>> {                                       \
+    template <typename T, std::size_t M>                                       \
+    static constexpr auto eval(const std::array<T, M> &x) -> T {               \
+      return L::eval(x) OP R::eval(x);                                         \
+    }                                                                          \
+  };
+AD_EXPR_BINARY(Add, +)
+AD_EXPR_BINARY(Sub, -)
+AD_EXPR_BINARY(Mul, *)
+AD_EXPR_BINARY(Div, /)
+#undef AD_EXPR_BINARY
+
+/** @brief `E` raised to the rational power N / D */
+template <typename E, std::intmax_t N, std::intmax_t D>
+struct Pow : Expression<Pow<E, N, D>> {
+  template <typename T, std::size_t M>
+  static constexpr auto eval(const std::array<T, M> &x) -> T {
+    const T base = E::eval(x);
+    if constexpr (D == 1) {
+      T result{1};
+      for (std::intmax_t i = 0; i < (N < 0 ? -N : N); ++i) {
+        result *= base;
+      }
+      return N < 0 ? T{1} / result : result;
+    } else {
+      return std::pow(base, static_cast<T>(N) / static_cast<T>(D));
+    }
+  }
+};
+
+/** @brief The unary primitive `t_op` of the table in `ops.hpp` applied to E */
+template <Op t_op, typename E> struct Fn : Expression<Fn<t_op, E>> {
+  template <typename T, std::size_t M>
+  static constexpr auto eval(const std::array<T, M> &x) -> T {
+    return primal<t_op>(E::eval(x), T{});
+  }
+};
+
+template <typename E> struct is_const : std::false_type {};
+template <std::intmax_t N, std::intmax_t D>
+struct is_const<Const<N, D>> : std::true_type {};
+
+template <typename E, std::intmax_t N, std::intmax_t D = 1>
+constexpr bool is_value_v = false;
+template <std::intmax_t N, std::intmax_t D>
+constexpr bool is_value_v<Const<N, D>, N, D> = true;
+
+constexpr auto gcd(std::intmax_t a, std::intmax_t b) -> std::intmax_t {
+  a = a < 0 ? -a : a;
+  b = b < 0 ? -b : b;
+  while (b != 0) {
+    const std::intmax_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a == 0 ? 1 : a;
+}
+
+/** @brief The constant N / D in lowest terms */
+template <std::intmax_t N, std::intmax_t D> constexpr auto make_const() {
+  static_assert(D != 0, "division by zero in a constant expression");
+  constexpr std::intmax_t g = gcd(N, D) * (D < 0 ? -1 : 1);
+  return Const<N / g, D / g>{};
+}
+
+/**
+ * @brief Splits a node into a constant coefficient and the rest, so that like
+ * terms such as `2 * x` and `x` can be collected.
+ */
+template <typename E> struct term {
+  using coefficient = Const<1>;
+  using type = E;
+};
+template <std::intmax_t N, std::intmax_t D, typename E>
+struct term<Mul<Const<N, D>, E>> {
+  using coefficient = Const<N, D>;
+  using type = E;
+};
+template <typename E> struct term<Neg<E>> {
+  using coefficient = Const<-1>;
+  using type = E;
+};
+
+/** @brief Splits a node into a base and a constant exponent */
+template <typename E> struct power {
+  using base = E;
+  using exponent = Const<1>;
+};
+template <typename E, std::intmax_t N, std::intmax_t D>
+struct power<Pow<E, N, D>> {
+  using base = E;
+  using exponent = Const<N, D>;
+};
+
+template <typename L, typename R>
+constexpr bool like_terms_v =
+    !is_const<L>::value && !is_const<R>::value &&
+    std::is_same_v<typename term<L>::type, typename term<R>::type>;
+
+// Constructors simplifying constants, identities and like terms.
+
+template <typename L, typename R> constexpr auto mul(L, R);
+
+template <typename E, std::intmax_t N, std::intmax_t D>
+constexpr auto pow(E, Const<N, D>);
+
+template <typename E> constexpr auto neg(E) {
+  if constexpr (is_const<E>::value) {
+    return Const<-E::num, E::den>{};
+  } else {
+    return Neg<E>{};
+  }
+}
+
+template <typename E> constexpr auto neg(Neg<E>) { return E{}; }
+
+template <typename L, typename R> constexpr auto add(L, R) {
+  if constexpr (is_value_v<L, 0>) {
+    return R{};
+  } else if constexpr (is_value_v<R, 0>) {
+    return L{};
+  } else if constexpr (is_const<L>::value && is_const<R>::value) {
+    return make_const<L::num * R::den + R::num * L::den, L::den * R::den>();
+  } else if constexpr (like_terms_v<L, R>) {
+    return mul(add(typename term<L>::coefficient{},
+                   typename term<R>::coefficient{}),
+               typename term<L>::type{});
+  } else {
+    return Add<L, R>{};
+  }
+}
+
+template <typename L, typename R> constexpr auto sub(L, R) {
+  if constexpr (is_value_v<R, 0>) {
+    return L{};
+  } else if constexpr (is_value_v<L, 0>) {
+    return neg(R{});
+  } else if constexpr (is_const<L>::value && is_const<R>::value) {
+    return make_const<L::num * R::den - R::num * L::den, L::den * R::den>();
+  } else if constexpr (like_terms_v<L, R>) {
+    return mul(sub(typename term<L>::coefficient{},
+                   typename term<R>::coefficient{}),
+               typename term<L>::type{});
+  } else {
+    return Sub<L, R>{};
+  }
+}
+
+template <typename L, typename R> constexpr auto mul(L, R) {
+  if constexpr (is_value_v<L, 0> || is_value_v<R, 0>) {
+    return Const<0>{};
+  } else if constexpr (is_value_v<L, 1>) {
+    return R{};
+  } else if constexpr (is_value_v<R, 1>) {
+    return L{};
+  } else if constexpr (is_const<L>::value && is_const<R>::value) {
+    return make_const<L::num * R::num, L::den * R::den>();
+  } else if constexpr (is_const<R>::value) {
+    return mul(R{}, L{});
+  } else if constexpr (is_value_v<L, -1>) {
+    return neg(R{});
+  } else if constexpr (is_const<L>::value) {
+    return Mul<L, R>{};
+  } else if constexpr (!is_value_v<typename term<L>::coefficient, 1> ||
+                       !is_value_v<typename term<R>::coefficient, 1>) {
+    return mul(mul(typename term<L>::coefficient{},
+                   typename term<R>::coefficient{}),
+               mul(typename term<L>::type{}, typename term<R>::type{}));
+  } else if constexpr (std::is_same_v<typename power<L>::base,
+                                      typename power<R>::base>) {
+    return pow(typename power<L>::base{},
+               add(typename power<L>::exponent{},
+                   typename power<R>::exponent{}));
+  } else {
+    return Mul<L, R>{};
+  }
+}
+
+// folds the constant factors of c * (c' * e)
+template <std::intmax_t N, std::intmax_t D, std::intmax_t N2, std::intmax_t D2,
+          typename E>
+constexpr auto mul(Const<N, D>, Mul<Const<N2, D2>, E>) {
+  return mul(make_const<N * N2, D * D2>(), E{});
+}
+
+template <typename L, typename R> constexpr auto div(L, R) {
+  static_assert(!is_value_v<R, 0>, "division by zero in an expression");
+  if constexpr (is_value_v<L, 0>) {
+    return Const<0>{};
+  } else if constexpr (is_value_v<R, 1>) {
+    return L{};
+  } else if constexpr (is_const<L>::value && is_const<R>::value) {
+    return make_const<L::num * R::den, L::den * R::num>();
+  } else if constexpr (std::is_same_v<L, R>) {
+    return Const<1>{};
+  } else {
+    return Div<L, R>{};
+  }
+}
+
+template <typename E, std::intmax_t N, std::intmax_t D>
+constexpr auto pow(E, Const<N, D>) {
+  if constexpr (N == 0) {
+    return Const<1>{};
+  } else if constexpr (N == 1 && D == 1) {
+    return E{};
+  } else {
+    return Pow<E, N, D>{};
+  }
+}
+
+#define AD_EXPR_OPERATOR(OP, NAME)                                             \
+  template <typename L, typename R,                                            \
+            typename = std::enable_if_t<is_expr_v<L> && is_expr_v<R>>>         \
+  constexpr auto operator OP(L lhs, R rhs) {                                   \
+    return NAME(lhs, rhs);                                                     \
+  }
+AD_EXPR_OPERATOR(+, add)
+AD_EXPR_OPERATOR(-, sub)
+AD_EXPR_OPERATOR(*, mul)
+AD_EXPR_OPERATOR(/, div)
+#undef AD_EXPR_OPERATOR
+
+template <typename E, typename = std::enable_if_t<is_expr_v<E>>>
+constexpr auto operator-(E rhs) {
+  return neg(rhs);
+}
+
+// exp, ln, sin, ..., acsch from the table in `ops.hpp`
+#define AD_EXPR_UNARY(NAME, OP, VALUE, PARTIAL)                                \
+  template <typename E, typename = std::enable_if_t<is_expr_v<E>>>             \
+  constexpr auto NAME(E) {                                                     \
+    return Fn<Op::OP, E>{};                                                    \
+  }
+AD_UNARY_OPS(AD_EXPR_UNARY)
+#undef AD_EXPR_UNARY
+
+/** @brief Derivative of the primitive `t_op` at `e`, as an expression */
+template <Op t_op, typename E> constexpr auto outer(E e) {
+  constexpr Const<1> one{};
+  constexpr Const<2> two{};
+  constexpr Const<-1, 2> inverse_sqrt{};
+  if constexpr (t_op == Op::Exp) {
+    return exp(e);
+  } else if constexpr (t_op == Op::Ln) {
+    return one / e;
+  } else if constexpr (t_op == Op::Sin) {
+    return cos(e);
+  } else if constexpr (t_op == Op::Cos) {
+    return -sin(e);
+  } else if constexpr (t_op == Op::Tan) {
+    return one + pow(tan(e), two);
+  } else if constexpr (t_op == Op::Cot) {
+    return -(one + pow(cot(e), two));
+  } else if constexpr (t_op == Op::Sec) {
+    return sec(e) * tan(e);
+  } else if constexpr (t_op == Op::Csc) {
+    return -(csc(e) * cot(e));
+  } else if constexpr (t_op == Op::Sinh) {
+    return cosh(e);
+  } else if constexpr (t_op == Op::Cosh) {
+    return sinh(e);
+  } else if constexpr (t_op == Op::Tanh) {
+    return one - pow(tanh(e), two);
+  } else if constexpr (t_op == Op::Coth) {
+    return one - pow(coth(e), two);
+  } else if constexpr (t_op == Op::Sech) {
+    return -(sech(e) * tanh(e));
+  } else if constexpr (t_op == Op::Csch) {
+    return -(csch(e) * coth(e));
+  } else if constexpr (t_op == Op::Asin) {
+    return pow(one - pow(e, two), inverse_sqrt);
+  } else if constexpr (t_op == Op::Acos) {
+    return -pow(one - pow(e, two), inverse_sqrt);
+  } else if constexpr (t_op == Op::Atan) {
+    return one / (one + pow(e, two));
+  } else if constexpr (t_op == Op::Acot) {
+    return -(one / (one + pow(e, two)));
+  } else if constexpr (t_op == Op::Asec) {
+    // 1 / (|x| sqrt(x^2 - 1))
+    return pow(pow(e, two) * (pow(e, two) - one), inverse_sqrt);
+  } else if constexpr (t_op == Op::Acsc) {
+    return -pow(pow(e, two) * (pow(e, two) - one), inverse_sqrt);
+  } else if constexpr (t_op == Op::Asinh) {
+    return pow(pow(e, two) + one, inverse_sqrt);
+  } else if constexpr (t_op == Op::Acosh) {
+    return pow(pow(e, two) - one, inverse_sqrt);
+  } else if constexpr (t_op == Op::Atanh || t_op == Op::Acoth) {
+    return one / (one - pow(e, two));
+  } else if constexpr (t_op == Op::Asech) {
+    return -(one / (e * pow(one - pow(e, two), Const<1, 2>{})));
+  } else {
+    static_assert(t_op == Op::Acsch, "not a unary primitive of the table");
+    return -pow(pow(e, two) * (one + pow(e, two)), inverse_sqrt);
+  }
+}
+
+template <std::size_t I, typename E> constexpr auto derivative(E e);
+
+template <std::size_t I, std::size_t J> constexpr auto derivative_of(Var<J>) {
+  return Const<0>{};
+}
+
+template <std::size_t I, typename E> constexpr auto derivative_of(Neg<E>) {
+  return neg(derivative<I>(E{}));
+}
+
+template <std::size_t I, typename L, typename R>
+constexpr auto derivative_of(Add<L, R>) {
+  return add(derivative<I>(L{}), derivative<I>(R{}));
+}
+
+template <std::size_t I, typename L, typename R>
+constexpr auto derivative_of(Sub<L, R>) {
+  return sub(derivative<I>(L{}), derivative<I>(R{}));
+}
+
+template <std::size_t I, typename L, typename R>
+constexpr auto derivative_of(Mul<L, R>) {
+  return add(mul(derivative<I>(L{}), R{}), mul(L{}, derivative<I>(R{})));
+}
+
+template <std::size_t I, typename L, typename R>
+constexpr auto derivative_of(Div<L, R>) {
+  return div(sub(mul(derivative<I>(L{}), R{}), mul(L{}, derivative<I>(R{}))),
+             pow(R{}, Const<2>{}));
+}
+
+template <std::size_t I, typename E, std::intmax_t N, std::intmax_t D>
+constexpr auto derivative_of(Pow<E, N, D>) {
+  return mul(mul(make_const<N, D>(), pow(E{}, make_const<N - D, D>())),
+             derivative<I>(E{}));
+}
+
+template <std::size_t I, Op t_op, typename E>
+constexpr auto derivative_of(Fn<t_op, E>) {
+  return mul(outer<t_op>(E{}), derivative<I>(E{}));
+}
+
+/** @brief The derivative of `e` with respect to `Var<I>`, as an expression */
+template <std::size_t I, typename E> constexpr auto derivative(E e) {
+  static_assert(is_expr_v<E>, "not an expression");
+  if constexpr (is_const<E>::value) {
+    return Const<0>{};
+  } else if constexpr (std::is_same_v<E, Var<I>>) {
+    return Const<1>{};
+  } else {
+    return derivative_of<I>(e);
+  }
+}
+
+/** @brief The derivative of `f` with respect to the variable `x` */
+template <typename E, std::size_t I> constexpr auto d(E f, Var<I>) {
+  return derivative<I>(f);
+}
+
+/** @brief The derivative of `f` with respect to the variable object `V` */
+template <const auto &V, typename E> constexpr auto d(E f) { return d(f, V); }
+
+inline constexpr Var<0> X{};
+inline constexpr Var<1> Y{};
+inline constexpr Var<2> Z{};
+
+namespace literals {
+
+/** @brief Integer constants of expressions, e.g. `2_c` */
+template <char... t_digits> constexpr auto operator""_c() {
+  constexpr std::intmax_t value = [] {
+    std::intmax_t result = 0;
+    for (const char c : {t_digits...}) {
+      result = 10 * result + (c - '0');
+    }
+    return result;
+  }();
+  return Const<value>{};
+}
+
+} // namespace literals
+
+} // namespace ad::expr
+
+#endif // __EXPRESSION_H__
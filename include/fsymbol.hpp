@@ -71,7 +71,7 @@ template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
 auto operator/(const FSym<T> &lhs, const FSym<T> &rhs) -> FSym<T> {
   const T df = {(rhs.value() * lhs.dot() - lhs.value() * rhs.dot()) /
-                std::pow(rhs.value(), 2)};
+                (rhs.value() * rhs.value())};
   return {lhs.value() / rhs.value(), df};
 }
 
@@ -0,0 +1,165 @@
+#ifndef __IMPLICIT_H__
+#define __IMPLICIT_H__
+
+#include "../include/jacobian.hpp"
+#include "../include/linalg.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/trace.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/** @brief Stopping rule of the Newton iteration of `implicit_solve` */
+struct ImplicitOptions {
+  /** @brief Largest |F_i(x, p)| accepted at the solution */
+  double tolerance{1e-12};
+  std::size_t max_iterations{50};
+};
+
+/**
+ * @brief The square system x -> F(x, p) at fixed parameter values, in the
+ * single-vector form `jacobian` expects.
+ */
+template <typename F, typename T>
+auto fixed_parameters(F &f, const std::vector<T> &t_params) {
+  return [&f, &t_params](const auto &x) {
+    using S = typename std::decay_t<decltype(x)>::value_type;
+    const std::vector<S> p(t_params.begin(), t_params.end());
+    return f(x, p);
+  };
+}
+
+/** @brief The leading n x n block of `t_matrix` */
+template <typename T>
+auto leading_block(const RectMatrix<T> &t_matrix, std::size_t n)
+    -> SquareMatrix<T> {
+  SquareMatrix<T> result(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      result.at(i, j) = t_matrix.at(i, j);
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Records the solution `x` of F(x, p) = 0, found by any solver, as one
+ * node per unknown whose edges lead to the parameters. By the implicit
+ * function theorem dx/dp = -F_x^-1 F_p, with both Jacobians taken by
+ * `jacobian` at the solution and one LU solve per parameter, so the graph
+ * holds n k edges however many iterations the solver took. Throws
+ * `std::domain_error` if F_x is singular there.
+ *
+ * @param f called as `f(x, p)` with vectors of `FSym<T>` or `RSym<T>`,
+ * returning a vector of n residuals
+ */
+template <typename F, typename T>
+auto implicit_solution(F &&f, const std::vector<T> &x,
+                       const std::vector<RSym<T>> &t_params)
+    -> std::vector<RSym<T>> {
+  AD_TRACE_SCOPE("ad::implicit_solution");
+  const std::size_t n = x.size();
+  const std::size_t k = t_params.size();
+  std::vector<T> z(x);
+  for (const auto &p : t_params) {
+    z.push_back(p.value());
+  }
+
+  // one Jacobian of (x, p) -> F(x, p) gives both blocks [F_x | F_p]
+  const auto joint = [&f, n](const auto &t_z) {
+    using S = typename std::decay_t<decltype(t_z)>::value_type;
+    const std::vector<S> unknowns(t_z.begin(), t_z.begin() + n);
+    const std::vector<S> params(t_z.begin() + n, t_z.end());
+    return f(unknowns, params);
+  };
+  const auto J = jacobian(joint, z).matrix;
+  if (J.dims().first != n) {
+    throw std::invalid_argument(
+        "ad::implicit_solution: F must have one residual per unknown");
+  }
+
+  const LuFactorization<T> lu{leading_block(J, n)};
+
+  // column j of dx/dp solves F_x s = -F_p e_j
+  std::vector<std::vector<typename RSym<T>::edge_type>> edges(n);
+  for (std::size_t j = 0; j < k; ++j) {
+    std::vector<T> column(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      column[i] = -J.at(i, n + j);
+    }
+    const auto sensitivity = lu.solve(std::move(column));
+    for (std::size_t i = 0; i < n; ++i) {
+      edges[i].emplace_back(t_params[j], sensitivity[i]);
+    }
+  }
+
+  std::vector<RSym<T>> result{};
+  result.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    result.emplace_back(x[i], std::move(edges[i]));
+  }
+  return result;
+}
+
+/**
+ * @brief Solves F(x, p) = 0 for x by Newton's method from `x0` outside of
+ * any graph, then records the solution with `implicit_solution`. Each
+ * iteration takes F_x with `jacobian` and solves with `LuFactorization`.
+ * Throws `std::runtime_error` if the residual does not fall below
+ * `t_options.tolerance` within `t_options.max_iterations`.
+ */
+template <typename F, typename T>
+auto implicit_solve(F &&f, std::vector<T> x0,
+                    const std::vector<RSym<T>> &t_params,
+                    ImplicitOptions t_options = {}) -> std::vector<RSym<T>> {
+  AD_TRACE_SCOPE("ad::implicit_solve");
+  std::vector<T> params{};
+  params.reserve(t_params.size());
+  for (const auto &p : t_params) {
+    params.push_back(p.value());
+  }
+  const auto system = fixed_parameters(f, params);
+  const auto tolerance = static_cast<T>(t_options.tolerance);
+
+  for (std::size_t iteration = 0;; ++iteration) {
+    const std::vector<FSym<T>> point(x0.begin(), x0.end());
+    const auto residuals = system(point);
+    if (residuals.size() != x0.size()) {
+      throw std::invalid_argument(
+          "ad::implicit_solve: F must have one residual per unknown");
+    }
+    std::vector<T> r(residuals.size());
+    // written so that a NaN residual does not count as converged
+    bool converged = true;
+    for (std::size_t i = 0; i < residuals.size(); ++i) {
+      r[i] = -residuals[i].value();
+      if (!(std::abs(r[i]) <= tolerance)) {
+        converged = false;
+      }
+    }
+    if (converged) {
+      break;
+    }
+    if (iteration == t_options.max_iterations) {
+      throw std::runtime_error("ad::implicit_solve: no convergence");
+    }
+
+    const auto J = jacobian(system, x0, {JacobianMode::Forward}).matrix;
+    const LuFactorization<T> lu{leading_block(J, x0.size())};
+    const auto delta = lu.solve(std::move(r));
+    for (std::size_t i = 0; i < x0.size(); ++i) {
+      x0[i] += delta[i];
+    }
+  }
+  return implicit_solution(std::forward<F>(f), x0, t_params);
+}
+
+} // namespace ad
+
+#endif // __IMPLICIT_H__
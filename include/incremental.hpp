@@ -0,0 +1,267 @@
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+#include "../include/tape.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <queue>
+#include <type_traits>
+#include <vector>
+
+namespace ad {
+
+/** @brief Work done by the last `IncrementalTape::update` */
+struct IncrementalStats {
+  /** @brief Instructions evaluated again */
+  std::size_t evaluated{};
+  /** @brief Instructions whose adjoint was pushed to their operands */
+  std::size_t swept{};
+  /** @brief Whether the update fell back to full sweeps */
+  bool full{};
+};
+
+/**
+ * @brief Keeps the values, partials and adjoints of a recorded `Tape` between
+ * calls and brings them up to date after some inputs change. `update` only
+ * evaluates the instructions downstream of a changed input, stopping where a
+ * value comes out unchanged, and then sweeps back only the differences: an
+ * instruction passes on the change of its adjoint, plus, where its partials
+ * changed, the change of its adjoint times partial products. Work is thus
+ * proportional to the part of the graph the change reaches, e.g. the
+ * residuals touching a coordinate in coordinate descent.
+ *
+ * Updates that would reach more than `t_full_fraction` of the tape run both
+ * full sweeps instead, which also clears the rounding the differences
+ * accumulate; `refresh` does so on demand.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class IncrementalTape {
+public:
+  explicit IncrementalTape(const Tape<T> &t_tape, double t_full_fraction = 0.25)
+      : m_tape(t_tape), m_full_fraction(t_full_fraction),
+        m_values(t_tape.size()), m_partials(t_tape.edge_count()),
+        m_adjoints(t_tape.size()), m_changed(t_tape.size()),
+        m_queued(t_tape.size(), false), m_journal(t_tape.size(), none) {
+    for (std::size_t i = 0; i < m_values.size(); ++i) {
+      m_values[i] = m_tape.value(i);
+    }
+
+    // users of each instruction, transposed from the operand lists
+    const auto view = m_tape.view();
+    m_offsets.assign(m_values.size() + 1, 0);
+    for (std::size_t k = 0; k < m_tape.edge_count(); ++k) {
+      ++m_offsets[view.operands[k] + 1];
+    }
+    for (std::size_t i = 0; i < m_values.size(); ++i) {
+      m_offsets[i + 1] += m_offsets[i];
+    }
+    m_users.resize(m_tape.edge_count());
+    std::vector<std::size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+    for (std::size_t i = 0; i < m_values.size(); ++i) {
+      for (std::size_t k = view.offsets[i]; k < view.offsets[i + 1]; ++k) {
+        m_users[next[view.operands[k]]++] = i;
+      }
+    }
+    refresh();
+  }
+
+  /** @brief Sets input `t_input`; takes effect at the next `update` */
+  auto set(std::size_t t_input, T t_value) -> void {
+    assert(t_input < input_count());
+    const std::size_t slot = m_tape.inputs()[t_input];
+    if (m_values[slot] == t_value) {
+      return;
+    }
+    m_values[slot] = t_value;
+    enqueue_users(slot);
+    m_dirty = true;
+  }
+
+  /**
+   * @brief Brings the value and the gradient up to date with the inputs set
+   * since the last update.
+   */
+  auto update() -> void {
+    AD_TRACE_SCOPE("ad::IncrementalTape::update");
+    m_stats = {};
+    if (!m_dirty) {
+      return;
+    }
+    m_dirty = false;
+    const auto view = m_tape.view();
+    const std::size_t budget =
+        static_cast<std::size_t>(m_full_fraction * static_cast<double>(size()));
+
+    // forward: evaluate in order, keeping the previous partials
+    std::vector<std::size_t> evaluated{};
+    while (!m_forward.empty()) {
+      const std::size_t i = m_forward.top();
+      m_forward.pop();
+      m_queued[i] = false;
+      if (evaluated.size() == budget) {
+        clear_queue(m_forward);
+        restore(evaluated);
+        refresh();
+        return;
+      }
+
+      if (!fixed_partials(view.ops[i])) {
+        m_journal[i] = m_previous.size();
+        m_previous.insert(m_previous.end(),
+                          m_partials.begin() + view.offsets[i],
+                          m_partials.begin() + view.offsets[i + 1]);
+      }
+      evaluated.push_back(i);
+
+      const T before = m_values[i];
+      forward_instruction(view, i, m_values.data(), m_partials.data());
+      if (m_values[i] != before) {
+        enqueue_users(i);
+      }
+    }
+    m_stats.evaluated = evaluated.size();
+
+    // backward: propagate adjoint differences from the evaluated instructions
+    using later_first = std::priority_queue<std::size_t>;
+    later_first backward(std::less<std::size_t>{}, evaluated);
+    for (const auto i : evaluated) {
+      m_queued[i] = true;
+    }
+    while (!backward.empty()) {
+      const std::size_t i = backward.top();
+      backward.pop();
+      m_queued[i] = false;
+      ++m_stats.swept;
+
+      const T before = m_adjoints[i];
+      const T after = before + m_changed[i];
+      m_adjoints[i] = after;
+      m_changed[i] = T{};
+      const std::size_t journal = m_journal[i];
+      if (journal == none && after == before) {
+        continue;
+      }
+      const std::size_t begin = view.offsets[i];
+      for (std::size_t k = begin; k < view.offsets[i + 1]; ++k) {
+        const T previous =
+            journal == none ? m_partials[k] : m_previous[journal + k - begin];
+        const T difference = after * m_partials[k] - before * previous;
+        if (difference == T{}) {
+          continue;
+        }
+        const std::size_t operand = view.operands[k];
+        m_changed[operand] += difference;
+        if (!m_queued[operand]) {
+          m_queued[operand] = true;
+          backward.push(operand);
+        }
+      }
+    }
+
+    for (const auto i : evaluated) {
+      m_journal[i] = none;
+    }
+    m_previous.clear();
+  }
+
+  /** @brief Runs both sweeps over the whole tape */
+  auto refresh() -> void {
+    AD_TRACE_SCOPE("ad::IncrementalTape::refresh");
+    clear_queue(m_forward);
+    std::fill(m_queued.begin(), m_queued.end(), false);
+    const auto view = m_tape.view();
+    forward_sweep(view, m_values.data(), m_partials.data());
+    std::fill(m_adjoints.begin(), m_adjoints.end(), T{});
+    backward_sweep(view, m_partials.data(), m_adjoints.data());
+    m_dirty = false;
+    m_stats = {size(), size(), true};
+  }
+
+  auto value() const noexcept -> T { return m_values[m_tape.output()]; }
+
+  /** @brief The derivative of the output with respect to input `t_input` */
+  auto adjoint(std::size_t t_input) const noexcept -> T {
+    return m_adjoints[m_tape.inputs()[t_input]];
+  }
+
+  auto gradient() const -> std::vector<T> {
+    std::vector<T> result{};
+    result.reserve(input_count());
+    for (const auto slot : m_tape.inputs()) {
+      result.push_back(m_adjoints[slot]);
+    }
+    return result;
+  }
+
+  auto last_update() const noexcept -> const IncrementalStats & {
+    return m_stats;
+  }
+
+  auto size() const noexcept -> std::size_t { return m_values.size(); }
+  auto input_count() const noexcept -> std::size_t {
+    return m_tape.input_count();
+  }
+
+private:
+  static constexpr std::size_t none = static_cast<std::size_t>(-1);
+  using earlier_first =
+      std::priority_queue<std::size_t, std::vector<std::size_t>,
+                          std::greater<std::size_t>>;
+
+  /** @brief Whether the partials of `t_op` do not depend on its operands */
+  static constexpr auto fixed_partials(Op t_op) noexcept -> bool {
+    return t_op == Op::Add || t_op == Op::Sub || t_op == Op::Sum ||
+           t_op == Op::Mean;
+  }
+
+  template <typename Queue> static auto clear_queue(Queue &t_queue) -> void {
+    t_queue = Queue{};
+  }
+
+  auto enqueue_users(std::size_t t_index) -> void {
+    for (std::size_t k = m_offsets[t_index]; k < m_offsets[t_index + 1]; ++k) {
+      const std::size_t user = m_users[k];
+      if (!m_queued[user]) {
+        m_queued[user] = true;
+        m_forward.push(user);
+      }
+    }
+  }
+
+  // forgets the journal of an update abandoned for full sweeps
+  auto restore(const std::vector<std::size_t> &t_evaluated) -> void {
+    for (const auto i : t_evaluated) {
+      m_journal[i] = none;
+    }
+    m_previous.clear();
+  }
+
+  Tape<T> m_tape;
+  double m_full_fraction;
+  std::vector<T> m_values;
+  std::vector<T> m_partials;
+  std::vector<T> m_adjoints;
+  /** @brief Pending change of each adjoint during the backward update */
+  std::vector<T> m_changed;
+  std::vector<bool> m_queued;
+  /**
+   * @brief Where the previous partials of an evaluated instruction start,
+   * unless they cannot have changed
+   */
+  std::vector<std::size_t> m_journal;
+  std::vector<T> m_previous{};
+  std::vector<std::size_t> m_offsets{};
+  std::vector<std::size_t> m_users{};
+  earlier_first m_forward{};
+  bool m_dirty{};
+  IncrementalStats m_stats{};
+};
+
+} // namespace ad
+
+#endif // __INCREMENTAL_H__
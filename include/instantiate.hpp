@@ -0,0 +1,123 @@
+// The explicit instantiations of the `autodiff` library for one scalar type.
+// `autodiff.hpp` includes this file as `extern` declarations and the sources
+// of the library include it as definitions, after defining
+//   AD_EXTERN: `extern` or nothing
+//   AD_SCALAR: `float` or `double`
+// so it deliberately has no include guard. Only functions that are neither
+// inline nor constexpr are listed; `extern template` leaves those to be
+// instantiated where they are used.
+
+namespace ad {
+
+AD_EXTERN template struct FSym<AD_SCALAR>;
+AD_EXTERN template auto operator+(const FSym<AD_SCALAR> &,
+                                  const FSym<AD_SCALAR> &) -> FSym<AD_SCALAR>;
+AD_EXTERN template auto operator-(const FSym<AD_SCALAR> &,
+                                  const FSym<AD_SCALAR> &) -> FSym<AD_SCALAR>;
+AD_EXTERN template auto operator*(const FSym<AD_SCALAR> &,
+                                  const FSym<AD_SCALAR> &) -> FSym<AD_SCALAR>;
+AD_EXTERN template auto operator/(const FSym<AD_SCALAR> &,
+                                  const FSym<AD_SCALAR> &) -> FSym<AD_SCALAR>;
+
+AD_EXTERN template struct RSym<AD_SCALAR>;
+AD_EXTERN template auto operator+(const RSym<AD_SCALAR> &,
+                                  const RSym<AD_SCALAR> &) -> RSym<AD_SCALAR>;
+AD_EXTERN template auto operator-(const RSym<AD_SCALAR> &,
+                                  const RSym<AD_SCALAR> &) -> RSym<AD_SCALAR>;
+AD_EXTERN template auto operator*(const RSym<AD_SCALAR> &,
+                                  const RSym<AD_SCALAR> &) -> RSym<AD_SCALAR>;
+AD_EXTERN template auto operator/(const RSym<AD_SCALAR> &,
+                                  const RSym<AD_SCALAR> &) -> RSym<AD_SCALAR>;
+AD_EXTERN template auto sum(const std::vector<RSym<AD_SCALAR>> &)
+    -> RSym<AD_SCALAR>;
+AD_EXTERN template auto mean(const std::vector<RSym<AD_SCALAR>> &)
+    -> RSym<AD_SCALAR>;
+AD_EXTERN template auto dot(const std::vector<RSym<AD_SCALAR>> &,
+                            const std::vector<RSym<AD_SCALAR>> &)
+    -> RSym<AD_SCALAR>;
+AD_EXTERN template auto norm2(const std::vector<RSym<AD_SCALAR>> &)
+    -> RSym<AD_SCALAR>;
+
+AD_EXTERN template auto topological_order(const RSym<AD_SCALAR> &)
+    -> TopologicalOrder<AD_SCALAR>;
+AD_EXTERN template auto graph_depth(const TopologicalOrder<AD_SCALAR> &)
+    -> std::size_t;
+AD_EXTERN template auto
+backward<AD_SCALAR, AD_SCALAR>(const TopologicalOrder<AD_SCALAR> &)
+    -> std::vector<AD_SCALAR>;
+AD_EXTERN template auto select_adjoints(const TopologicalOrder<AD_SCALAR> &,
+                                        const std::vector<AD_SCALAR> &,
+                                        const std::vector<RSym<AD_SCALAR>> &)
+    -> std::vector<AD_SCALAR>;
+AD_EXTERN template auto gradient(const RSym<AD_SCALAR> &)
+    -> std::map<RSym<AD_SCALAR>, AD_SCALAR>;
+AD_EXTERN template auto
+gradient<AD_SCALAR, AD_SCALAR>(const RSym<AD_SCALAR> &,
+                               const std::vector<RSym<AD_SCALAR>> &)
+    -> std::vector<AD_SCALAR>;
+
+AD_EXTERN template auto local(Op, AD_SCALAR, AD_SCALAR)
+    -> std::pair<AD_SCALAR, AD_SCALAR>;
+
+AD_EXTERN template class Tape<AD_SCALAR>;
+AD_EXTERN template auto forward_sweep(const TapeView<AD_SCALAR, std::size_t> &,
+                                      AD_SCALAR *, AD_SCALAR *) -> void;
+AD_EXTERN template auto backward_sweep(const TapeView<AD_SCALAR, std::size_t> &,
+                                       const AD_SCALAR *, AD_SCALAR *) -> void;
+
+AD_EXTERN template auto operator+(const vector<AD_SCALAR> &,
+                                  const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR>;
+AD_EXTERN template auto operator-(const vector<AD_SCALAR> &,
+                                  const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR>;
+AD_EXTERN template auto operator*(const vector<AD_SCALAR> &,
+                                  const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR>;
+AD_EXTERN template auto operator/(const vector<AD_SCALAR> &,
+                                  const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR>;
+AD_EXTERN template auto operator+=(vector<AD_SCALAR> &,
+                                   const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR> &;
+AD_EXTERN template auto operator-=(vector<AD_SCALAR> &,
+                                   const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR> &;
+AD_EXTERN template auto operator*=(vector<AD_SCALAR> &,
+                                   const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR> &;
+AD_EXTERN template auto operator/=(vector<AD_SCALAR> &,
+                                   const vector<AD_SCALAR> &)
+    -> vector<AD_SCALAR> &;
+
+AD_EXTERN template struct SquareMatrix<AD_SCALAR>;
+AD_EXTERN template struct RectMatrix<AD_SCALAR>;
+AD_EXTERN template class LuFactorization<AD_SCALAR>;
+AD_EXTERN template class CholeskyFactorization<AD_SCALAR>;
+AD_EXTERN template class SparseMatrix<AD_SCALAR, SparseLayout::Row>;
+AD_EXTERN template class SparseMatrix<AD_SCALAR, SparseLayout::Column>;
+AD_EXTERN template auto multiply(const CsrMatrix<AD_SCALAR> &,
+                                 const std::vector<AD_SCALAR> &)
+    -> std::vector<AD_SCALAR>;
+AD_EXTERN template auto multiply_transpose(const CsrMatrix<AD_SCALAR> &,
+                                           const std::vector<AD_SCALAR> &)
+    -> std::vector<AD_SCALAR>;
+
+} // namespace ad
+
+AD_EXTERN template auto pow(const RSym<AD_SCALAR> &, const RSym<AD_SCALAR> &)
+    -> RSym<AD_SCALAR>;
+AD_EXTERN template auto pow(const RSym<AD_SCALAR> &, AD_SCALAR)
+    -> RSym<AD_SCALAR>;
+AD_EXTERN template auto pow(const FSym<AD_SCALAR> &, const FSym<AD_SCALAR> &)
+    -> FSym<AD_SCALAR>;
+AD_EXTERN template auto pow(const FSym<AD_SCALAR> &, AD_SCALAR)
+    -> FSym<AD_SCALAR>;
+
+#define AD_INSTANTIATE_UNARY(NAME, OP, VALUE, PARTIAL)                         \
+  AD_EXTERN template auto NAME(const RSym<AD_SCALAR> &) noexcept               \
+      -> RSym<AD_SCALAR>;                                                      \
+  AD_EXTERN template auto NAME(const FSym<AD_SCALAR> &) noexcept               \
+      -> FSym<AD_SCALAR>;
+AD_UNARY_OPS(AD_INSTANTIATE_UNARY)
+#undef AD_INSTANTIATE_UNARY
@@ -0,0 +1,447 @@
+#ifndef __IO_H__
+#define __IO_H__
+
+#include "../include/matrix.hpp"
+#include "../include/stream.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ad {
+
+/**
+ * @brief A file written front to back through a POSIX descriptor. Writes are
+ * gathered in a buffer of `t_capacity` bytes, except those larger than the
+ * buffer, which go to the file directly. `close` reports the errors that the
+ * destructor has to swallow.
+ */
+class FileSink {
+public:
+  explicit FileSink(const std::string &t_path,
+                    std::size_t t_capacity = std::size_t{1} << 20)
+      : m_fd(::open(t_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+        m_buffer(t_capacity) {
+    if (m_fd < 0) {
+      throw std::runtime_error("ad::FileSink: cannot open " + t_path);
+    }
+  }
+  FileSink(const FileSink &) = delete;
+  auto operator=(const FileSink &) -> FileSink & = delete;
+  ~FileSink() {
+    if (m_fd >= 0) {
+      try {
+        flush();
+      } catch (...) {
+      }
+      ::close(m_fd);
+    }
+  }
+
+  auto write(const void *t_data, std::size_t t_bytes) -> void {
+    if (m_size + t_bytes > m_buffer.size()) {
+      flush();
+    }
+    if (t_bytes >= m_buffer.size()) {
+      put(static_cast<const char *>(t_data), t_bytes);
+      return;
+    }
+    std::memcpy(m_buffer.data() + m_size, t_data, t_bytes);
+    m_size += t_bytes;
+  }
+
+  /**
+   * @brief Room for `t_bytes` bytes, at most the capacity, at the end of the
+   * buffer. The bytes filled in are kept by `commit`.
+   */
+  auto reserve(std::size_t t_bytes) -> char * {
+    assert(t_bytes <= m_buffer.size());
+    if (m_size + t_bytes > m_buffer.size()) {
+      flush();
+    }
+    return m_buffer.data() + m_size;
+  }
+
+  /** @brief Keeps the bytes of the last `reserve` up to `t_end` */
+  auto commit(char *t_end) noexcept -> void {
+    m_size = static_cast<std::size_t>(t_end - m_buffer.data());
+  }
+
+  auto flush() -> void {
+    put(m_buffer.data(), m_size);
+    m_size = 0;
+  }
+
+  /** @brief Flushes and closes the file, throwing if either fails */
+  auto close() -> void {
+    flush();
+    const int fd = m_fd;
+    m_fd = -1;
+    if (::close(fd) != 0) {
+      throw std::runtime_error("ad::FileSink: close failed");
+    }
+  }
+
+private:
+  auto put(const char *t_data, std::size_t t_bytes) -> void {
+    while (t_bytes > 0) {
+      const auto n = ::write(m_fd, t_data, t_bytes);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::runtime_error("ad::FileSink: write failed");
+      }
+      t_data += n;
+      t_bytes -= static_cast<std::size_t>(n);
+    }
+  }
+
+  int m_fd;
+  std::vector<char> m_buffer;
+  std::size_t m_size{};
+};
+
+/** @brief Most characters `std::to_chars` writes for a float or double */
+constexpr std::size_t number_chars = 32;
+
+/**
+ * @brief Writes `t_matrix` as delimited text, one row per line: CSV, or TSV
+ * with `t_delimiter` '\t'. Every value is written with the fewest digits
+ * that read back to it exactly.
+ */
+template <typename T, typename A,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto write_text(const std::string &t_path, const Matrix<T, A> &t_matrix,
+                char t_delimiter = ',') -> void {
+  AD_TRACE_SCOPE("ad::write_text");
+  FileSink sink{t_path};
+  for (auto row = t_matrix.cbegin(); row != t_matrix.cend(); ++row) {
+    for (std::size_t j = 0; j < row->size(); ++j) {
+      char *out = sink.reserve(number_chars + 1);
+      out = std::to_chars(out, out + number_chars, (*row)[j]).ptr;
+      *out++ = j + 1 == row->size() ? '\n' : t_delimiter;
+      sink.commit(out);
+    }
+  }
+  sink.close();
+}
+
+/** @brief Writes `t_values` as text, one value per line */
+template <typename T, typename A,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto write_text(const std::string &t_path, const std::vector<T, A> &t_values)
+    -> void {
+  AD_TRACE_SCOPE("ad::write_text");
+  FileSink sink{t_path};
+  for (const T value : t_values) {
+    char *out = sink.reserve(number_chars + 1);
+    out = std::to_chars(out, out + number_chars, value).ptr;
+    *out++ = '\n';
+    sink.commit(out);
+  }
+  sink.close();
+}
+
+/** @brief Rows and columns of parsed text or of an array file */
+struct ArrayShape {
+  std::size_t rows{};
+  std::size_t cols{};
+};
+
+/**
+ * @brief Parses delimited text of one row of numbers per line, appending the
+ * numbers to `t_values` in row-major order. Blank lines are skipped, as is
+ * the first line with `t_header`; every other line must hold as many numbers
+ * as the first. Spaces around the numbers are ignored. The character after
+ * the text must not continue a number, as the NUL ending a `std::string`.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto parse_text(const char *t_begin, const char *t_end, char t_delimiter,
+                bool t_header, std::vector<T> &t_values) -> ArrayShape {
+  const auto blank = [t_delimiter](char c) {
+    return c == ' ' || c == '\r' || (c == '\t' && t_delimiter != '\t');
+  };
+  const auto fail = [](const char *t_what, std::size_t t_line) {
+    return std::runtime_error(std::string("ad::parse_text: ") + t_what +
+                              " on line " + std::to_string(t_line));
+  };
+
+  ArrayShape shape{};
+  std::size_t number = 0;
+  for (const char *line = t_begin; line != t_end;) {
+    const char *eol = static_cast<const char *>(
+        std::memchr(line, '\n', static_cast<std::size_t>(t_end - line)));
+    eol = eol == nullptr ? t_end : eol;
+    const char *p = line;
+    line = eol == t_end ? t_end : eol + 1;
+    if (++number == 1 && t_header) {
+      continue;
+    }
+    while (p != eol && blank(*p)) {
+      ++p;
+    }
+    if (p == eol) {
+      continue;
+    }
+
+    std::size_t cols = 0;
+    for (;;) {
+      if (p != eol && *p == '+') {
+        ++p;
+      }
+      T value{};
+      const auto [next, error] = parse_number(p, eol, value);
+      if (error != std::errc{}) {
+        throw fail("malformed number", number);
+      }
+      t_values.push_back(value);
+      ++cols;
+      for (p = next; p != eol && blank(*p); ++p) {
+      }
+      if (p == eol) {
+        break;
+      }
+      if (*p != t_delimiter) {
+        throw fail("unexpected character", number);
+      }
+      for (++p; p != eol && blank(*p); ++p) {
+      }
+    }
+    if (shape.rows == 0) {
+      shape.cols = cols;
+    } else if (cols != shape.cols) {
+      throw fail("wrong number of columns", number);
+    }
+    ++shape.rows;
+  }
+  return shape;
+}
+
+// the whole file, read in one pass
+inline auto read_file(const std::string &t_path) -> std::string {
+  FileSource file{t_path};
+  std::string text(file.size(), '\0');
+  text.resize(file.read(text.data(), text.size()));
+  return text;
+}
+
+/** @brief Reads a matrix written by `write_text`, see `parse_text` */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto read_text(const std::string &t_path, char t_delimiter = ',',
+               bool t_header = false) -> RectMatrix<T> {
+  AD_TRACE_SCOPE("ad::read_text");
+  const std::string text = read_file(t_path);
+  std::vector<T> values{};
+  const auto shape = parse_text(text.data(), text.data() + text.size(),
+                                t_delimiter, t_header, values);
+  RectMatrix<T> result(shape.rows, shape.cols);
+  const T *row_values = values.data();
+  for (auto &row : result) {
+    std::copy(row_values, row_values + shape.cols, row.begin());
+    row_values += shape.cols;
+  }
+  return result;
+}
+
+/** @brief The numbers of a text file in row-major order, see `parse_text` */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto read_text_vector(const std::string &t_path, char t_delimiter = ',',
+                      bool t_header = false) -> std::vector<T> {
+  AD_TRACE_SCOPE("ad::read_text_vector");
+  const std::string text = read_file(t_path);
+  std::vector<T> values{};
+  parse_text(text.data(), text.data() + text.size(), t_delimiter, t_header,
+             values);
+  return values;
+}
+
+/** @brief Version of the binary array format written by `write_binary` */
+constexpr std::uint32_t array_file_version = 1;
+
+/**
+ * @brief Fixed-size header of a binary array file. It is followed by the
+ * `rows` x `cols` values in row-major order, starting 64 bytes into the
+ * file. The header and the values are little endian whatever the host.
+ */
+struct ArrayFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint8_t scalar_size;
+  std::uint8_t reserved[35];
+  std::uint64_t rows;
+  std::uint64_t cols;
+};
+static_assert(sizeof(ArrayFileHeader) == 64);
+
+constexpr char array_file_magic[8] = {'A', 'D', 'A', 'R', 'R', 'A', 'Y', '\0'};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool host_little_endian = false;
+#else
+constexpr bool host_little_endian = true;
+#endif
+
+/** @brief `t_value` in little endian byte order, or back to the host's */
+template <typename U> auto little_endian(U t_value) noexcept -> U {
+  if constexpr (!host_little_endian) {
+    unsigned char bytes[sizeof(U)];
+    std::memcpy(bytes, &t_value, sizeof(U));
+    std::reverse(bytes, bytes + sizeof(U));
+    std::memcpy(&t_value, bytes, sizeof(U));
+  }
+  return t_value;
+}
+
+// the header and the values of a binary array file
+template <typename T> class ArrayFileWriter {
+public:
+  ArrayFileWriter(const std::string &t_path, ArrayShape t_shape)
+      : m_sink(t_path) {
+    ArrayFileHeader header{};
+    std::memcpy(header.magic, array_file_magic, sizeof(header.magic));
+    header.version = little_endian(array_file_version);
+    header.scalar_size = sizeof(T);
+    header.rows = little_endian(std::uint64_t{t_shape.rows});
+    header.cols = little_endian(std::uint64_t{t_shape.cols});
+    m_sink.write(&header, sizeof(header));
+  }
+
+  auto write(const T *t_values, std::size_t t_count) -> void {
+    if constexpr (host_little_endian) {
+      m_sink.write(t_values, t_count * sizeof(T));
+    } else {
+      for (std::size_t i = 0; i < t_count; ++i) {
+        const T value = little_endian(t_values[i]);
+        m_sink.write(&value, sizeof(T));
+      }
+    }
+  }
+
+  auto close() -> void { m_sink.close(); }
+
+private:
+  FileSink m_sink;
+};
+
+/**
+ * @brief Writes `t_matrix` as a binary array file, whose values load back
+ * bit for bit with `read_binary`.
+ */
+template <typename T, typename A,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto write_binary(const std::string &t_path, const Matrix<T, A> &t_matrix)
+    -> void {
+  AD_TRACE_SCOPE("ad::write_binary");
+  const auto [rows, cols] = t_matrix.dims();
+  ArrayFileWriter<T> writer{t_path, {rows, cols}};
+  for (auto row = t_matrix.cbegin(); row != t_matrix.cend(); ++row) {
+    writer.write(row->data(), row->size());
+  }
+  writer.close();
+}
+
+/** @brief Writes `t_values` as a binary array file of one column */
+template <typename T, typename A,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto write_binary(const std::string &t_path, const std::vector<T, A> &t_values)
+    -> void {
+  AD_TRACE_SCOPE("ad::write_binary");
+  ArrayFileWriter<T> writer{t_path, {t_values.size(), 1}};
+  writer.write(t_values.data(), t_values.size());
+  writer.close();
+}
+
+/**
+ * @brief The shape of a binary array file and its values in row-major order.
+ * Throws `std::runtime_error` if the file is not an array file of `T`, or is
+ * truncated.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto read_array_file(const std::string &t_path)
+    -> std::pair<ArrayShape, std::vector<T>> {
+  AD_TRACE_SCOPE("ad::read_array_file");
+  FileSource file{t_path};
+  const std::size_t bytes = file.size();
+  ArrayFileHeader header{};
+  if (bytes < sizeof(header) ||
+      file.read(reinterpret_cast<char *>(&header), sizeof(header)) !=
+          sizeof(header)) {
+    throw std::runtime_error("ad::read_array_file: truncated " + t_path);
+  }
+  if (std::memcmp(header.magic, array_file_magic, sizeof(header.magic)) != 0 ||
+      little_endian(header.version) != array_file_version) {
+    throw std::runtime_error("ad::read_array_file: unsupported format " +
+                             t_path);
+  }
+  if (header.scalar_size != sizeof(T)) {
+    throw std::runtime_error("ad::read_array_file: precision mismatch " +
+                             t_path);
+  }
+  const std::uint64_t rows = little_endian(header.rows);
+  const std::uint64_t cols = little_endian(header.cols);
+  const std::uint64_t limit =
+      std::numeric_limits<std::size_t>::max() / sizeof(T);
+  if ((cols != 0 && rows > limit / cols) ||
+      bytes - sizeof(header) != rows * cols * sizeof(T)) {
+    throw std::runtime_error("ad::read_array_file: truncated " + t_path);
+  }
+
+  std::vector<T> values(static_cast<std::size_t>(rows * cols));
+  const std::size_t payload = values.size() * sizeof(T);
+  if (file.read(reinterpret_cast<char *>(values.data()), payload) != payload) {
+    throw std::runtime_error("ad::read_array_file: truncated " + t_path);
+  }
+  if constexpr (!host_little_endian) {
+    for (auto &value : values) {
+      value = little_endian(value);
+    }
+  }
+  const ArrayShape shape{static_cast<std::size_t>(rows),
+                         static_cast<std::size_t>(cols)};
+  return {shape, std::move(values)};
+}
+
+/** @brief Reads a matrix written by `write_binary` */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto read_binary(const std::string &t_path) -> RectMatrix<T> {
+  const auto [shape, values] = read_array_file<T>(t_path);
+  RectMatrix<T> result(shape.rows, shape.cols);
+  const T *row_values = values.data();
+  for (auto &row : result) {
+    std::copy(row_values, row_values + shape.cols, row.begin());
+    row_values += shape.cols;
+  }
+  return result;
+}
+
+/** @brief The values of a binary array file in row-major order */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto read_binary_vector(const std::string &t_path) -> std::vector<T> {
+  return read_array_file<T>(t_path).second;
+}
+
+} // namespace ad
+
+#endif // __IO_H__
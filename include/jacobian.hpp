@@ -0,0 +1,292 @@
+#ifndef __JACOBIAN_H__
+#define __JACOBIAN_H__
+
+#include "../include/forwardops.hpp"
+#include "../include/fsymbol.hpp"
+#include "../include/matrix.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/**
+ * @brief How `jacobian` computes the derivatives of f: R^n -> R^m.
+ *  - `Forward` evaluates f with `FSym` once per input (n evaluations),
+ *  - `Reverse` records f once with `RSym` and sweeps the adjoints back from
+ *    each output (m sweeps),
+ *  - `Mixed` records f once with `RSym` and sweeps tangents forward over the
+ *    recorded partials from each input (n sweeps), which pays off when
+ *    n < m but f is expensive next to a sweep,
+ *  - `Auto` picks the cheapest of these from the dimensions, or from a timing
+ *    probe when requested.
+ */
+enum class JacobianMode { Auto, Forward, Reverse, Mixed };
+
+inline auto to_string(JacobianMode t_mode) -> const char * {
+  switch (t_mode) {
+  case JacobianMode::Forward:
+    return "forward";
+  case JacobianMode::Reverse:
+    return "reverse";
+  case JacobianMode::Mixed:
+    return "mixed";
+  default:
+    return "auto";
+  }
+}
+
+struct JacobianOptions {
+  JacobianMode mode{JacobianMode::Auto};
+  /** @brief Time one evaluation of each kind instead of using the model */
+  bool probe{false};
+};
+
+/**
+ * @brief The mode `jacobian` used and the costs it was chosen by, in units of
+ * one `FSym` evaluation of f unless the costs were probed, in nanoseconds.
+ */
+struct JacobianChoice {
+  JacobianMode mode{JacobianMode::Auto};
+  std::size_t inputs{};
+  std::size_t outputs{};
+  bool probed{};
+  double forward_cost{};
+  double reverse_cost{};
+  double mixed_cost{};
+};
+
+template <typename T> struct Jacobian {
+  RectMatrix<T> matrix;
+  JacobianChoice choice;
+};
+
+/**
+ * @brief Relative costs of the model used without a probe, measured on the
+ * benchmarks of `bench/jacobian.cpp`: recording f with `RSym` costs about as
+ * much as `jacobian_record_cost` evaluations with `FSym`, and one sweep over
+ * the recorded graph about `jacobian_sweep_cost` of them.
+ */
+constexpr double jacobian_record_cost = 80.0;
+constexpr double jacobian_sweep_cost = 1.25;
+
+/**
+ * @brief A recording of f with `RSym`: the outputs joined under one root,
+ * linearized once and shared by all sweeps. The order points into the graph
+ * it owns, so it cannot be copied.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class JacobianGraph {
+public:
+  JacobianGraph(const JacobianGraph &) = delete;
+  auto operator=(const JacobianGraph &) -> JacobianGraph & = delete;
+
+  JacobianGraph(const std::vector<RSym<T>> &t_inputs,
+                const std::vector<RSym<T>> &t_outputs)
+      : m_root(join(t_outputs)), m_order(topological_order(m_root)) {
+    NodeIndex index{};
+    for (std::size_t i = 0; i < m_order.nodes.size(); ++i) {
+      index.emplace(m_order.nodes[i]->id(), i);
+    }
+    const auto position = [&index, this](const RSym<T> &t_symbol) {
+      const auto *found = index.find(t_symbol.id());
+      return found == nullptr ? m_order.nodes.size() : *found;
+    };
+    for (const auto &x : t_inputs) {
+      m_inputs.push_back(position(x));
+    }
+    for (const auto &y : t_outputs) {
+      m_outputs.push_back(position(y));
+    }
+  }
+
+  /** @brief Row `t_output` of the Jacobian, by one adjoint sweep */
+  auto reverse(std::size_t t_output, std::vector<T> &t_adjoints) const
+      -> void {
+    std::fill(t_adjoints.begin(), t_adjoints.end(), T{});
+    const std::size_t root = m_outputs[t_output];
+    t_adjoints[root] = T{1};
+    for (std::size_t i = root; i < m_order.nodes.size(); ++i) {
+      const auto &edges = m_order.nodes[i]->edges();
+      const std::size_t offset = m_order.offsets[i];
+      for (std::size_t k = 0; k < edges.size(); ++k) {
+        t_adjoints[m_order.operands[offset + k]] +=
+            t_adjoints[i] * edges[k].second;
+      }
+    }
+  }
+
+  /** @brief Column `t_input` of the Jacobian, by one tangent sweep */
+  auto forward(std::size_t t_input, std::vector<T> &t_tangents) const
+      -> void {
+    std::fill(t_tangents.begin(), t_tangents.end(), T{});
+    t_tangents[m_inputs[t_input]] = T{1};
+    for (std::size_t i = m_order.nodes.size(); i-- > 0;) {
+      const auto &edges = m_order.nodes[i]->edges();
+      const std::size_t offset = m_order.offsets[i];
+      T tangent = edges.empty() ? t_tangents[i] : T{};
+      for (std::size_t k = 0; k < edges.size(); ++k) {
+        tangent += edges[k].second * t_tangents[m_order.operands[offset + k]];
+      }
+      t_tangents[i] = tangent;
+    }
+  }
+
+  auto size() const noexcept -> std::size_t { return m_order.nodes.size(); }
+  auto outputs() const noexcept -> std::size_t { return m_outputs.size(); }
+
+  /** @brief Slot of input `t_input`, or `size()` if no output depends on it */
+  auto input(std::size_t t_input) const noexcept -> std::size_t {
+    return m_inputs[t_input];
+  }
+  auto output(std::size_t t_output) const noexcept -> std::size_t {
+    return m_outputs[t_output];
+  }
+
+private:
+  static auto join(const std::vector<RSym<T>> &t_outputs) -> RSym<T> {
+    std::vector<typename RSym<T>::edge_type> edges{};
+    T value{};
+    for (const auto &y : t_outputs) {
+      edges.emplace_back(y, T{1});
+      value += y.value();
+    }
+    return RSym<T>{Op::Sum, value, std::move(edges)};
+  }
+
+  RSym<T> m_root;
+  TopologicalOrder<T> m_order;
+  std::vector<std::size_t> m_inputs{};
+  std::vector<std::size_t> m_outputs{};
+};
+
+/**
+ * @brief Computes the Jacobian J[i][j] = d f_i / d x_j of `f` at `x`. `f` is
+ * called with a `std::vector` of `FSym<T>` or of `RSym<T>` and must return a
+ * `std::vector` of the same symbol, so a generic lambda serves every mode.
+ * Unless `t_options` fixes the mode, the first column is evaluated in forward
+ * mode to learn m, and the mode with the lowest of the costs n, R + m S and
+ * R + n S is used, where R and S are `jacobian_record_cost` and
+ * `jacobian_sweep_cost`, or the timed costs of a recording and of a sweep when
+ * `t_options.probe` is set. Probe evaluations are reused, not repeated.
+ */
+template <typename F, typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto jacobian(F &&f, const std::vector<T> &x, JacobianOptions t_options = {})
+    -> Jacobian<T> {
+  AD_TRACE_SCOPE("ad::jacobian");
+  using clock = std::chrono::steady_clock;
+  const std::size_t n = x.size();
+
+  const auto evaluate = [&f, &x](std::size_t t_input) {
+    std::vector<FSym<T>> seeded{};
+    seeded.reserve(x.size());
+    for (std::size_t j = 0; j < x.size(); ++j) {
+      seeded.emplace_back(x[j], j == t_input ? T{1} : T{});
+    }
+    return f(seeded);
+  };
+  std::optional<JacobianGraph<T>> graph{};
+  const auto record = [&f, &x, &graph]() {
+    const std::vector<RSym<T>> inputs(x.begin(), x.end());
+    graph.emplace(inputs, f(inputs));
+  };
+  const auto elapsed = [](clock::time_point t_begin) {
+    return static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() -
+                                                             t_begin)
+            .count());
+  };
+
+  JacobianChoice choice{t_options.mode, n};
+  std::optional<std::vector<FSym<T>>> first{};
+  if (choice.mode == JacobianMode::Auto) {
+    auto begin = clock::now();
+    first = evaluate(0);
+    double unit = 1.0;
+    double record_cost = jacobian_record_cost;
+    double sweep_cost = jacobian_sweep_cost;
+    choice.outputs = first->size();
+
+    if (t_options.probe && n > 0 && choice.outputs > 0) {
+      unit = elapsed(begin);
+      begin = clock::now();
+      record();
+      record_cost = elapsed(begin);
+
+      std::vector<T> work(graph->size());
+      begin = clock::now();
+      graph->reverse(0, work);
+      sweep_cost = elapsed(begin);
+      choice.probed = true;
+    }
+
+    const auto m = static_cast<double>(choice.outputs);
+    choice.forward_cost = static_cast<double>(n) * unit;
+    choice.reverse_cost = record_cost + m * sweep_cost;
+    choice.mixed_cost = record_cost + static_cast<double>(n) * sweep_cost;
+
+    choice.mode = JacobianMode::Forward;
+    if (choice.reverse_cost < choice.forward_cost &&
+        choice.reverse_cost <= choice.mixed_cost) {
+      choice.mode = JacobianMode::Reverse;
+    } else if (choice.mixed_cost < choice.forward_cost) {
+      choice.mode = JacobianMode::Mixed;
+    }
+  }
+
+  if (choice.mode == JacobianMode::Forward) {
+    if (!first) {
+      first = evaluate(0);
+    }
+    choice.outputs = first->size();
+    Jacobian<T> result{RectMatrix<T>(choice.outputs, n), choice};
+    for (std::size_t j = 0; j < n; ++j) {
+      const auto column = j == 0 ? std::move(*first) : evaluate(j);
+      for (std::size_t i = 0; i < column.size(); ++i) {
+        result.matrix.at(i, j) = column[i].dot();
+      }
+    }
+    return result;
+  }
+
+  if (!graph) {
+    record();
+  }
+  choice.outputs = graph->outputs();
+  Jacobian<T> result{RectMatrix<T>(choice.outputs, n), choice};
+  std::vector<T> work(graph->size());
+  if (choice.mode == JacobianMode::Reverse) {
+    for (std::size_t i = 0; i < choice.outputs; ++i) {
+      graph->reverse(i, work);
+      for (std::size_t j = 0; j < n; ++j) {
+        const std::size_t slot = graph->input(j);
+        result.matrix.at(i, j) = slot < work.size() ? work[slot] : T{};
+      }
+    }
+  } else {
+    for (std::size_t j = 0; j < n; ++j) {
+      if (graph->input(j) == graph->size()) {
+        continue;
+      }
+      graph->forward(j, work);
+      for (std::size_t i = 0; i < choice.outputs; ++i) {
+        result.matrix.at(i, j) = work[graph->output(i)];
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace ad
+
+#endif // __JACOBIAN_H__
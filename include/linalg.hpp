@@ -0,0 +1,454 @@
+#ifndef __LINALG_H__
+#define __LINALG_H__
+
+#include "../include/matrix.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/** @brief Columns per block of the blocked factorizations */
+constexpr std::size_t factorization_block = 64;
+
+/**
+ * @brief Copies the square matrix `t_matrix` into a contiguous row-major
+ * buffer, the layout the factorization kernels work on.
+ */
+template <typename T>
+auto packed(const Matrix<T> &t_matrix) -> std::vector<T> {
+  const auto [rows, cols] = t_matrix.dims();
+  if (rows != cols) {
+    throw std::invalid_argument("ad: factorization of a non-square matrix");
+  }
+  std::vector<T> result(rows * cols);
+  for (std::size_t i = 0; i < rows; ++i) {
+    for (std::size_t j = 0; j < cols; ++j) {
+      result[i * cols + j] = t_matrix.at(i, j);
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief LU factorization with partial pivoting, P A = L U, where L is unit
+ * lower triangular. Computed by a blocked right-looking algorithm: each panel
+ * of `factorization_block` columns is factored in place, then the trailing
+ * matrix is updated by a matrix product whose inner loop runs along
+ * contiguous rows.
+ *
+ * @tparam T
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class LuFactorization {
+public:
+  /** @brief Factors `t_matrix`, throwing `std::domain_error` if singular */
+  explicit LuFactorization(const Matrix<T> &t_matrix)
+      : m_size(t_matrix.dims().first), m_lu(packed(t_matrix)),
+        m_pivots(m_size) {
+    AD_TRACE_SCOPE("ad::LuFactorization");
+    const std::size_t n = m_size;
+    T *a = m_lu.data();
+    for (std::size_t k0 = 0; k0 < n; k0 += factorization_block) {
+      const std::size_t k1 = std::min(n, k0 + factorization_block);
+
+      // panel: columns [k0, k1) of the rows below k0, whole rows swapped
+      for (std::size_t k = k0; k < k1; ++k) {
+        std::size_t pivot = k;
+        for (std::size_t i = k + 1; i < n; ++i) {
+          if (std::abs(a[i * n + k]) > std::abs(a[pivot * n + k])) {
+            pivot = i;
+          }
+        }
+        if (a[pivot * n + k] == T{}) {
+          throw std::domain_error("ad::LuFactorization: singular matrix");
+        }
+        m_pivots[k] = pivot;
+        if (pivot != k) {
+          std::swap_ranges(a + k * n, a + (k + 1) * n, a + pivot * n);
+          m_sign = -m_sign;
+        }
+        const T inverse = T{1} / a[k * n + k];
+        for (std::size_t i = k + 1; i < n; ++i) {
+          const T l = a[i * n + k] *= inverse;
+          for (std::size_t j = k + 1; j < k1; ++j) {
+            a[i * n + j] -= l * a[k * n + j];
+          }
+        }
+      }
+
+      // U12 = L11^-1 A12, then A22 -= L21 U12
+      for (std::size_t k = k0; k < k1; ++k) {
+        for (std::size_t i = k + 1; i < k1; ++i) {
+          const T l = a[i * n + k];
+          for (std::size_t j = k1; j < n; ++j) {
+            a[i * n + j] -= l * a[k * n + j];
+          }
+        }
+      }
+      for (std::size_t i = k1; i < n; ++i) {
+        T *row = a + i * n;
+        for (std::size_t k = k0; k < k1; ++k) {
+          const T l = row[k];
+          const T *u = a + k * n;
+          for (std::size_t j = k1; j < n; ++j) {
+            row[j] -= l * u[j];
+          }
+        }
+      }
+    }
+  }
+
+  /** @brief Solves A x = b */
+  auto solve(std::vector<T> b) const -> std::vector<T> {
+    assert(b.size() == m_size);
+    const std::size_t n = m_size;
+    const T *a = m_lu.data();
+    for (std::size_t k = 0; k < n; ++k) {
+      std::swap(b[k], b[m_pivots[k]]);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      T sum = b[i];
+      for (std::size_t k = 0; k < i; ++k) {
+        sum -= a[i * n + k] * b[k];
+      }
+      b[i] = sum;
+    }
+    for (std::size_t i = n; i-- > 0;) {
+      T sum = b[i];
+      for (std::size_t k = i + 1; k < n; ++k) {
+        sum -= a[i * n + k] * b[k];
+      }
+      b[i] = sum / a[i * n + i];
+    }
+    return b;
+  }
+
+  /** @brief Solves A^T x = b, from the same factors */
+  auto solve_transpose(std::vector<T> b) const -> std::vector<T> {
+    assert(b.size() == m_size);
+    const std::size_t n = m_size;
+    const T *a = m_lu.data();
+    // U^T z = b, column-oriented so that the rows of U are read in order
+    for (std::size_t k = 0; k < n; ++k) {
+      b[k] /= a[k * n + k];
+      const T z = b[k];
+      for (std::size_t j = k + 1; j < n; ++j) {
+        b[j] -= a[k * n + j] * z;
+      }
+    }
+    // L^T w = z
+    for (std::size_t k = n; k-- > 0;) {
+      const T w = b[k];
+      for (std::size_t j = 0; j < k; ++j) {
+        b[j] -= a[k * n + j] * w;
+      }
+    }
+    for (std::size_t k = n; k-- > 0;) {
+      std::swap(b[k], b[m_pivots[k]]);
+    }
+    return b;
+  }
+
+  auto determinant() const noexcept -> T {
+    T result = m_sign;
+    for (std::size_t i = 0; i < m_size; ++i) {
+      result *= m_lu[i * m_size + i];
+    }
+    return result;
+  }
+
+  /** @brief A^-1, one solve per column */
+  auto inverse() const -> SquareMatrix<T> {
+    SquareMatrix<T> result(m_size);
+    for (std::size_t j = 0; j < m_size; ++j) {
+      std::vector<T> e(m_size, T{});
+      e[j] = T{1};
+      const auto column = solve(std::move(e));
+      for (std::size_t i = 0; i < m_size; ++i) {
+        result.at(i, j) = column[i];
+      }
+    }
+    return result;
+  }
+
+  auto size() const noexcept -> std::size_t { return m_size; }
+
+private:
+  std::size_t m_size;
+  std::vector<T> m_lu;
+  std::vector<std::size_t> m_pivots;
+  T m_sign{1};
+};
+
+/**
+ * @brief Cholesky factorization A = L L^T of a symmetric positive definite
+ * matrix, of which only the lower triangle is read. Blocked like
+ * `LuFactorization`: the trailing update is a product of rows of the current
+ * panel, which are contiguous.
+ *
+ * @tparam T
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class CholeskyFactorization {
+public:
+  /**
+   * @brief Factors `t_matrix`, throwing `std::domain_error` if it is not
+   * positive definite.
+   */
+  explicit CholeskyFactorization(const Matrix<T> &t_matrix)
+      : m_size(t_matrix.dims().first), m_l(packed(t_matrix)) {
+    AD_TRACE_SCOPE("ad::CholeskyFactorization");
+    const std::size_t n = m_size;
+    T *a = m_l.data();
+    for (std::size_t k0 = 0; k0 < n; k0 += factorization_block) {
+      const std::size_t k1 = std::min(n, k0 + factorization_block);
+
+      // the diagonal block and the panel below it, against the block only
+      for (std::size_t j = k0; j < k1; ++j) {
+        const T *lj = a + j * n;
+        T d = lj[j];
+        for (std::size_t k = k0; k < j; ++k) {
+          d -= lj[k] * lj[k];
+        }
+        if (!(d > T{})) {
+          throw std::domain_error(
+              "ad::CholeskyFactorization: matrix not positive definite");
+        }
+        a[j * n + j] = std::sqrt(d);
+        const T inverse = T{1} / a[j * n + j];
+        for (std::size_t i = j + 1; i < n; ++i) {
+          T *li = a + i * n;
+          T sum = li[j];
+          for (std::size_t k = k0; k < j; ++k) {
+            sum -= li[k] * lj[k];
+          }
+          li[j] = sum * inverse;
+        }
+      }
+
+      // A22 -= L21 L21^T on the lower triangle
+      for (std::size_t i = k1; i < n; ++i) {
+        const T *li = a + i * n;
+        for (std::size_t j = k1; j <= i; ++j) {
+          const T *lj = a + j * n;
+          T sum{};
+          for (std::size_t k = k0; k < k1; ++k) {
+            sum += li[k] * lj[k];
+          }
+          a[i * n + j] -= sum;
+        }
+      }
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      std::fill(a + i * n + i + 1, a + (i + 1) * n, T{});
+    }
+  }
+
+  /** @brief Solves A x = b */
+  auto solve(std::vector<T> b) const -> std::vector<T> {
+    assert(b.size() == m_size);
+    const std::size_t n = m_size;
+    const T *l = m_l.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      T sum = b[i];
+      for (std::size_t k = 0; k < i; ++k) {
+        sum -= l[i * n + k] * b[k];
+      }
+      b[i] = sum / l[i * n + i];
+    }
+    for (std::size_t k = n; k-- > 0;) {
+      b[k] /= l[k * n + k];
+      const T x = b[k];
+      for (std::size_t j = 0; j < k; ++j) {
+        b[j] -= l[k * n + j] * x;
+      }
+    }
+    return b;
+  }
+
+  /** @brief A is symmetric, so this is `solve` */
+  auto solve_transpose(std::vector<T> b) const -> std::vector<T> {
+    return solve(std::move(b));
+  }
+
+  /** @brief log det A = 2 sum log L_ii */
+  auto log_determinant() const noexcept -> T {
+    T result{};
+    for (std::size_t i = 0; i < m_size; ++i) {
+      result += std::log(m_l[i * m_size + i]);
+    }
+    return T{2} * result;
+  }
+
+  /** @copydoc LuFactorization::inverse */
+  auto inverse() const -> SquareMatrix<T> {
+    SquareMatrix<T> result(m_size);
+    for (std::size_t j = 0; j < m_size; ++j) {
+      std::vector<T> e(m_size, T{});
+      e[j] = T{1};
+      const auto column = solve(std::move(e));
+      for (std::size_t i = 0; i < m_size; ++i) {
+        result.at(i, j) = column[i];
+      }
+    }
+    return result;
+  }
+
+  /** @brief The factor L, zero above the diagonal */
+  auto factor(std::size_t t_row, std::size_t t_col) const noexcept -> T {
+    return m_l[t_row * m_size + t_col];
+  }
+
+  auto size() const noexcept -> std::size_t { return m_size; }
+
+private:
+  std::size_t m_size;
+  std::vector<T> m_l;
+};
+
+/** @brief Gradients of a scalar loss through x = A^-1 b */
+template <typename T> struct SolveAdjoint {
+  SquareMatrix<T> matrix;
+  std::vector<T> rhs;
+};
+
+/**
+ * @brief Reverse mode rule of x = A^-1 b given xbar = dL/dx and the
+ * factorization of A: bbar = A^-T xbar, one extra solve, and
+ * Abar = -bbar x^T.
+ */
+template <typename F, typename T>
+auto solve_adjoint(const F &t_factorization, const std::vector<T> &x,
+                   const std::vector<T> &t_adjoint) -> SolveAdjoint<T> {
+  AD_TRACE_SCOPE("ad::solve_adjoint");
+  const std::size_t n = t_factorization.size();
+  assert(x.size() == n && t_adjoint.size() == n);
+  auto rhs = t_factorization.solve_transpose(t_adjoint);
+  SquareMatrix<T> matrix(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      matrix.at(i, j) = -rhs[i] * x[j];
+    }
+  }
+  return {std::move(matrix), std::move(rhs)};
+}
+
+/**
+ * @brief Records x = A^-1 b for symbols, given the factorization of the
+ * values of A. Rather than the O(n^3) nodes of a taped elimination, the
+ * adjoint rule is recorded in two layers of n nodes each:
+ * r_i = b_i - sum_j A_ij x_j with edges 1 to b_i and -x_j to A_ij, whose
+ * adjoints are then rbar = A^-T xbar, and x_i = sum_j (A^-1)_ij r_j carrying
+ * the solution as its value. The tape holds O(n^2) edges and its backward
+ * pass costs one product with A^-T, the price of one more solve.
+ */
+template <typename F, typename T>
+auto record_solve(const F &t_factorization, const Matrix<RSym<T>> &A,
+                  const std::vector<RSym<T>> &b) -> std::vector<RSym<T>> {
+  AD_TRACE_SCOPE("ad::record_solve");
+  const std::size_t n = t_factorization.size();
+  if (b.size() != n) {
+    throw std::invalid_argument("ad: right-hand side of the wrong size");
+  }
+  std::vector<T> values(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    values[i] = b[i].value();
+  }
+  const auto x = t_factorization.solve(values);
+  const auto inverse = t_factorization.inverse();
+
+  std::vector<RSym<T>> residuals{};
+  residuals.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::vector<typename RSym<T>::edge_type> edges{};
+    edges.reserve(n + 1);
+    edges.emplace_back(b[i], T{1});
+    T residual = b[i].value();
+    for (std::size_t j = 0; j < n; ++j) {
+      edges.emplace_back(A.at(i, j), -x[j]);
+      residual -= A.at(i, j).value() * x[j];
+    }
+    residuals.emplace_back(residual, std::move(edges));
+  }
+
+  std::vector<RSym<T>> result{};
+  result.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::vector<typename RSym<T>::edge_type> edges{};
+    edges.reserve(n);
+    for (std::size_t j = 0; j < n; ++j) {
+      edges.emplace_back(residuals[j], inverse.at(i, j));
+    }
+    result.emplace_back(x[i], std::move(edges));
+  }
+  return result;
+}
+
+template <typename T>
+auto matrix_values(const Matrix<RSym<T>> &A) -> SquareMatrix<T> {
+  const auto [n, cols] = A.dims();
+  if (n != cols) {
+    throw std::invalid_argument("ad: factorization of a non-square matrix");
+  }
+  SquareMatrix<T> result(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      result.at(i, j) = A.at(i, j).value();
+    }
+  }
+  return result;
+}
+
+/** @brief x = A^-1 b for symbols, through an LU factorization */
+template <typename T>
+auto lu_solve(const Matrix<RSym<T>> &A, const std::vector<RSym<T>> &b)
+    -> std::vector<RSym<T>> {
+  return record_solve(LuFactorization<T>{matrix_values(A)}, A, b);
+}
+
+/**
+ * @brief x = A^-1 b for symbols and a symmetric positive definite A, through
+ * a Cholesky factorization. A(i, j) and A(j, i) may be distinct symbols of
+ * equal value; each receives its own share of the gradient.
+ */
+template <typename T>
+auto cholesky_solve(const Matrix<RSym<T>> &A, const std::vector<RSym<T>> &b)
+    -> std::vector<RSym<T>> {
+  return record_solve(CholeskyFactorization<T>{matrix_values(A)}, A, b);
+}
+
+/**
+ * @brief log det A for a symmetric positive definite matrix of symbols,
+ * recorded as one node whose partials are d log det A / dA_ij = (A^-1)_ji.
+ */
+template <typename T>
+auto log_determinant(const Matrix<RSym<T>> &A) -> RSym<T> {
+  const CholeskyFactorization<T> factorization{matrix_values(A)};
+  const auto inverse = factorization.inverse();
+  const std::size_t n = factorization.size();
+  std::vector<typename RSym<T>::edge_type> edges{};
+  edges.reserve(n * n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      edges.emplace_back(A.at(i, j), inverse.at(j, i));
+    }
+  }
+  return {factorization.log_determinant(), std::move(edges)};
+}
+
+} // namespace ad
+
+#endif // __LINALG_H__
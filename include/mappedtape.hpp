@@ -0,0 +1,363 @@
+#ifndef __MAPPEDTAPE_H__
+#define __MAPPEDTAPE_H__
+
+#include "../include/ops.hpp"
+#include "../include/tape.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ad {
+
+/** @brief Version of the binary tape format written by `write_tape` */
+constexpr std::uint32_t tape_file_version = 1;
+
+/**
+ * @brief Fixed-size header of a binary tape file. It is followed by the arrays
+ * of the tape, each starting on a `tape_file_alignment` boundary in the order
+ * of `TapeFileLayout`, in the byte order of the host that wrote it.
+ */
+struct TapeFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint8_t storage_size;
+  std::uint8_t index_size;
+  std::uint8_t reserved[6];
+  std::uint64_t nodes;
+  std::uint64_t edges;
+  std::uint64_t chain_steps;
+  std::uint64_t inputs;
+  std::uint64_t output;
+};
+static_assert(sizeof(TapeFileHeader) == 64);
+
+constexpr char tape_file_magic[8] = {'A', 'D', 'T', 'A', 'P', 'E', '\0', '\0'};
+constexpr std::uint32_t tape_file_byte_order = 0x01020304;
+constexpr std::size_t tape_file_alignment = 64;
+
+/**
+ * @brief Byte offsets of the arrays of a tape file from the start of the file.
+ */
+struct TapeFileLayout {
+  std::size_t ops{};
+  std::size_t constants{};
+  std::size_t offsets{};
+  std::size_t operands{};
+  std::size_t chain_offsets{};
+  std::size_t chain_ops{};
+  std::size_t chain_constants{};
+  std::size_t inputs{};
+  std::size_t end{};
+};
+
+inline auto tape_file_layout(const TapeFileHeader &t_header)
+    -> TapeFileLayout {
+  std::size_t offset = sizeof(TapeFileHeader);
+  const auto section = [&offset](std::size_t t_bytes) {
+    offset = (offset + tape_file_alignment - 1) / tape_file_alignment *
+             tape_file_alignment;
+    const std::size_t start = offset;
+    offset += t_bytes;
+    return start;
+  };
+
+  const std::size_t s = t_header.storage_size;
+  const std::size_t i = t_header.index_size;
+  TapeFileLayout layout{};
+  layout.ops = section(t_header.nodes * sizeof(Op));
+  layout.constants = section(t_header.nodes * s);
+  layout.offsets = section((t_header.nodes + 1) * i);
+  layout.operands = section(t_header.edges * i);
+  layout.chain_offsets = section((t_header.nodes + 1) * i);
+  layout.chain_ops = section(t_header.chain_steps * sizeof(Op));
+  layout.chain_constants = section(t_header.chain_steps * s);
+  layout.inputs = section(t_header.inputs * sizeof(std::uint64_t));
+  layout.end = offset;
+  return layout;
+}
+
+/**
+ * @brief Writes `t_tape` in the binary tape format, to be replayed by
+ * `MappedTape` with the same precision.
+ */
+template <typename T, typename P,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto write_tape(std::ostream &os, const Tape<T, P> &t_tape) -> std::ostream & {
+  using S = typename P::storage_type;
+  using I = typename P::index_type;
+  const auto view = t_tape.view();
+
+  TapeFileHeader header{};
+  std::memcpy(header.magic, tape_file_magic, sizeof(header.magic));
+  header.version = tape_file_version;
+  header.byte_order = tape_file_byte_order;
+  header.storage_size = sizeof(S);
+  header.index_size = sizeof(I);
+  header.nodes = view.size;
+  header.edges = t_tape.edge_count();
+  header.chain_steps = view.chain_offsets[view.size];
+  header.inputs = t_tape.input_count();
+  header.output = view.output;
+
+  std::vector<std::uint64_t> inputs(t_tape.inputs().begin(),
+                                    t_tape.inputs().end());
+  const auto layout = tape_file_layout(header);
+
+  std::size_t position = 0;
+  const auto put = [&](std::size_t t_offset, const void *t_data,
+                       std::size_t t_bytes) {
+    for (; position < t_offset; ++position) {
+      os.put('\0');
+    }
+    os.write(static_cast<const char *>(t_data),
+             static_cast<std::streamsize>(t_bytes));
+    position += t_bytes;
+  };
+
+  put(0, &header, sizeof(header));
+  put(layout.ops, view.ops, header.nodes * sizeof(Op));
+  put(layout.constants, view.constants, header.nodes * sizeof(S));
+  put(layout.offsets, view.offsets, (header.nodes + 1) * sizeof(I));
+  put(layout.operands, view.operands, header.edges * sizeof(I));
+  put(layout.chain_offsets, view.chain_offsets, (header.nodes + 1) * sizeof(I));
+  put(layout.chain_ops, view.chain_ops, header.chain_steps * sizeof(Op));
+  put(layout.chain_constants, view.chain_constants,
+      header.chain_steps * sizeof(S));
+  put(layout.inputs, inputs.data(), header.inputs * sizeof(std::uint64_t));
+  return os;
+}
+
+/**
+ * @brief A tape replayed straight from a read-only memory mapping of a file
+ * written by `write_tape`. The instruction arrays are never parsed or copied,
+ * so processes mapping the same file share its pages; only the values,
+ * partials and adjoints of a replay are private.
+ *
+ * @tparam T the scalar of the public interface
+ * @tparam P the `Precision` the file was written with
+ */
+template <typename T, typename P = Precision<T>,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class MappedTape {
+  using S = typename P::storage_type;
+  using A = typename P::adjoint_type;
+  using I = typename P::index_type;
+
+public:
+  /**
+   * @brief Maps the tape file at `t_path`. Throws `std::runtime_error` when the
+   * file cannot be mapped, is truncated, was written with another version,
+   * byte order or precision, or holds instructions that do not form a tape.
+   */
+  static auto open(const std::string &t_path) -> MappedTape {
+    const int fd = ::open(t_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("ad::MappedTape: cannot open " + t_path);
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 ||
+        static_cast<std::size_t>(info.st_size) < sizeof(TapeFileHeader)) {
+      ::close(fd);
+      throw std::runtime_error("ad::MappedTape: truncated " + t_path);
+    }
+
+    MappedTape tape{};
+    tape.m_length = static_cast<std::size_t>(info.st_size);
+    void *data = ::mmap(nullptr, tape.m_length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      throw std::runtime_error("ad::MappedTape: cannot map " + t_path);
+    }
+    tape.m_data = static_cast<const char *>(data);
+
+    TapeFileHeader header{};
+    std::memcpy(&header, tape.m_data, sizeof(header));
+    if (std::memcmp(header.magic, tape_file_magic, sizeof(header.magic)) != 0 ||
+        header.version != tape_file_version ||
+        header.byte_order != tape_file_byte_order) {
+      throw std::runtime_error("ad::MappedTape: unsupported format " + t_path);
+    }
+    if (header.storage_size != sizeof(S) || header.index_size != sizeof(I)) {
+      throw std::runtime_error("ad::MappedTape: precision mismatch " + t_path);
+    }
+    // every array holds at most one element per byte of the file, which also
+    // keeps the layout arithmetic from overflowing
+    if (header.nodes >= tape.m_length || header.edges > tape.m_length ||
+        header.chain_steps > tape.m_length || header.inputs > tape.m_length) {
+      throw std::runtime_error("ad::MappedTape: truncated " + t_path);
+    }
+    const auto layout = tape_file_layout(header);
+    if (layout.end > tape.m_length) {
+      throw std::runtime_error("ad::MappedTape: truncated " + t_path);
+    }
+
+    tape.m_view = {tape.at<Op>(layout.ops),
+                   tape.at<S>(layout.constants),
+                   tape.at<I>(layout.offsets),
+                   tape.at<I>(layout.operands),
+                   tape.at<I>(layout.chain_offsets),
+                   tape.at<Op>(layout.chain_ops),
+                   tape.at<S>(layout.chain_constants),
+                   header.nodes,
+                   header.output};
+    tape.m_inputs = tape.at<std::uint64_t>(layout.inputs);
+    tape.m_input_count = header.inputs;
+    if (!tape.valid(header)) {
+      throw std::runtime_error("ad::MappedTape: corrupt " + t_path);
+    }
+    tape.m_values.resize(header.nodes);
+    tape.m_partials.resize(header.edges);
+    return tape;
+  }
+
+  MappedTape(MappedTape &&other) noexcept { *this = std::move(other); }
+  auto operator=(MappedTape &&other) noexcept -> MappedTape & {
+    std::swap(m_data, other.m_data);
+    std::swap(m_length, other.m_length);
+    std::swap(m_view, other.m_view);
+    std::swap(m_inputs, other.m_inputs);
+    std::swap(m_input_count, other.m_input_count);
+    std::swap(m_values, other.m_values);
+    std::swap(m_partials, other.m_partials);
+    return *this;
+  }
+  MappedTape(const MappedTape &) = delete;
+  auto operator=(const MappedTape &) -> MappedTape & = delete;
+
+  ~MappedTape() {
+    if (m_data != nullptr) {
+      ::munmap(const_cast<char *>(m_data), m_length);
+    }
+  }
+
+  /** @copydoc Tape::forward */
+  auto forward(const std::vector<T> &t_inputs) -> T {
+    assert(t_inputs.size() == m_input_count);
+    for (std::size_t i = 0; i < m_input_count; ++i) {
+      m_values[m_inputs[i]] = static_cast<S>(t_inputs[i]);
+    }
+    forward_sweep(m_view, m_values.data(), m_partials.data());
+    return value();
+  }
+
+  /** @copydoc Tape::backward */
+  auto backward() const -> std::vector<T> {
+    std::vector<A> adjoints(m_view.size, A{});
+    backward_sweep(m_view, m_partials.data(), adjoints.data());
+
+    std::vector<T> result{};
+    result.reserve(m_input_count);
+    for (std::size_t i = 0; i < m_input_count; ++i) {
+      result.push_back(static_cast<T>(adjoints[m_inputs[i]]));
+    }
+    return result;
+  }
+
+  auto gradient(const std::vector<T> &t_inputs) -> std::vector<T> {
+    forward(t_inputs);
+    return backward();
+  }
+
+  auto value() const noexcept -> T {
+    return static_cast<T>(m_values[m_view.output]);
+  }
+
+  auto size() const noexcept -> std::size_t { return m_view.size; }
+  auto input_count() const noexcept -> std::size_t { return m_input_count; }
+  auto view() const noexcept -> const TapeView<S, I> & { return m_view; }
+
+private:
+  MappedTape() = default;
+
+  template <typename U> auto at(std::size_t t_offset) const -> const U * {
+    return reinterpret_cast<const U *>(m_data + t_offset);
+  }
+
+  // Whether the mapped arrays can be replayed without reading or writing out
+  // of bounds: the offsets delimit the operands and chain steps, every
+  // instruction reads as many earlier instructions as its op needs, and the
+  // inputs and the output are instructions of the tape.
+  auto valid(const TapeFileHeader &t_header) const -> bool {
+    const std::size_t n = m_view.size;
+    if (m_view.output >= n || m_view.offsets[0] != 0 ||
+        m_view.offsets[n] != t_header.edges || m_view.chain_offsets[0] != 0 ||
+        m_view.chain_offsets[n] != t_header.chain_steps) {
+      return false;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::size_t first = m_view.offsets[i];
+      const std::size_t last = m_view.offsets[i + 1];
+      if (last < first || last > t_header.edges ||
+          m_view.chain_offsets[i + 1] < m_view.chain_offsets[i] ||
+          !valid_arity(m_view.ops[i], last - first)) {
+        return false;
+      }
+      for (std::size_t k = first; k < last; ++k) {
+        if (m_view.operands[k] >= i) {
+          return false;
+        }
+      }
+    }
+    for (std::size_t s = 0; s < t_header.chain_steps; ++s) {
+      if (!is_unary(m_view.chain_ops[s])) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < m_input_count; ++i) {
+      if (m_inputs[i] >= n) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static auto valid_arity(Op t_op, std::size_t t_arity) noexcept -> bool {
+    switch (t_op) {
+    case Op::Variable:
+    case Op::Constant:
+      return t_arity == 0;
+    case Op::Add:
+    case Op::Sub:
+    case Op::Mul:
+    case Op::Pow:
+      return t_arity == 2;
+    case Op::Sum:
+    case Op::Mean:
+    case Op::Norm2:
+      return true;
+    case Op::Dot:
+      return t_arity % 2 == 0;
+    case Op::Chain:
+      return t_arity == 1;
+    default:
+      return is_unary(t_op) && t_arity == 1;
+    }
+  }
+
+  const char *m_data{};
+  std::size_t m_length{};
+  TapeView<S, I> m_view{};
+  const std::uint64_t *m_inputs{};
+  std::size_t m_input_count{};
+
+  std::vector<S> m_values{};
+  std::vector<S> m_partials{};
+};
+
+} // namespace ad
+
+#endif // __MAPPEDTAPE_H__
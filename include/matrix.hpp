@@ -1,10 +1,13 @@
 #ifndef __MATRIX_H__
 #define __MATRIX_H__
 
+#include "../include/trace.hpp"
+
 #include <algorithm>
 #include <cassert>
 #include <functional>
 #include <initializer_list>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -18,22 +21,37 @@ all_same_size(std::initializer_list<std::initializer_list<T>> t_list) -> bool {
                      [m](const auto i) { return i.size() == m; });
 }
 
-template <typename T> struct Matrix {
+template <typename T>
+constexpr auto
+all_same_length(std::initializer_list<std::initializer_list<T>> t_list)
+    -> bool {
+  return std::all_of(t_list.begin(), t_list.end(), [&t_list](const auto i) {
+    return i.size() == t_list.begin()->size();
+  });
+}
+
+/**
+ * @brief A matrix stored as rows of `std::vector<T, A>`, so that e.g.
+ * `PoolAllocator` from `allocator.hpp` backs every row with a pooled,
+ * aligned buffer.
+ */
+template <typename T, typename A = std::allocator<T>> struct Matrix {
 
 public:
-  using iterator = typename std::vector<std::vector<T>>::iterator;
-  using const_iterator = typename std::vector<std::vector<T>>::const_iterator;
+  using row_type = std::vector<T, A>;
+  using iterator = typename std::vector<row_type>::iterator;
+  using const_iterator = typename std::vector<row_type>::const_iterator;
 
 public:
   Matrix() = delete;
-  Matrix(const Matrix<T> &) = default;
-  Matrix(Matrix<T> &&) = default;
+  Matrix(const Matrix &) = default;
+  Matrix(Matrix &&) = default;
 
   Matrix(std::size_t m, std::size_t n) : m_row(m), m_col(n) {}
   virtual ~Matrix() = default;
 
-  auto operator=(const Matrix<T> &) -> Matrix<T> & = default;
-  auto operator=(Matrix<T> &&) -> Matrix<T> & = default;
+  auto operator=(const Matrix &) -> Matrix & = default;
+  auto operator=(Matrix &&) -> Matrix & = default;
 
   auto dims() const noexcept -> std::pair<std::size_t, std::size_t> {
     return {m_row, m_col};
@@ -53,18 +71,24 @@ private:
   std::size_t m_col;
 };
 
-template <typename T> struct SquareMatrix : public Matrix<T> {
+template <typename T, typename A = std::allocator<T>>
+struct SquareMatrix : public Matrix<T, A> {
 public:
-  using typename Matrix<T>::iterator;
-  using typename Matrix<T>::const_iterator;
+  using typename Matrix<T, A>::row_type;
+  using typename Matrix<T, A>::iterator;
+  using typename Matrix<T, A>::const_iterator;
 
 public:
   SquareMatrix(std::size_t m)
-      : Matrix<T>(m, m), m_matrix(m, std::vector<T>(m)) {}
+      : Matrix<T, A>(m, m), m_matrix(m, row_type(m)) {}
+
+  /** @brief An m x m matrix with every entry a copy of `t_fill` */
+  SquareMatrix(std::size_t m, const T &t_fill)
+      : Matrix<T, A>(m, m), m_matrix(m, row_type(m, t_fill)) {}
 
   SquareMatrix(std::initializer_list<std::initializer_list<T>> t_list)
-      : Matrix<T>(t_list.size(), t_list.size()),
-        m_matrix(std::vector<std::vector<T>>(t_list.begin(), t_list.end())) {
+      : Matrix<T, A>(t_list.size(), t_list.size()),
+        m_matrix(t_list.begin(), t_list.end()) {
     assert(all_same_size(t_list));
   }
 
@@ -89,22 +113,30 @@ public:
   }
 
 private:
-  std::vector<std::vector<T>> m_matrix;
+  std::vector<row_type> m_matrix;
 };
 
-template <typename T> struct RectMatrix : public Matrix<T> {
+template <typename T, typename A = std::allocator<T>>
+struct RectMatrix : public Matrix<T, A> {
 public:
-  using typename Matrix<T>::iterator;
-  using typename Matrix<T>::const_iterator;
+  using typename Matrix<T, A>::row_type;
+  using typename Matrix<T, A>::iterator;
+  using typename Matrix<T, A>::const_iterator;
 
 public:
   RectMatrix(std::size_t m, std::size_t n)
-      : Matrix<T>(m, n), m_matrix(m, std::vector<T>(n)) {}
+      : Matrix<T, A>(m, n), m_matrix(m, row_type(n)) {}
+
+  /** @brief An m x n matrix with every entry a copy of `t_fill` */
+  RectMatrix(std::size_t m, std::size_t n, const T &t_fill)
+      : Matrix<T, A>(m, n), m_matrix(m, row_type(n, t_fill)) {}
 
-  // should check if all rows are in proper size
   RectMatrix(std::initializer_list<std::initializer_list<T>> t_list)
-      : Matrix<T>(t_list.size(), t_list.size()),
-        m_matrix(std::vector<std::vector<T>>(t_list.begin(), t_list.end())) {}
+      : Matrix<T, A>(t_list.size(),
+                     t_list.size() == 0 ? 0 : t_list.begin()->size()),
+        m_matrix(t_list.begin(), t_list.end()) {
+    assert(all_same_length(t_list));
+  }
 
   auto at(std::size_t t_row, std::size_t t_col) noexcept -> T & override {
     return m_matrix[t_row][t_col];
@@ -127,33 +159,34 @@ public:
   }
 
 private:
-  std::vector<std::vector<T>> m_matrix;
+  std::vector<row_type> m_matrix;
 };
 
-template <typename T>
-constexpr auto operator+(const Matrix<T> &lhs, const Matrix<T> &rhs)
-    -> Matrix<T> {
+template <typename T, typename A>
+constexpr auto operator+(const Matrix<T, A> &lhs, const Matrix<T, A> &rhs)
+    -> Matrix<T, A> {
+  AD_TRACE_SCOPE("ad::Matrix::operator+");
 
   assert(lhs.dims() == rhs.dims());
 
-  Matrix<T> result;
+  Matrix<T, A> result;
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
                  std::begin(result), std::plus<T>());
   return result;
 }
 
-template <typename T>
-constexpr auto operator-(const Matrix<T> &lhs, const Matrix<T> &rhs)
-    -> Matrix<T>;
+template <typename T, typename A>
+constexpr auto operator-(const Matrix<T, A> &lhs, const Matrix<T, A> &rhs)
+    -> Matrix<T, A>;
 
-template <typename T>
-constexpr auto operator*(const Matrix<T> &lhs, const Matrix<T> &rhs)
-    -> Matrix<T>;
+template <typename T, typename A>
+constexpr auto operator*(const Matrix<T, A> &lhs, const Matrix<T, A> &rhs)
+    -> Matrix<T, A>;
 
-template <typename T>
-constexpr auto operator/(const Matrix<T> &lhs, const Matrix<T> &rhs)
-    -> Matrix<T>;
+template <typename T, typename A>
+constexpr auto operator/(const Matrix<T, A> &lhs, const Matrix<T, A> &rhs)
+    -> Matrix<T, A>;
 
 } // namespace ad
 
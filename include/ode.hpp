@@ -0,0 +1,503 @@
+#ifndef __ODE_H__
+#define __ODE_H__
+
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/**
+ * @brief An explicit Runge-Kutta method: stage i evaluates f at
+ * t + c_i h and y + h sum_j a_ij k_j, and the step is y + h sum_i b_i k_i.
+ * An embedded pair also carries `error` = b - b*, whose weighted slopes
+ * estimate the local error of the step.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+struct ButcherTableau {
+  std::size_t stages{};
+  /** @brief Row-major stages x stages, strictly lower triangular */
+  std::vector<T> a{};
+  std::vector<T> b{};
+  std::vector<T> c{};
+  /** @brief b - b*, empty for a fixed-step method */
+  std::vector<T> error{};
+  /** @brief Order of the step, which sets the step size controller */
+  unsigned order{};
+};
+
+/** @brief The classical fourth order method */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto classical_rk4() -> ButcherTableau<T> {
+  const T half{0.5};
+  return {4,
+          {0, 0, 0, 0, half, 0, 0, 0, 0, half, 0, 0, 0, 0, 1, 0},
+          {T{1} / 6, T{1} / 3, T{1} / 3, T{1} / 6},
+          {0, half, half, 1},
+          {},
+          4};
+}
+
+/** @brief The Dormand-Prince 5(4) pair */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto dormand_prince() -> ButcherTableau<T> {
+  return {7,
+          {0, 0, 0, 0, 0, 0, 0,
+           T{1} / 5, 0, 0, 0, 0, 0, 0,
+           T{3} / 40, T{9} / 40, 0, 0, 0, 0, 0,
+           T{44} / 45, T{-56} / 15, T{32} / 9, 0, 0, 0, 0,
+           T{19372} / 6561, T{-25360} / 2187, T{64448} / 6561, T{-212} / 729,
+           0, 0, 0,
+           T{9017} / 3168, T{-355} / 33, T{46732} / 5247, T{49} / 176,
+           T{-5103} / 18656, 0, 0,
+           T{35} / 384, 0, T{500} / 1113, T{125} / 192, T{-2187} / 6784,
+           T{11} / 84, 0},
+          {T{35} / 384, 0, T{500} / 1113, T{125} / 192, T{-2187} / 6784,
+           T{11} / 84, 0},
+          {0, T{1} / 5, T{3} / 10, T{4} / 5, T{8} / 9, 1, 1},
+          {T{71} / 57600, 0, T{-71} / 16695, T{71} / 1920, T{-17253} / 339200,
+           T{22} / 525, T{-1} / 40},
+          5};
+}
+
+/** @brief Step size control of `ode_integrate_adaptive` */
+struct OdeOptions {
+  double relative_tolerance{1e-6};
+  double absolute_tolerance{1e-9};
+  /** @brief First trial step, or 0 for 1/100 of the interval */
+  double initial_step{0};
+  std::size_t max_steps{100000};
+  /**
+   * @brief Accepted steps between the checkpoints kept for the adjoint
+   * pass, or 0 for 64
+   */
+  std::size_t checkpoint_interval{0};
+};
+
+template <typename T> struct OdeSolution {
+  std::vector<T> state;
+  std::size_t steps{};
+  std::size_t rejected{};
+};
+
+/**
+ * @brief The state at the end of the interval and the gradient of
+ * L = <adjoint, state> with respect to the initial state and the parameters.
+ */
+template <typename T> struct OdeGradient {
+  std::vector<T> state;
+  std::vector<T> initial;
+  std::vector<T> params;
+};
+
+/**
+ * @brief Steps of one Runge-Kutta method over the system y' = f(t, y, p).
+ * `f` is called as `f(t, y, p)` with `T` or with `RSym<T>` arguments and
+ * vectors, and returns a vector of the same type and size as y. The stage
+ * states of the last step are kept, so that `adjoint_step` can pull an
+ * adjoint back through it with one vector-Jacobian product of f per stage.
+ */
+template <typename T, typename F,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class RungeKutta {
+public:
+  RungeKutta(F &f, ButcherTableau<T> t_tableau, const std::vector<T> &t_params,
+             std::size_t t_size, OdeOptions t_options = {})
+      : m_f(f), m_tableau(std::move(t_tableau)), m_params(t_params),
+        m_options(t_options),
+        m_inputs(m_tableau.stages, std::vector<T>(t_size)),
+        m_slopes(m_tableau.stages), m_adjoints(m_tableau.stages),
+        m_next(t_size) {}
+
+  /**
+   * @brief Takes a step of size `h` from (`t`, `y`) into `next()`.
+   *
+   * @return the weighted RMS norm of the local error estimate, 0 without an
+   * embedded pair
+   */
+  auto step(T t, const std::vector<T> &y, T h) -> T {
+    const std::size_t s = m_tableau.stages;
+    for (std::size_t i = 0; i < s; ++i) {
+      auto &input = m_inputs[i];
+      std::copy(y.begin(), y.end(), input.begin());
+      for (std::size_t j = 0; j < i; ++j) {
+        axpy(h * m_tableau.a[i * s + j], m_slopes[j], input);
+      }
+      m_slopes[i] = m_f(t + m_tableau.c[i] * h, input, m_params);
+      if (m_slopes[i].size() != y.size()) {
+        throw std::invalid_argument(
+            "ad::RungeKutta: f must return one slope per state");
+      }
+    }
+
+    std::copy(y.begin(), y.end(), m_next.begin());
+    for (std::size_t i = 0; i < s; ++i) {
+      axpy(h * m_tableau.b[i], m_slopes[i], m_next);
+    }
+    if (m_tableau.error.empty() || y.empty()) {
+      return T{};
+    }
+
+    const auto rtol = static_cast<T>(m_options.relative_tolerance);
+    const auto atol = static_cast<T>(m_options.absolute_tolerance);
+    T sum{};
+    for (std::size_t k = 0; k < y.size(); ++k) {
+      T estimate{};
+      for (std::size_t i = 0; i < s; ++i) {
+        estimate += m_tableau.error[i] * m_slopes[i][k];
+      }
+      const T scale =
+          atol + rtol * std::max(std::abs(y[k]), std::abs(m_next[k]));
+      const T ratio = h * estimate / scale;
+      sum += ratio * ratio;
+    }
+    return std::sqrt(sum / static_cast<T>(y.size()));
+  }
+
+  auto next() const noexcept -> const std::vector<T> & { return m_next; }
+
+  /**
+   * @brief Replaces `t_adjoint`, the adjoint of the state after the step of
+   * size `h` from (`t`, `y`), by the adjoint of `y`, and adds the adjoint of
+   * the parameters to `t_params`. The step is repeated to restore its stage
+   * states, then the stages are pulled back last to first, each by recording
+   * f with `RSym` and one reverse sweep.
+   */
+  auto adjoint_step(T t, const std::vector<T> &y, T h,
+                    std::vector<T> &t_adjoint, std::vector<T> &t_params)
+      -> void {
+    step(t, y, h);
+    const std::size_t s = m_tableau.stages;
+    std::vector<T> weights(y.size());
+    for (std::size_t i = s; i-- > 0;) {
+      bool zero = true;
+      for (std::size_t k = 0; k < y.size(); ++k) {
+        T w = h * m_tableau.b[i] * t_adjoint[k];
+        for (std::size_t j = i + 1; j < s; ++j) {
+          if (!m_adjoints[j].empty()) {
+            w += h * m_tableau.a[j * s + i] * m_adjoints[j][k];
+          }
+        }
+        weights[k] = w;
+        zero = zero && w == T{};
+      }
+      m_adjoints[i].clear();
+      if (!zero) {
+        vjp(t + m_tableau.c[i] * h, m_inputs[i], weights, m_adjoints[i],
+            t_params);
+      }
+    }
+    for (std::size_t i = 0; i < s; ++i) {
+      if (!m_adjoints[i].empty()) {
+        axpy(T{1}, m_adjoints[i], t_adjoint);
+      }
+    }
+  }
+
+  auto options() const noexcept -> const OdeOptions & { return m_options; }
+  auto tableau() const noexcept -> const ButcherTableau<T> & {
+    return m_tableau;
+  }
+
+private:
+  static auto axpy(T t_alpha, const std::vector<T> &x, std::vector<T> &y)
+      -> void {
+    if (t_alpha == T{}) {
+      return;
+    }
+    for (std::size_t k = 0; k < y.size(); ++k) {
+      y[k] += t_alpha * x[k];
+    }
+  }
+
+  /** @brief `t_state` = w^T f_y and `t_params` += w^T f_p at (t, y) */
+  auto vjp(T t, const std::vector<T> &y, const std::vector<T> &w,
+           std::vector<T> &t_state, std::vector<T> &t_params) -> void {
+    std::vector<RSym<T>> inputs(y.begin(), y.end());
+    const std::vector<RSym<T>> params(m_params.begin(), m_params.end());
+    const auto slopes = m_f(RSym<T>{t}, inputs, params);
+
+    std::vector<typename RSym<T>::edge_type> edges{};
+    edges.reserve(slopes.size());
+    T value{};
+    for (std::size_t k = 0; k < slopes.size(); ++k) {
+      edges.emplace_back(slopes[k], w[k]);
+      value += w[k] * slopes[k].value();
+    }
+    const RSym<T> root{Op::Sum, value, std::move(edges)};
+
+    inputs.insert(inputs.end(), params.begin(), params.end());
+    const auto adjoints = gradient(root, inputs);
+    t_state.assign(adjoints.begin(), adjoints.begin() + y.size());
+    for (std::size_t j = 0; j < t_params.size(); ++j) {
+      t_params[j] += adjoints[y.size() + j];
+    }
+  }
+
+  F &m_f;
+  ButcherTableau<T> m_tableau;
+  std::vector<T> m_params;
+  OdeOptions m_options;
+  std::vector<std::vector<T>> m_inputs;
+  std::vector<std::vector<T>> m_slopes;
+  std::vector<std::vector<T>> m_adjoints;
+  std::vector<T> m_next;
+};
+
+/**
+ * @brief Integrates y' = f(t, y, p) from `t0` to `t1` with `steps` steps of
+ * the classical fourth order method.
+ */
+template <typename F, typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto ode_integrate(F &&f, std::vector<T> y0, const std::vector<T> &t_params,
+                   T t0, T t1, std::size_t steps) -> std::vector<T> {
+  AD_TRACE_SCOPE("ad::ode_integrate");
+  RungeKutta<T, std::remove_reference_t<F>> method{f, classical_rk4<T>(),
+                                                   t_params, y0.size()};
+  const T h = (t1 - t0) / static_cast<T>(steps);
+  for (std::size_t i = 0; i < steps; ++i) {
+    method.step(t0 + static_cast<T>(i) * h, y0, h);
+    y0 = method.next();
+  }
+  return y0;
+}
+
+/**
+ * @brief Steps `t_method` from (`t`, `y`) with the step size controller until
+ * `t_accepted` steps are accepted or `t1` is reached, calling
+ * `on_step(t, y, h)` before each accepted step. `t`, `y` and the next trial
+ * step `h` are advanced in place, so the walk can be resumed from any point
+ * it passed and repeats the same steps.
+ */
+template <typename T, typename F, typename OnStep>
+auto ode_walk(RungeKutta<T, F> &t_method, T &t, std::vector<T> &y, T &h, T t1,
+              std::size_t t_accepted, OdeSolution<T> &t_solution,
+              OnStep &&on_step) -> void {
+  const T order = static_cast<T>(t_method.tableau().order);
+  const T span = t1 - t;
+  for (std::size_t accepted = 0; accepted < t_accepted && t < t1;) {
+    const std::size_t trials = t_solution.steps + t_solution.rejected;
+    if (trials >= t_method.options().max_steps) {
+      throw std::runtime_error("ad::ode_integrate_adaptive: too many steps");
+    }
+    const bool last = t1 - t <= h;
+    const T step = last ? t1 - t : h;
+    const T error = t_method.step(t, y, step);
+    const T factor =
+        error == T{} ? T{5}
+                     : std::clamp(T{0.9} * std::pow(error, T{-1} / order),
+                                  T{0.2}, T{5});
+    if (error <= T{1}) {
+      on_step(t, y, step);
+      y = t_method.next();
+      t = last ? t1 : t + step;
+      ++t_solution.steps;
+      ++accepted;
+    } else {
+      ++t_solution.rejected;
+      if (step <= span * std::numeric_limits<T>::epsilon()) {
+        throw std::runtime_error("ad::ode_integrate_adaptive: step underflow");
+      }
+    }
+    h = step * factor;
+  }
+}
+
+/**
+ * @brief Integrates y' = f(t, y, p) from `t0` to `t1` with the Dormand-Prince
+ * pair, choosing each step so that the local error estimate stays within
+ * the tolerances of `t_options`. Throws `std::runtime_error` if
+ * `t_options.max_steps` trial steps do not reach `t1`.
+ */
+template <typename F, typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto ode_integrate_adaptive(F &&f, std::vector<T> y0,
+                            const std::vector<T> &t_params, T t0, T t1,
+                            OdeOptions t_options = {}) -> OdeSolution<T> {
+  AD_TRACE_SCOPE("ad::ode_integrate_adaptive");
+  RungeKutta<T, std::remove_reference_t<F>> method{
+      f, dormand_prince<T>(), t_params, y0.size(), t_options};
+  OdeSolution<T> solution{};
+  T h = t_options.initial_step > 0 ? static_cast<T>(t_options.initial_step)
+                                   : (t1 - t0) / T{100};
+  ode_walk(method, t0, y0, h, t1, static_cast<std::size_t>(-1), solution,
+           [](T, const std::vector<T> &, T) {});
+  solution.state = std::move(y0);
+  return solution;
+}
+
+/**
+ * @brief Integrates y' = f(t, y, p) like `ode_integrate` and computes the
+ * gradient of L = <`t_adjoint`, y(t1)> with respect to y0 and p by the
+ * discrete adjoint method: the adjoint is pulled back through the steps in
+ * reverse order, one vector-Jacobian product of f per stage. Only every
+ * `t_interval`-th state is kept during the forward pass (sqrt(steps) if 0);
+ * the states in between are recomputed one segment at a time, so memory is
+ * O(sqrt(steps)) states and the cost two forward passes and one adjoint pass.
+ */
+template <typename F, typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto ode_adjoint(F &&f, const std::vector<T> &y0,
+                 const std::vector<T> &t_params, T t0, T t1,
+                 std::size_t steps, const std::vector<T> &t_adjoint,
+                 std::size_t t_interval = 0) -> OdeGradient<T> {
+  AD_TRACE_SCOPE("ad::ode_adjoint");
+  assert(t_adjoint.size() == y0.size());
+  RungeKutta<T, std::remove_reference_t<F>> method{f, classical_rk4<T>(),
+                                                   t_params, y0.size()};
+  const T h = (t1 - t0) / static_cast<T>(steps);
+  const std::size_t interval =
+      t_interval > 0
+          ? t_interval
+          : std::max<std::size_t>(
+                1, static_cast<std::size_t>(
+                       std::ceil(std::sqrt(static_cast<double>(steps)))));
+
+  std::vector<std::vector<T>> checkpoints{};
+  std::vector<T> y(y0);
+  for (std::size_t i = 0; i < steps; ++i) {
+    if (i % interval == 0) {
+      checkpoints.push_back(y);
+    }
+    method.step(t0 + static_cast<T>(i) * h, y, h);
+    y = method.next();
+  }
+
+  OdeGradient<T> result{std::move(y), t_adjoint,
+                        std::vector<T>(t_params.size())};
+  std::vector<std::vector<T>> segment{};
+  for (std::size_t c = checkpoints.size(); c-- > 0;) {
+    const std::size_t begin = c * interval;
+    const std::size_t end = std::min(begin + interval, steps);
+    segment.resize(end - begin);
+    segment[0] = std::move(checkpoints[c]);
+    for (std::size_t i = begin + 1; i < end; ++i) {
+      method.step(t0 + static_cast<T>(i - 1) * h, segment[i - 1 - begin], h);
+      segment[i - begin] = method.next();
+    }
+    for (std::size_t i = end; i-- > begin;) {
+      method.adjoint_step(t0 + static_cast<T>(i) * h, segment[i - begin], h,
+                          result.initial, result.params);
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Integrates y' = f(t, y, p) like `ode_integrate_adaptive` and
+ * computes the gradient of L = <`t_adjoint`, y(t1)> with respect to y0 and p
+ * through the accepted steps, as `ode_adjoint` does. The step sizes are
+ * treated as constants. Each checkpoint keeps the time, state and trial step
+ * after every `t_options.checkpoint_interval` accepted steps, from which the
+ * controller retakes the same steps during the adjoint pass.
+ */
+template <typename F, typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto ode_adjoint_adaptive(F &&f, const std::vector<T> &y0,
+                          const std::vector<T> &t_params, T t0, T t1,
+                          const std::vector<T> &t_adjoint,
+                          OdeOptions t_options = {}) -> OdeGradient<T> {
+  AD_TRACE_SCOPE("ad::ode_adjoint_adaptive");
+  assert(t_adjoint.size() == y0.size());
+  RungeKutta<T, std::remove_reference_t<F>> method{
+      f, dormand_prince<T>(), t_params, y0.size(), t_options};
+  const std::size_t interval = t_options.checkpoint_interval > 0
+                                   ? t_options.checkpoint_interval
+                                   : std::size_t{64};
+  const auto skip = [](T, const std::vector<T> &, T) {};
+
+  struct Checkpoint {
+    T t;
+    std::vector<T> y;
+    T h;
+  };
+  std::vector<Checkpoint> checkpoints{};
+  OdeSolution<T> solution{};
+  T t = t0;
+  std::vector<T> y(y0);
+  T h = t_options.initial_step > 0 ? static_cast<T>(t_options.initial_step)
+                                   : (t1 - t0) / T{100};
+  while (t < t1) {
+    checkpoints.push_back({t, y, h});
+    ode_walk(method, t, y, h, t1, interval, solution, skip);
+  }
+
+  OdeGradient<T> result{std::move(y), t_adjoint,
+                        std::vector<T>(t_params.size())};
+  std::vector<Checkpoint> segment{};
+  for (std::size_t c = checkpoints.size(); c-- > 0;) {
+    auto &checkpoint = checkpoints[c];
+    segment.clear();
+    OdeSolution<T> replay{};
+    ode_walk(method, checkpoint.t, checkpoint.y, checkpoint.h, t1, interval,
+             replay, [&segment](T t_time, const std::vector<T> &t_state,
+                                T t_step) {
+               segment.push_back({t_time, t_state, t_step});
+             });
+    for (std::size_t i = segment.size(); i-- > 0;) {
+      method.adjoint_step(segment[i].t, segment[i].y, segment[i].h,
+                          result.initial, result.params);
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Records y(t1) of `ode_integrate` as one node per state whose edges
+ * lead to the initial state and the parameters. The Jacobian is taken by one
+ * `ode_adjoint` pass per state, so the graph holds n (n + k) edges however
+ * many steps were taken.
+ */
+template <typename F, typename T>
+auto ode_solution(F &&f, const std::vector<RSym<T>> &y0,
+                  const std::vector<RSym<T>> &t_params, T t0, T t1,
+                  std::size_t steps) -> std::vector<RSym<T>> {
+  AD_TRACE_SCOPE("ad::ode_solution");
+  const auto values = [](const std::vector<RSym<T>> &t_symbols) {
+    std::vector<T> result{};
+    result.reserve(t_symbols.size());
+    for (const auto &symbol : t_symbols) {
+      result.push_back(symbol.value());
+    }
+    return result;
+  };
+  const auto initial = values(y0);
+  const auto params = values(t_params);
+  const std::size_t n = y0.size();
+
+  std::vector<RSym<T>> result{};
+  result.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    std::vector<T> seed(n);
+    seed[i] = T{1};
+    const auto adjoint = ode_adjoint(f, initial, params, t0, t1, steps, seed);
+    std::vector<typename RSym<T>::edge_type> edges{};
+    edges.reserve(n + params.size());
+    for (std::size_t j = 0; j < n; ++j) {
+      edges.emplace_back(y0[j], adjoint.initial[j]);
+    }
+    for (std::size_t j = 0; j < params.size(); ++j) {
+      edges.emplace_back(t_params[j], adjoint.params[j]);
+    }
+    result.emplace_back(adjoint.state[i], std::move(edges));
+  }
+  return result;
+}
+
+} // namespace ad
+
+#endif // __ODE_H__
@@ -0,0 +1,253 @@
+#ifndef __OPS_H__
+#define __OPS_H__
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace ad {
+
+/**
+ * @brief Primitive recorded by a reverse mode node. `Variable` marks leaves and
+ * `Custom` marks nodes built directly from a list of edges. The last entries
+ * only appear in optimized tapes.
+ */
+enum class Op : std::uint8_t {
+  Variable,
+  Custom,
+  Add,
+  Sub,
+  Mul,
+  Inv,
+  Pow,
+  PowConst,
+  Exp,
+  Ln,
+  Sin,
+  Cos,
+  Tan,
+  Cot,
+  Sec,
+  Csc,
+  Sinh,
+  Cosh,
+  Tanh,
+  Coth,
+  Sech,
+  Csch,
+  Asin,
+  Acos,
+  Atan,
+  Acot,
+  Asec,
+  Acsc,
+  Asinh,
+  Acosh,
+  Atanh,
+  Acoth,
+  Asech,
+  Acsch,
+  Sum,
+  Mean,
+  Dot,
+  Norm2,
+  // produced by `Tape` only
+  Constant,
+  Square,
+  Chain,
+};
+
+/**
+ * @brief Whether `t_op` is a unary primitive evaluated by `local`.
+ */
+constexpr auto is_unary(Op t_op) noexcept -> bool {
+  return t_op == Op::Inv || t_op == Op::PowConst || t_op == Op::Square ||
+         (t_op >= Op::Exp && t_op <= Op::Acsch);
+}
+
+/**
+ * @brief The table of named unary primitives, as
+ * `X(function, Op, value, partial)`. The value is spelled in terms of the
+ * operand `x` and the partial in terms of `x` and the value `v`, so that the
+ * transcendental calls of the value are not repeated for the derivative. `S`
+ * is the scalar type the rule is evaluated with.
+ *
+ * Every mode is generated from this table: the `FSym` overloads in
+ * `forwardops.hpp`, the `RSym` overloads in `reverseops.hpp`, and through
+ * `local` the tape, batched and generated kernels.
+ */
+#define AD_UNARY_OPS(X)                                                        \
+  X(exp, Exp, exp(x), v)                                                       \
+  X(ln, Ln, log(x), S(1) / x)                                                  \
+  X(sin, Sin, sin(x), cos(x))                                                  \
+  X(cos, Cos, cos(x), -sin(x))                                                 \
+  X(tan, Tan, tan(x), S(1) + v * v)                                            \
+  X(cot, Cot, S(1) / tan(x), -(S(1) + v * v))                                  \
+  X(sec, Sec, S(1) / cos(x), v * tan(x))                                       \
+  X(csc, Csc, S(1) / sin(x), -(v / tan(x)))                                    \
+  X(sinh, Sinh, sinh(x), cosh(x))                                              \
+  X(cosh, Cosh, cosh(x), sinh(x))                                              \
+  X(tanh, Tanh, tanh(x), S(1) - v * v)                                         \
+  X(coth, Coth, S(1) / tanh(x), S(1) - v * v)                                  \
+  X(sech, Sech, S(1) / cosh(x), -(v * v * sinh(x)))                            \
+  X(csch, Csch, S(1) / sinh(x), -(v * v * cosh(x)))                            \
+  X(asin, Asin, asin(x), S(1) / sqrt(S(1) - x * x))                            \
+  X(acos, Acos, acos(x), S(-1) / sqrt(S(1) - x * x))                           \
+  X(atan, Atan, atan(x), S(1) / (S(1) + x * x))                                \
+  X(acot, Acot, atan(S(1) / x), S(-1) / (S(1) + x * x))                        \
+  X(asec, Asec, acos(S(1) / x), S(1) / (abs(x) * sqrt(x * x - S(1))))          \
+  X(acsc, Acsc, asin(S(1) / x), S(-1) / (abs(x) * sqrt(x * x - S(1))))         \
+  X(asinh, Asinh, asinh(x), S(1) / sqrt(x * x + S(1)))                         \
+  X(acosh, Acosh, acosh(x), S(1) / sqrt(x * x - S(1)))                         \
+  X(atanh, Atanh, atanh(x), S(1) / (S(1) - x * x))                             \
+  X(acoth, Acoth, atanh(S(1) / x), S(1) / (S(1) - x * x))                      \
+  X(asech, Asech, acosh(S(1) / x), S(-1) / (x * sqrt(S(1) - x * x)))           \
+  X(acsch, Acsch, asinh(S(1) / x), S(-1) / (abs(x) * sqrt(S(1) + x * x)))
+
+/**
+ * @brief Value of the unary primitive `t_op` at `x`, where `c` is the constant
+ * recorded with the node (e.g. the exponent of `pow(x, c)`).
+ */
+template <Op t_op, typename S>
+auto primal(const S &x, [[maybe_unused]] const S &c) -> S {
+  static_assert(is_unary(t_op), "not a unary primitive");
+  using std::abs, std::acos, std::acosh, std::asin, std::asinh, std::atan,
+      std::atanh, std::cos, std::cosh, std::exp, std::log, std::pow, std::sin,
+      std::sinh, std::sqrt, std::tan, std::tanh;
+
+  if constexpr (t_op == Op::Inv) {
+    return S(1) / x;
+  } else if constexpr (t_op == Op::PowConst) {
+    return pow(x, c);
+  } else if constexpr (t_op == Op::Square) {
+    return x * x;
+  }
+#define AD_PRIMAL(NAME, OP, VALUE, PARTIAL)                                    \
+  else if constexpr (t_op == Op::OP) {                                         \
+    return VALUE;                                                              \
+  }
+  AD_UNARY_OPS(AD_PRIMAL)
+#undef AD_PRIMAL
+}
+
+/**
+ * @brief Partial derivative of the unary primitive `t_op` at `x`, given its
+ * value `v` there.
+ */
+template <Op t_op, typename S>
+auto partial([[maybe_unused]] const S &x, [[maybe_unused]] const S &v,
+             [[maybe_unused]] const S &c) -> S {
+  static_assert(is_unary(t_op), "not a unary primitive");
+  using std::abs, std::acos, std::acosh, std::asin, std::asinh, std::atan,
+      std::atanh, std::cos, std::cosh, std::exp, std::log, std::pow, std::sin,
+      std::sinh, std::sqrt, std::tan, std::tanh;
+
+  if constexpr (t_op == Op::Inv) {
+    return -(v * v);
+  } else if constexpr (t_op == Op::PowConst) {
+    return c * pow(x, c - S(1));
+  } else if constexpr (t_op == Op::Square) {
+    return S(2) * x;
+  }
+#define AD_PARTIAL(NAME, OP, VALUE, PARTIAL)                                   \
+  else if constexpr (t_op == Op::OP) {                                         \
+    return PARTIAL;                                                            \
+  }
+  AD_UNARY_OPS(AD_PARTIAL)
+#undef AD_PARTIAL
+}
+
+/**
+ * @brief Partials of `pow(x, y)` with respect to `x` and `y`, given its value
+ * `v`.
+ */
+template <typename S>
+auto pow_partials(const S &x, const S &y, const S &v) -> std::pair<S, S> {
+  using std::log, std::pow;
+  return {y * pow(x, y - S(1)), v * log(x)};
+}
+
+/**
+ * @brief Evaluates the unary primitive `t_op` at `x`.
+ *
+ * @return the pair (value, partial).
+ */
+template <Op t_op, typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto local(T x, T t_constant) -> std::pair<T, T> {
+  const T value = primal<t_op>(x, t_constant);
+  return {value, partial<t_op>(x, value, t_constant)};
+}
+
+/**
+ * @brief Calls `f` with `std::integral_constant<Op, t_op>`, turning an op code
+ * known at run time into a template argument.
+ */
+template <typename F> auto visit_unary(Op t_op, F &&f) -> decltype(auto) {
+  switch (t_op) {
+  case Op::Inv:
+    return f(std::integral_constant<Op, Op::Inv>{});
+  case Op::PowConst:
+    return f(std::integral_constant<Op, Op::PowConst>{});
+  case Op::Square:
+    return f(std::integral_constant<Op, Op::Square>{});
+#define AD_VISIT(NAME, OP, VALUE, PARTIAL)                                     \
+  case Op::OP:                                                                 \
+    return f(std::integral_constant<Op, Op::OP>{});
+    AD_UNARY_OPS(AD_VISIT)
+#undef AD_VISIT
+  default:
+    assert(false && "not a unary primitive");
+    return f(std::integral_constant<Op, Op::Square>{});
+  }
+}
+
+/**
+ * @brief Evaluates the unary primitive `t_op` at `x`, where `t_constant` is
+ * the constant argument recorded with the node.
+ *
+ * @return the pair (value, partial).
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto local(Op t_op, T x, T t_constant) -> std::pair<T, T> {
+  switch (t_op) {
+  case Op::Inv:
+    return local<Op::Inv>(x, t_constant);
+  case Op::PowConst:
+    return local<Op::PowConst>(x, t_constant);
+  case Op::Square:
+    return local<Op::Square>(x, t_constant);
+#define AD_LOCAL(NAME, OP, VALUE, PARTIAL)                                     \
+  case Op::OP:                                                                 \
+    return local<Op::OP>(x, t_constant);
+    AD_UNARY_OPS(AD_LOCAL)
+#undef AD_LOCAL
+  default:
+    assert(false && "not a unary primitive");
+    return {x, T{1}};
+  }
+}
+
+/**
+ * @brief Evaluates the unary primitive `t_op` at `t_count` points, writing the
+ * values and partials to separate arrays. The loop holds a single primitive,
+ * so it can be vectorized.
+ */
+template <Op t_op, typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto local_batch(const T *x, T t_constant, T *t_values, T *t_partials,
+                 std::size_t t_count) -> void {
+  for (std::size_t i = 0; i < t_count; ++i) {
+    const T value = primal<t_op>(x[i], t_constant);
+    t_values[i] = value;
+    t_partials[i] = partial<t_op>(x[i], value, t_constant);
+  }
+}
+
+} // namespace ad
+
+#endif // __OPS_H__
@@ -0,0 +1,260 @@
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace ad {
+
+/**
+ * @brief Stochastic gradient descent with momentum on a dense parameter
+ * buffer. Each step updates the velocity and the parameters in a single pass.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class Sgd {
+public:
+  Sgd(std::size_t t_size, T t_rate, T t_momentum = T{})
+      : m_velocity(t_size, T{}), m_rate(t_rate), m_momentum(t_momentum) {}
+
+  /** @brief Updates `t_params` in place given the gradient `t_grads` */
+  auto step(T *t_params, const T *t_grads) -> void {
+    T *velocity = m_velocity.data();
+    for (std::size_t i = 0; i < m_velocity.size(); ++i) {
+      velocity[i] = m_momentum * velocity[i] + t_grads[i];
+      t_params[i] -= m_rate * velocity[i];
+    }
+  }
+
+  auto step(std::vector<T> &t_params, const std::vector<T> &t_grads) -> void {
+    assert(t_params.size() == size() && t_grads.size() == size());
+    step(t_params.data(), t_grads.data());
+  }
+
+  auto size() const noexcept -> std::size_t { return m_velocity.size(); }
+
+private:
+  std::vector<T> m_velocity;
+  T m_rate;
+  T m_momentum;
+};
+
+/**
+ * @brief Adam on a dense parameter buffer. The bias corrections are folded
+ * into two scalars per step, so the moments and the parameters are updated in
+ * a single pass.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class Adam {
+public:
+  Adam(std::size_t t_size, T t_rate = T(1e-3), T t_beta1 = T(0.9),
+       T t_beta2 = T(0.999), T t_epsilon = T(1e-8))
+      : m_first(t_size, T{}), m_second(t_size, T{}), m_rate(t_rate),
+        m_beta1(t_beta1), m_beta2(t_beta2), m_epsilon(t_epsilon) {}
+
+  /** @copydoc Sgd::step */
+  auto step(T *t_params, const T *t_grads) -> void {
+    ++m_steps;
+    const T rate =
+        m_rate / (T(1) - std::pow(m_beta1, static_cast<T>(m_steps)));
+    const T scale =
+        T(1) / std::sqrt(T(1) - std::pow(m_beta2, static_cast<T>(m_steps)));
+
+    T *first = m_first.data();
+    T *second = m_second.data();
+    for (std::size_t i = 0; i < m_first.size(); ++i) {
+      const T g = t_grads[i];
+      first[i] = m_beta1 * first[i] + (T(1) - m_beta1) * g;
+      second[i] = m_beta2 * second[i] + (T(1) - m_beta2) * g * g;
+      t_params[i] -= rate * first[i] / (std::sqrt(second[i]) * scale +
+                                        m_epsilon);
+    }
+  }
+
+  auto step(std::vector<T> &t_params, const std::vector<T> &t_grads) -> void {
+    assert(t_params.size() == size() && t_grads.size() == size());
+    step(t_params.data(), t_grads.data());
+  }
+
+  auto size() const noexcept -> std::size_t { return m_first.size(); }
+  auto steps() const noexcept -> std::size_t { return m_steps; }
+
+private:
+  std::vector<T> m_first;
+  std::vector<T> m_second;
+  T m_rate;
+  T m_beta1;
+  T m_beta2;
+  T m_epsilon;
+  std::size_t m_steps{};
+};
+
+/**
+ * @brief Limited memory BFGS with a fixed step length along the two-loop
+ * direction; there is no line search, so `t_rate` below 1 is advisable away
+ * from quadratic losses. The last `t_history` curvature pairs are kept in one
+ * contiguous buffer each, and every loop of the recursion fuses its update
+ * with the inner product needed by the next iteration.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class Lbfgs {
+public:
+  Lbfgs(std::size_t t_size, std::size_t t_history = 10, T t_rate = T(1))
+      : m_size(t_size), m_history(t_history),
+        m_s(t_size * (t_history + 1)), m_y(t_size * (t_history + 1)),
+        m_rho(t_history + 1), m_alpha(t_history + 1),
+        m_params(t_size), m_grads(t_size), m_direction(t_size),
+        m_rate(t_rate) {
+    assert(t_history > 0);
+  }
+
+  /** @copydoc Sgd::step */
+  auto step(T *t_params, const T *t_grads) -> void {
+    if (m_steps++ > 0) {
+      push_pair(t_params, t_grads);
+    }
+
+    // first loop, newest pair first: q <- g - sum alpha_i y_i
+    T *q = m_direction.data();
+    const std::size_t count = m_pairs;
+    T dot{};
+    if (count > 0) {
+      const T *s = pair_s(count - 1);
+      for (std::size_t j = 0; j < m_size; ++j) {
+        q[j] = t_grads[j];
+        dot += s[j] * q[j];
+      }
+    } else {
+      for (std::size_t j = 0; j < m_size; ++j) {
+        q[j] = t_grads[j];
+      }
+    }
+    for (std::size_t k = count; k-- > 0;) {
+      const T alpha = m_rho[slot(k)] * dot;
+      m_alpha[slot(k)] = alpha;
+      const T *y = pair_y(k);
+      const T *s_next = k > 0 ? pair_s(k - 1) : nullptr;
+      dot = T{};
+      if (s_next != nullptr) {
+        for (std::size_t j = 0; j < m_size; ++j) {
+          q[j] -= alpha * y[j];
+          dot += s_next[j] * q[j];
+        }
+      } else {
+        for (std::size_t j = 0; j < m_size; ++j) {
+          q[j] -= alpha * y[j];
+        }
+      }
+    }
+
+    // second loop, oldest pair first, on r = gamma q
+    if (count > 0) {
+      const T *y = pair_y(0);
+      dot = T{};
+      for (std::size_t j = 0; j < m_size; ++j) {
+        q[j] *= m_gamma;
+        dot += y[j] * q[j];
+      }
+    }
+    for (std::size_t k = 0; k < count; ++k) {
+      const T beta = m_rho[slot(k)] * dot;
+      const T weight = m_alpha[slot(k)] - beta;
+      const T *s = pair_s(k);
+      const T *y_next = k + 1 < count ? pair_y(k + 1) : nullptr;
+      dot = T{};
+      if (y_next != nullptr) {
+        for (std::size_t j = 0; j < m_size; ++j) {
+          q[j] += weight * s[j];
+          dot += y_next[j] * q[j];
+        }
+      } else {
+        for (std::size_t j = 0; j < m_size; ++j) {
+          q[j] += weight * s[j];
+        }
+      }
+    }
+
+    // remember this point and move along the direction
+    T *params = m_params.data();
+    T *grads = m_grads.data();
+    for (std::size_t j = 0; j < m_size; ++j) {
+      params[j] = t_params[j];
+      grads[j] = t_grads[j];
+      t_params[j] -= m_rate * q[j];
+    }
+  }
+
+  auto step(std::vector<T> &t_params, const std::vector<T> &t_grads) -> void {
+    assert(t_params.size() == size() && t_grads.size() == size());
+    step(t_params.data(), t_grads.data());
+  }
+
+  auto size() const noexcept -> std::size_t { return m_size; }
+
+  /** @brief Number of curvature pairs currently held */
+  auto pairs() const noexcept -> std::size_t { return m_pairs; }
+
+private:
+  // slot of the k-th oldest pair in a ring with one spare slot
+  auto slot(std::size_t k) const noexcept -> std::size_t {
+    return (m_oldest + k) % (m_history + 1);
+  }
+  auto pair_s(std::size_t k) noexcept -> T * {
+    return m_s.data() + slot(k) * m_size;
+  }
+  auto pair_y(std::size_t k) noexcept -> T * {
+    return m_y.data() + slot(k) * m_size;
+  }
+
+  // s = x - x_prev and y = g - g_prev, written to the spare slot and kept
+  // only with positive curvature
+  auto push_pair(const T *t_params, const T *t_grads) -> void {
+    const std::size_t spare = slot(m_pairs);
+    T *s = m_s.data() + spare * m_size;
+    T *y = m_y.data() + spare * m_size;
+
+    T ys{};
+    T yy{};
+    for (std::size_t j = 0; j < m_size; ++j) {
+      s[j] = t_params[j] - m_params[j];
+      y[j] = t_grads[j] - m_grads[j];
+      ys += y[j] * s[j];
+      yy += y[j] * y[j];
+    }
+    if (!(ys > T{}) || !(yy > T{})) {
+      return;
+    }
+
+    m_rho[spare] = T(1) / ys;
+    m_gamma = ys / yy;
+    if (m_pairs == m_history) {
+      m_oldest = (m_oldest + 1) % (m_history + 1);
+    } else {
+      ++m_pairs;
+    }
+  }
+
+  std::size_t m_size;
+  std::size_t m_history;
+  std::vector<T> m_s;
+  std::vector<T> m_y;
+  std::vector<T> m_rho;
+  std::vector<T> m_alpha;
+  std::vector<T> m_params;
+  std::vector<T> m_grads;
+  std::vector<T> m_direction;
+  T m_rate;
+  T m_gamma{1};
+  std::size_t m_oldest{};
+  std::size_t m_pairs{};
+  std::size_t m_steps{};
+};
+
+} // namespace ad
+
+#endif // __OPTIMIZER_H__
@@ -0,0 +1,193 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/** @brief Number of threads the parallel kernels may use, at least 1 */
+inline auto hardware_threads() noexcept -> std::size_t {
+  static const std::size_t threads =
+      std::max<std::size_t>(1, std::thread::hardware_concurrency());
+  return threads;
+}
+
+/**
+ * @brief A fixed set of worker threads that `run` hands chunks of work to.
+ * The calling thread works on the chunks as well, so a pool of `t_threads`
+ * starts `t_threads` - 1 workers. A `run` issued from inside another, or
+ * while another thread's `run` is in progress, executes serially on the
+ * calling thread instead of waiting for the pool.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t t_threads) {
+    const std::size_t workers = std::max<std::size_t>(1, t_threads) - 1;
+    m_workers.reserve(workers);
+    for (std::size_t w = 0; w < workers; ++w) {
+      m_workers.emplace_back([this]() { work(); });
+    }
+  }
+  ThreadPool(const ThreadPool &) = delete;
+  auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+
+  ~ThreadPool() {
+    {
+      const std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  /**
+   * @brief The pool of `hardware_threads()` threads used by `parallel_for`,
+   * started on first use. Starting it makes every `std::shared_ptr` count
+   * atomic for the rest of the process.
+   */
+  static auto global() -> ThreadPool & {
+    static ThreadPool pool{hardware_threads()};
+    return pool;
+  }
+
+  auto size() const noexcept -> std::size_t { return m_workers.size() + 1; }
+
+  /**
+   * @brief Calls `f(chunk)` once for every chunk in [0, `t_chunks`), spread
+   * over the threads of the pool, and returns when all calls have returned.
+   * `f` must not throw.
+   */
+  template <typename F> auto run(std::size_t t_chunks, F &&f) -> void {
+    std::unique_lock<std::mutex> busy(m_run, std::try_to_lock);
+    if (t_chunks <= 1 || m_workers.empty() || inside() || !busy) {
+      for (std::size_t c = 0; c < t_chunks; ++c) {
+        f(c);
+      }
+      return;
+    }
+
+    {
+      const std::lock_guard<std::mutex> lock(m_mutex);
+      m_task = const_cast<void *>(static_cast<const void *>(&f));
+      m_invoke = [](void *t_task, std::size_t t_chunk) {
+        (*static_cast<std::remove_reference_t<F> *>(t_task))(t_chunk);
+      };
+      m_chunks = t_chunks;
+      m_next.store(0, std::memory_order_relaxed);
+      m_active = m_workers.size();
+      ++m_generation;
+    }
+    m_wake.notify_all();
+    claim();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_active == 0; });
+    m_task = nullptr;
+  }
+
+private:
+  static auto inside() noexcept -> bool & {
+    thread_local bool flag = false;
+    return flag;
+  }
+
+  auto claim() -> void {
+    inside() = true;
+    for (std::size_t c = m_next.fetch_add(1); c < m_chunks;
+         c = m_next.fetch_add(1)) {
+      m_invoke(m_task, c);
+    }
+    inside() = false;
+  }
+
+  auto work() -> void {
+    std::uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock,
+                    [this, seen]() { return m_stop || m_generation != seen; });
+        if (m_stop) {
+          return;
+        }
+        seen = m_generation;
+      }
+      claim();
+      {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        --m_active;
+      }
+      m_done.notify_one();
+    }
+  }
+
+  std::vector<std::thread> m_workers{};
+  std::mutex m_run{};
+  std::mutex m_mutex{};
+  std::condition_variable m_wake{};
+  std::condition_variable m_done{};
+  void *m_task{};
+  void (*m_invoke)(void *, std::size_t){};
+  std::size_t m_chunks{};
+  std::atomic<std::size_t> m_next{};
+  std::size_t m_active{};
+  std::uint64_t m_generation{};
+  bool m_stop{};
+};
+
+/**
+ * @brief Number of chunks `parallel_for` splits `t_count` items into, so that
+ * each chunk holds at least `t_grain` items.
+ */
+inline auto parallel_chunks(std::size_t t_count, std::size_t t_grain,
+                            std::size_t t_threads = hardware_threads()) noexcept
+    -> std::size_t {
+  const std::size_t grain = std::max<std::size_t>(1, t_grain);
+  return std::max<std::size_t>(1, std::min(t_threads, t_count / grain));
+}
+
+/**
+ * @brief Calls `f(begin, end, chunk)` on consecutive ranges covering
+ * [0, `t_count`), one per chunk of `parallel_chunks`, on the threads of
+ * `t_pool`. With a single chunk `f` runs directly on the calling thread.
+ */
+template <typename F>
+auto parallel_for(ThreadPool &t_pool, std::size_t t_count, std::size_t t_grain,
+                  F &&f) -> void {
+  const std::size_t chunks = parallel_chunks(t_count, t_grain, t_pool.size());
+  if (chunks == 1) {
+    f(std::size_t{0}, t_count, std::size_t{0});
+    return;
+  }
+  const auto bound = [t_count, chunks](std::size_t t_chunk) {
+    return t_count / chunks * t_chunk + std::min(t_chunk, t_count % chunks);
+  };
+  t_pool.run(chunks, [&f, &bound](std::size_t t_chunk) {
+    f(bound(t_chunk), bound(t_chunk + 1), t_chunk);
+  });
+}
+
+/** @brief `parallel_for` on `ThreadPool::global()` */
+template <typename F>
+auto parallel_for(std::size_t t_count, std::size_t t_grain, F &&f) -> void {
+  if (parallel_chunks(t_count, t_grain) == 1) {
+    f(std::size_t{0}, t_count, std::size_t{0});
+    return;
+  }
+  parallel_for(ThreadPool::global(), t_count, t_grain, std::forward<F>(f));
+}
+
+} // namespace ad
+
+#endif // __PARALLEL_H__
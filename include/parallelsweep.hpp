@@ -0,0 +1,361 @@
+#ifndef __PARALLELSWEEP_H__
+#define __PARALLELSWEEP_H__
+
+#include "../include/parallel.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/stats.hpp"
+#include "../include/tape.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace ad {
+
+/** @brief Nodes of one level handed to a thread at a time */
+constexpr std::size_t sweep_grain = 2048;
+
+/**
+ * @brief The nodes of a graph grouped into dependency levels: the root is
+ * level 0 and every other node sits one level below the deepest node using
+ * it. The adjoint of a node depends only on nodes of lower levels, and its
+ * value only on nodes of higher levels, so the nodes of one level can be
+ * swept in parallel in either direction. The schedule holds only the
+ * structure of the graph: built once, it serves every sweep of new values.
+ *
+ * The backward sweep pulls rather than pushes: each node sums, over the
+ * edges that use it, the adjoint of the user times the partial, reading the
+ * edges transposed into one contiguous row per node in level order. No two
+ * threads write the same adjoint, and every sum adds its terms in the order
+ * the serial sweep does, so the adjoints are the same for any number of
+ * threads.
+ */
+class LevelSchedule {
+public:
+  /** @brief The schedule of `t_order`, whose root is node 0 */
+  template <typename T>
+  explicit LevelSchedule(const TopologicalOrder<T> &t_order) {
+    AD_TRACE_SCOPE("ad::LevelSchedule");
+    build(
+        t_order.nodes.size(), [](std::size_t r) { return r; },
+        t_order.offsets.data(), t_order.operands.data());
+  }
+
+  /**
+   * @brief The schedule of the instructions of `t_tape` up to its output,
+   * which is the root. Instructions after the output are left out.
+   */
+  template <typename S, typename I>
+  explicit LevelSchedule(const TapeView<S, I> &t_tape) {
+    AD_TRACE_SCOPE("ad::LevelSchedule");
+    const std::size_t count = t_tape.size == 0 ? 0 : t_tape.output + 1;
+    build(
+        count, [&t_tape](std::size_t r) { return t_tape.output - r; },
+        t_tape.offsets, t_tape.operands);
+  }
+
+  auto depth() const noexcept -> std::size_t { return m_levels.size() - 1; }
+  auto size() const noexcept -> std::size_t { return m_nodes.size(); }
+  auto edge_count() const noexcept -> std::size_t { return m_users.size(); }
+
+  /** @brief Number of nodes in the widest level */
+  auto width() const noexcept -> std::size_t {
+    std::size_t result = 0;
+    for (std::size_t l = 0; l + 1 < m_levels.size(); ++l) {
+      result = std::max(result, m_levels[l + 1] - m_levels[l]);
+    }
+    return result;
+  }
+
+  /**
+   * @brief The nodes level by level from the deepest, an order in which every
+   * node comes after its operands
+   */
+  auto evaluation_order() const -> std::vector<std::size_t> {
+    std::vector<std::size_t> result{};
+    result.reserve(size());
+    for (std::size_t l = depth(); l-- > 0;) {
+      result.insert(result.end(), m_nodes.begin() + m_levels[l],
+                    m_nodes.begin() + m_levels[l + 1]);
+    }
+    return result;
+  }
+
+  /**
+   * @brief `forward_sweep` of the tape the schedule was built from, from the
+   * deepest level up to the output. Levels of fewer than 2 `t_grain`
+   * instructions are evaluated on the calling thread.
+   */
+  template <typename S, typename I>
+  auto forward(const TapeView<S, I> &t_tape, S *t_values, S *t_partials,
+               ThreadPool &t_pool = ThreadPool::global(),
+               std::size_t t_grain = sweep_grain) const -> void {
+    AD_TRACE_SCOPE("ad::LevelSchedule::forward");
+    for (std::size_t l = depth(); l-- > 0;) {
+      each_node(l, t_pool, t_grain, [&](std::size_t t_node) {
+        forward_instruction(t_tape, t_node, t_values, t_partials);
+      });
+    }
+  }
+
+  /**
+   * @brief Sweeps the adjoints back from the root given `t_partials`, indexed
+   * like the operands of the graph the schedule was built from. Nodes of
+   * level 0 other than the root are not written, so `t_adjoints` must be
+   * zeroed.
+   */
+  template <typename A, typename P>
+  auto backward(const P *t_partials, A *t_adjoints,
+                ThreadPool &t_pool = ThreadPool::global(),
+                std::size_t t_grain = sweep_grain) const -> void {
+    AD_TRACE_SCOPE("ad::LevelSchedule::backward");
+    if (m_nodes.empty()) {
+      return;
+    }
+    t_adjoints[m_root] = A{1};
+    for (std::size_t l = 1; l < depth(); ++l) {
+      each_position(l, t_pool, t_grain, [&](std::size_t p) {
+        A sum{};
+        for (std::size_t k = m_offsets[p]; k < m_offsets[p + 1]; ++k) {
+          sum +=
+              t_adjoints[m_users[k]] * static_cast<A>(t_partials[m_edges[k]]);
+        }
+        t_adjoints[m_nodes[p]] = sum;
+      });
+    }
+  }
+
+private:
+  /**
+   * @brief Levels and transposed rows of the `t_count` nodes `t_node(r)`,
+   * listed such that every node comes before its operands.
+   */
+  template <typename Node, typename O, typename P>
+  auto build(std::size_t t_count, Node t_node, const O *t_offsets,
+             const P *t_operands) -> void {
+    std::vector<std::size_t> level(t_count, 0);
+    std::vector<std::size_t> uses(t_count, 0);
+    std::size_t depth = t_count == 0 ? 0 : 1;
+    for (std::size_t r = 0; r < t_count; ++r) {
+      const std::size_t i = t_node(r);
+      for (std::size_t k = t_offsets[i]; k < t_offsets[i + 1]; ++k) {
+        const std::size_t operand = t_operands[k];
+        level[operand] = std::max(level[operand], level[i] + 1);
+        depth = std::max(depth, level[operand] + 1);
+        ++uses[operand];
+      }
+    }
+
+    // counting sort of the nodes by level, each level in index order
+    m_root = t_count == 0 ? 0 : t_node(0);
+    m_levels.assign(depth + 1, 0);
+    for (std::size_t i = 0; i < t_count; ++i) {
+      ++m_levels[level[i] + 1];
+    }
+    for (std::size_t l = 0; l < depth; ++l) {
+      m_levels[l + 1] += m_levels[l];
+    }
+    m_nodes.resize(t_count);
+    std::vector<std::size_t> position(t_count);
+    {
+      std::vector<std::size_t> next(m_levels.begin(), m_levels.end() - 1);
+      for (std::size_t i = 0; i < t_count; ++i) {
+        position[i] = next[level[i]]++;
+        m_nodes[position[i]] = i;
+      }
+    }
+
+    // the edges transposed, one row per node in level order, each row in
+    // the order the serial sweep pushes along the edges
+    m_offsets.assign(t_count + 1, 0);
+    for (std::size_t p = 0; p < t_count; ++p) {
+      m_offsets[p + 1] = m_offsets[p] + uses[m_nodes[p]];
+    }
+    m_users.resize(m_offsets.back());
+    m_edges.resize(m_offsets.back());
+    std::vector<std::size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+    for (std::size_t r = 0; r < t_count; ++r) {
+      const std::size_t i = t_node(r);
+      for (std::size_t k = t_offsets[i]; k < t_offsets[i + 1]; ++k) {
+        const std::size_t slot = next[position[t_operands[k]]]++;
+        m_users[slot] = i;
+        m_edges[slot] = k;
+      }
+    }
+  }
+
+  /** @brief Calls `f(p)` with the position of every node of `t_level` */
+  template <typename F>
+  auto each_position(std::size_t t_level, ThreadPool &t_pool,
+                     std::size_t t_grain, F &&f) const -> void {
+    const std::size_t begin = m_levels[t_level];
+    parallel_for(t_pool, m_levels[t_level + 1] - begin, t_grain,
+                 [&f, begin](std::size_t t_begin, std::size_t t_end,
+                             std::size_t) {
+                   for (std::size_t p = begin + t_begin; p < begin + t_end;
+                        ++p) {
+                     f(p);
+                   }
+                 });
+  }
+
+  template <typename F>
+  auto each_node(std::size_t t_level, ThreadPool &t_pool, std::size_t t_grain,
+                 F &&f) const -> void {
+    each_position(t_level, t_pool, t_grain,
+                  [this, &f](std::size_t p) { f(m_nodes[p]); });
+  }
+
+  std::size_t m_root{};
+  /** @brief Level l holds positions [m_levels[l], m_levels[l + 1]) */
+  std::vector<std::size_t> m_levels{};
+  /** @brief Node at each position */
+  std::vector<std::size_t> m_nodes{};
+  /** @brief Row of the node at position p: [m_offsets[p], m_offsets[p + 1]) */
+  std::vector<std::size_t> m_offsets{};
+  /** @brief Node using each edge */
+  std::vector<std::size_t> m_users{};
+  /** @brief Index of each edge among the operands of the graph */
+  std::vector<std::size_t> m_edges{};
+};
+
+/**
+ * @brief The partials of the edges of `t_order`, indexed like its operands,
+ * read from the nodes on the threads of `t_pool`.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto edge_partials(const TopologicalOrder<T> &t_order,
+                   ThreadPool &t_pool = ThreadPool::global())
+    -> std::vector<T> {
+  std::vector<T> result(t_order.operands.size());
+  parallel_for(t_pool, t_order.nodes.size(), sweep_grain,
+               [&t_order, &result](std::size_t t_begin, std::size_t t_end,
+                                   std::size_t) {
+                 for (std::size_t i = t_begin; i < t_end; ++i) {
+                   const auto &edges = t_order.nodes[i]->edges();
+                   for (std::size_t k = 0; k < edges.size(); ++k) {
+                     result[t_order.offsets[i] + k] = edges[k].second;
+                   }
+                 }
+               });
+  return result;
+}
+
+/**
+ * @brief `gradient(variable, wrt)` with the backward sweep of a
+ * `LevelSchedule` on the threads of `t_pool`. The graph is linearized and
+ * scheduled anew by every call, serially, which takes longer than the sweep
+ * itself; to differentiate the same graph for many input values, record a
+ * `Tape` and replay it with a `ParallelTape`, which schedules it once.
+ */
+template <typename T, typename A = T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T> &&
+                                               std::is_floating_point_v<A>>>
+auto parallel_gradient(const RSym<T> &variable,
+                       const std::vector<RSym<T>> &wrt,
+                       ThreadPool &t_pool = ThreadPool::global())
+    -> std::vector<A> {
+  AD_TRACE_SCOPE("ad::parallel_gradient");
+  Stats::clock::time_point begin{};
+  if constexpr (stats_enabled) {
+    begin = Stats::sweep_begin();
+  }
+  const auto order = topological_order(variable);
+  const LevelSchedule schedule{order};
+  std::vector<A> adjoints(order.nodes.size(), A{});
+  schedule.backward(edge_partials(order, t_pool).data(), adjoints.data(),
+                    t_pool);
+  auto result = select_adjoints(order, adjoints, wrt);
+
+  if constexpr (stats_enabled) {
+    record_sweep(order, begin);
+  }
+  return result;
+}
+
+/**
+ * @brief Replays a recorded `Tape` on the threads of a pool. The levels of
+ * the tape are scheduled once, at construction, and a copy of the tape is
+ * renumbered so that each level is a contiguous range of instructions; every
+ * replay then evaluates the levels from the inputs up and sweeps the adjoints
+ * back down level by level. The gradient matches `Tape::gradient` up to the
+ * order of the sums, and is the same for any number of threads.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class ParallelTape {
+public:
+  explicit ParallelTape(const Tape<T> &t_tape)
+      : m_tape(level_major(t_tape)), m_schedule(m_tape.view()),
+        m_values(m_tape.size()), m_partials(m_tape.edge_count()),
+        m_adjoints(m_tape.size()) {
+    for (std::size_t i = 0; i < m_values.size(); ++i) {
+      m_values[i] = m_tape.value(i);
+    }
+  }
+
+  /** @brief Evaluates the tape for new input values, like `Tape::forward` */
+  auto forward(const std::vector<T> &t_inputs,
+               ThreadPool &t_pool = ThreadPool::global()) -> T {
+    assert(t_inputs.size() == input_count());
+    for (std::size_t i = 0; i < t_inputs.size(); ++i) {
+      m_values[m_tape.inputs()[i]] = t_inputs[i];
+    }
+    m_schedule.forward(m_tape.view(), m_values.data(), m_partials.data(),
+                       t_pool);
+    return value();
+  }
+
+  /** @brief The gradient of the last forward pass, like `Tape::backward` */
+  auto backward(ThreadPool &t_pool = ThreadPool::global()) -> std::vector<T> {
+    std::fill(m_adjoints.begin(), m_adjoints.end(), T{});
+    m_schedule.backward(m_partials.data(), m_adjoints.data(), t_pool);
+
+    std::vector<T> result{};
+    result.reserve(input_count());
+    for (const auto index : m_tape.inputs()) {
+      result.push_back(m_adjoints[index]);
+    }
+    return result;
+  }
+
+  auto gradient(const std::vector<T> &t_inputs,
+                ThreadPool &t_pool = ThreadPool::global()) -> std::vector<T> {
+    forward(t_inputs, t_pool);
+    return backward(t_pool);
+  }
+
+  auto value() const noexcept -> T { return m_values[m_tape.output()]; }
+  auto schedule() const noexcept -> const LevelSchedule & {
+    return m_schedule;
+  }
+  auto input_count() const noexcept -> std::size_t {
+    return m_tape.input_count();
+  }
+
+private:
+  static auto level_major(const Tape<T> &t_tape) -> Tape<T> {
+    auto order = LevelSchedule{t_tape.view()}.evaluation_order();
+    // instructions after the output are not scheduled and keep their place
+    for (std::size_t i = order.size(); i < t_tape.size(); ++i) {
+      order.push_back(i);
+    }
+    Tape<T> result = t_tape;
+    result.reorder(order);
+    return result;
+  }
+
+  Tape<T> m_tape;
+  LevelSchedule m_schedule;
+  std::vector<T> m_values;
+  std::vector<T> m_partials;
+  std::vector<T> m_adjoints;
+};
+
+} // namespace ad
+
+#endif // __PARALLELSWEEP_H__
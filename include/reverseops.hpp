@@ -1,245 +1,45 @@
 #ifndef __REVERSEOPS_H__
 #define __REVERSEOPS_H__
 
+#include "../include/ops.hpp"
 #include "../include/rsymbol.hpp"
 
 #include <cmath>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 
+using ad::Op;
 using ad::RSym;
 
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto pow(const RSym<T> &base, const RSym<T> &exponent) -> RSym<T> {
-  const T df_base =
-      exponent.value() * std::pow(base.value(), exponent.value() - 1);
-  const T df_exp =
-      std::pow(base.value(), exponent.value()) * std::log(base.value());
-
-  return {{{base, df_base}, {exponent, df_exp}},
-          std::pow(base.value(), exponent.value())};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto pow(const RSym<T> &base, T exponent) -> RSym<T> {
-  const T df_base = exponent * std::pow(base.value(), exponent - 1);
-
-  return {{{base, df_base}}, std::pow(base.value(), exponent)};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto exp(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::exp(rhs.value());
-  const T df_rhs = value;
-
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto ln(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::log(rhs.value());
-  const T df_rhs = 1.0 / rhs.value();
-
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto sin(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::sin(rhs.value());
-  const T df_rhs = std::cos(rhs.value());
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto cos(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::cos(rhs.value());
-  const T df_rhs = -std::sin(rhs.value());
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto tan(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::tan(rhs.value());
-  const T df_rhs = 1.0 / std::pow(std::cos(rhs.value()), 2);
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto cot(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::tan(rhs.value());
-  const T df_rhs = -1.0 / std::pow(std::sin(rhs.value()), 2);
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto sec(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::cos(rhs.value());
-  const T df_rhs = value * std::tan(rhs.value());
-  return {{{rhs, df_rhs}}, value};
+auto pow(const RSym<T> &base, const RSym<T> &exponent) -> RSym<T> {
+  return ad::binary(Op::Pow, base, exponent, [](T x, T y) {
+    const T value = std::pow(x, y);
+    const auto [df_base, df_exp] = ad::pow_partials(x, y, value);
+    return std::tuple{value, df_base, df_exp};
+  });
 }
 
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto csc(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::sin(rhs.value());
-  const T df_rhs = value * (-1.0 / std::tan(rhs.value()));
-  return {{{rhs, df_rhs}}, value};
+auto pow(const RSym<T> &base, T exponent) -> RSym<T> {
+  return ad::unary(
+      Op::PowConst, base,
+      [exponent](T x) { return ad::local<Op::PowConst>(x, exponent); },
+      exponent);
 }
 
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto sinh(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::sinh(rhs.value());
-  const T df_rhs = std::cosh(rhs.value());
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto cosh(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::cosh(rhs.value());
-  const T df_rhs = std::sinh(rhs.value());
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto tanh(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::tanh(rhs.value());
-  const T df_rhs = 1.0 / std::pow(std::cosh(rhs.value()), 2); // cont ..
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto coth(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::tanh(rhs.value());
-  const T df_rhs = -1.0 / std::pow(std::sinh(rhs.value()), 2);
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto sech(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::cosh(rhs.value());
-  const T df_rhs = -value * std::tanh(rhs.value());
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto csch(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::sinh(rhs.value());
-  const T df_rhs = value * (-1.0 / std::tanh(rhs.value()));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto asin(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::asin(rhs.value());
-  const T df_rhs = 1.0 / std::sqrt(1 - std::pow(rhs.value(), 2));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto acos(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::acos(rhs.value());
-  const T df_rhs = -1.0 / std::sqrt(1 - std::pow(rhs.value(), 2));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto atan(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::atan(rhs.value());
-  const T df_rhs = 1.0 / (1 + std::pow(rhs.value(), 2));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto acot(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::atan(rhs.value());
-  const T df_rhs = -1.0 / (1 + std::pow(rhs.value(), 2));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto asec(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::acos(rhs.value());
-  const T df_rhs =
-      1.0 / (std::abs(rhs.value()) * std::sqrt(std::pow(rhs.value(), 2)) - 1);
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto acsc(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::asin(rhs.value());
-  const T df_rhs =
-      -1.0 / (std::sqrt(1 - std::pow(rhs.value(), 2)) * std::abs(rhs.value()));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto asinh(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::asinh(rhs.value());
-  const T df_rhs = 1.0 / std::sqrt(std::pow(rhs.value(), 2) + 1);
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto acosh(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::acosh(rhs.value());
-  const T df_rhs = 1.0 / std::sqrt(std::pow(rhs.value(), 2) - 1);
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto atanh(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = std::atanh(rhs.value());
-  const T df_rhs = 1.0 / (1 - std::pow(rhs.value(), 2));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto acoth(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::atanh(rhs.value());
-  const T df_rhs = -1.0 / (1 - std::pow(rhs.value(), 2));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto asech(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::acosh(rhs.value());
-  const T df_rhs =
-      -1.0 / (rhs.value() * std::sqrt(1 - std::pow(rhs.value(), 2)));
-  return {{{rhs, df_rhs}}, value};
-}
-
-template <typename T,
-          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
-constexpr auto acsch(const RSym<T> &rhs) noexcept -> RSym<T> {
-  const T value = 1.0 / std::asinh(rhs.value());
-  const T df_rhs =
-      -1.0 / (std::abs(rhs.value()) * std::sqrt(1 + std::pow(rhs.value(), 2)));
-  return {{{rhs, df_rhs}}, value};
-}
+// exp, ln, sin, ..., acsch from the table in `ops.hpp`
+#define AD_REVERSE_UNARY(NAME, OP, VALUE, PARTIAL)                             \
+  template <typename T, typename = typename std::enable_if_t<                  \
+                            std::is_floating_point_v<T>>>                      \
+  auto NAME(const RSym<T> &rhs) noexcept -> RSym<T> {                          \
+    return ad::unary(Op::OP, rhs,                                              \
+                     [](T x) { return ad::local<Op::OP>(x, T{}); });           \
+  }
+AD_UNARY_OPS(AD_REVERSE_UNARY)
+#undef AD_REVERSE_UNARY
 
-#endif // __REVERSEOPS_H__
\ No newline at end of file
+#endif // __REVERSEOPS_H__
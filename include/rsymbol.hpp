@@ -1,94 +1,714 @@
 #ifndef __RSYMBOL_H__
 #define __RSYMBOL_H__
 
-#include <functional>
+#include "../include/ops.hpp"
+#include "../include/stats.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <map>
+#include <functional>
+#include <memory>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace ad {
 
+/**
+ * @brief Represents the reverse mode operator for autodifferentiation. A
+ * symbol is a handle to an immutable node of the expression graph holding its
+ * value and the local partial derivative with respect to each of its operands.
+ * Copies of a symbol share the same node, hence building an expression costs
+ * O(1) per operation regardless of the size of its operands.
+ *
+ * @tparam T
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
 struct RSym {
+public:
+  using edge_type = std::pair<RSym, T>;
+
 public:
   RSym(const std::map<RSym, T> &t_loc_grad, T t_value)
-      : m_local_grad(t_loc_grad), m_value(t_value) {}
-  RSym(T t_value) : m_value(t_value) {}
+      : m_node(std::make_shared<Node>(
+            Op::Custom,
+            std::vector<edge_type>(t_loc_grad.begin(), t_loc_grad.end()),
+            t_value, T{})) {}
+  RSym(T t_value)
+      : m_node(std::make_shared<Node>(Op::Variable, std::vector<edge_type>{},
+                                      t_value, T{})) {}
 
-  auto value() const noexcept -> T { return m_value; }
+  /**
+   * @brief Constructs a node from a list of (operand, partial) edges. Unlike
+   * the map constructor, operands that compare equal by value are kept apart,
+   * so an n-ary node may reference any number of distinct operands.
+   */
+  RSym(T t_value, std::vector<edge_type> t_edges)
+      : RSym(Op::Custom, t_value, std::move(t_edges)) {}
+
+  /**
+   * @brief Constructs a node recording the primitive `t_op` and its constant
+   * argument, if any (e.g. the exponent of `pow(x, c)`).
+   */
+  RSym(Op t_op, T t_value, std::vector<edge_type> t_edges, T t_constant = T{})
+      : m_node(std::make_shared<Node>(t_op, std::move(t_edges), t_value,
+                                      t_constant)) {}
+
+  auto value() const noexcept -> T { return m_node->value; }
 
   auto local_gradient() const noexcept -> std::map<RSym, T> {
-    return m_local_grad;
+    std::map<RSym, T> result{};
+    for (const auto &[child, partial] : m_node->edges) {
+      result[child] += partial;
+    }
+    return result;
+  }
+
+  auto edges() const noexcept -> const std::vector<edge_type> & {
+    return m_node->edges;
   }
 
+  auto op() const noexcept -> Op { return m_node->op; }
+  auto constant() const noexcept -> T { return m_node->constant; }
+
+  /**
+   * @brief Identity of the underlying graph node, shared by all copies of this
+   * symbol. Unlike `operator==`, it distinguishes symbols of equal value.
+   */
+  auto id() const noexcept -> const void * { return m_node.get(); }
+
   auto operator<(const RSym &other) const noexcept -> bool {
-    return m_value < other.m_value;
+    return value() < other.value();
   }
 
   auto operator>(const RSym &other) const noexcept -> bool {
-    return m_value > other.m_value;
+    return value() > other.value();
   }
   auto operator==(const RSym &other) const noexcept -> bool {
-    return m_value == other.m_value;
+    return value() == other.value();
   }
 
   auto operator!=(const RSym &other) const noexcept -> bool {
-    return m_value != other.m_value;
+    return value() != other.value();
+  }
+
+private:
+  struct Node {
+    Node(Op t_op, std::vector<edge_type> t_edges, T t_value, T t_constant)
+        : edges(std::move(t_edges)), value(t_value), constant(t_constant),
+          op(t_op) {
+      if constexpr (stats_enabled) {
+        Stats::node(t_op, sizeof(Node) + edges.capacity() * sizeof(edge_type));
+      }
+    }
+    Node(const Node &) = delete;
+    auto operator=(const Node &) -> Node & = delete;
+
+    // Releases uniquely owned operands iteratively so that tearing down a deep
+    // chain (e.g. an accumulation loop) does not overflow the stack.
+    ~Node() {
+      std::vector<std::shared_ptr<const Node>> pending{};
+      release(pending);
+      while (!pending.empty()) {
+        std::shared_ptr<const Node> node = std::move(pending.back());
+        pending.pop_back();
+        const_cast<Node &>(*node).release(pending);
+      }
+    }
+
+    auto release(std::vector<std::shared_ptr<const Node>> &t_pending) noexcept
+        -> void {
+      for (auto &edge : edges) {
+        if (edge.first.m_node.use_count() == 1) {
+          t_pending.push_back(std::move(edge.first.m_node));
+        }
+      }
+      edges.clear();
+    }
+
+    std::vector<edge_type> edges;
+    T value;
+    T constant;
+    Op op;
+  };
+
+  std::shared_ptr<const Node> m_node;
+};
+
+/**
+ * @brief Statistics of a hash-consing scope. A hit is a node construction
+ * that returned an existing node instead of allocating a new one.
+ */
+struct HashConsStats {
+  std::size_t lookups{};
+  std::size_t hits{};
+  std::size_t nodes{};
+
+  auto hit_rate() const noexcept -> double {
+    return lookups == 0 ? 0.0
+                        : static_cast<double>(hits) /
+                              static_cast<double>(lookups);
+  }
+};
+
+/**
+ * @brief Hash-consing recording mode for reverse mode graphs. While an
+ * instance is alive, the primitives of `rsymbol.hpp` and `reverseops.hpp`
+ * invoked on the same thread look up their (op, operand identity, constant)
+ * key and return the existing node on a hit, so every unique subexpression is
+ * evaluated and differentiated once. Scopes nest; the innermost one is active.
+ * The scope keeps the nodes it has seen alive until it is destroyed.
+ *
+ * @tparam T
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class HashCons {
+public:
+  HashCons() : m_previous(s_active) { s_active = this; }
+  HashCons(const HashCons &) = delete;
+  auto operator=(const HashCons &) -> HashCons & = delete;
+  ~HashCons() { s_active = m_previous; }
+
+  static auto active() noexcept -> HashCons * { return s_active; }
+
+  auto stats() const noexcept -> HashConsStats {
+    return {m_lookups, m_hits, m_nodes.size()};
+  }
+
+  /**
+   * @brief Returns the node recorded for the key, or builds it with
+   * `t_build` and records it.
+   */
+  template <typename Fn>
+  auto intern(Op t_op, const void *t_lhs, const void *t_rhs, T t_constant,
+              Fn &&t_build) -> RSym<T> {
+    ++m_lookups;
+    const Key key{t_lhs, t_rhs, t_constant, t_op};
+    if (const auto it = m_nodes.find(key); it != m_nodes.end()) {
+      ++m_hits;
+      return it->second;
+    }
+    return m_nodes.emplace(key, t_build()).first->second;
   }
 
 private:
-  std::map<RSym, T> m_local_grad;
-  T m_value;
+  struct Key {
+    const void *lhs;
+    const void *rhs;
+    T constant;
+    Op op;
+
+    auto operator==(const Key &other) const noexcept -> bool {
+      return lhs == other.lhs && rhs == other.rhs &&
+             constant == other.constant && op == other.op;
+    }
+  };
+
+  struct KeyHash {
+    auto operator()(const Key &key) const noexcept -> std::size_t {
+      std::size_t seed = std::hash<const void *>{}(key.lhs);
+      const auto combine = [&seed](std::size_t value) {
+        seed ^= value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2);
+      };
+      combine(std::hash<const void *>{}(key.rhs));
+      combine(std::hash<T>{}(key.constant));
+      combine(static_cast<std::size_t>(key.op));
+      return seed;
+    }
+  };
+
+  inline static thread_local HashCons *s_active = nullptr;
+
+  HashCons *m_previous;
+  std::unordered_map<Key, RSym<T>, KeyHash> m_nodes{};
+  std::size_t m_lookups{};
+  std::size_t m_hits{};
 };
 
+/**
+ * @brief Constructs a node of the unary primitive `t_op`. `t_local` maps the
+ * operand value to the pair (value, partial) and is only invoked when no
+ * active `HashCons` scope already holds the node.
+ */
+template <typename T, typename Fn,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto unary(Op t_op, const RSym<T> &rhs, Fn &&t_local, T t_constant = T{})
+    -> RSym<T> {
+  const auto build = [&]() -> RSym<T> {
+    const auto [value, df_rhs] = t_local(rhs.value());
+    return {t_op, value, {{rhs, df_rhs}}, t_constant};
+  };
+
+  if (auto *scope = HashCons<T>::active()) {
+    return scope->intern(t_op, rhs.id(), nullptr, t_constant, build);
+  }
+  return build();
+}
+
+/**
+ * @brief Constructs a node of the binary primitive `t_op`. `t_local` maps the
+ * operand values to the tuple (value, partial lhs, partial rhs). Operands of
+ * commutative primitives are ordered by identity before the lookup so that
+ * `a + b` and `b + a` share a node.
+ */
+template <typename T, typename Fn,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto binary(Op t_op, const RSym<T> &lhs, const RSym<T> &rhs, Fn &&t_local)
+    -> RSym<T> {
+  const auto build = [&]() -> RSym<T> {
+    const auto [value, df_lhs, df_rhs] = t_local(lhs.value(), rhs.value());
+    return {t_op, value, {{lhs, df_lhs}, {rhs, df_rhs}}};
+  };
+
+  if (auto *scope = HashCons<T>::active()) {
+    const bool commutative = t_op == Op::Add || t_op == Op::Mul;
+    const bool swap =
+        commutative && std::less<const void *>{}(rhs.id(), lhs.id());
+    return swap ? scope->intern(t_op, rhs.id(), lhs.id(), T{}, build)
+                : scope->intern(t_op, lhs.id(), rhs.id(), T{}, build);
+  }
+  return build();
+}
+
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
 auto operator+(const RSym<T> &lhs, const RSym<T> &rhs) -> RSym<T> {
-  return {{{lhs, 1.0}, {rhs, 1.0}}, lhs.value() + rhs.value()};
+  return binary(Op::Add, lhs, rhs,
+                [](T a, T b) { return std::tuple{a + b, T{1}, T{1}}; });
 }
 
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
 auto operator-(const RSym<T> &lhs, const RSym<T> &rhs) -> RSym<T> {
-  return {{{lhs, 1.0}, {rhs, -1.0}}, lhs.value() - rhs.value()};
+  return binary(Op::Sub, lhs, rhs,
+                [](T a, T b) { return std::tuple{a - b, T{1}, T{-1}}; });
 }
 
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
 auto operator*(const RSym<T> &lhs, const RSym<T> &rhs) -> RSym<T> {
-  return {{{lhs, rhs.value()}, {rhs, lhs.value()}}, lhs.value() * rhs.value()};
+  return binary(Op::Mul, lhs, rhs,
+                [](T a, T b) { return std::tuple{a * b, b, a}; });
 }
 
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
 auto operator/(const RSym<T> &lhs, const RSym<T> &rhs) -> RSym<T> {
-  const RSym<T> inverse{{{rhs, -1.0 / std::pow(rhs.value(), 2)}},
-                        1.0 / rhs.value()};
+  const RSym<T> inverse = unary(Op::Inv, rhs, [](T x) {
+    return std::pair{T{1} / x, T{-1} / (x * x)};
+  });
   return lhs * inverse;
 }
 
+/**
+ * @brief Creates a single node summing the symbols in [first, last). The
+ * backward pass of the node is O(n), as opposed to the depth-n tree built by
+ * folding `operator+`.
+ */
+template <typename InputIt,
+          typename T = typename std::iterator_traits<InputIt>::value_type::
+              edge_type::second_type>
+auto sum(InputIt first, InputIt last) -> RSym<T> {
+  std::vector<typename RSym<T>::edge_type> edges{};
+  edges.reserve(std::distance(first, last));
+
+  T result{};
+  for (; first != last; ++first) {
+    result += first->value();
+    edges.emplace_back(*first, T{1});
+  }
+  return {Op::Sum, result, std::move(edges)};
+}
+
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto sum(const std::vector<RSym<T>> &t_values) -> RSym<T> {
+  return sum(t_values.cbegin(), t_values.cend());
+}
+
+/**
+ * @brief Creates a single node for the arithmetic mean of [first, last).
+ * The range must not be empty.
+ */
+template <typename InputIt,
+          typename T = typename std::iterator_traits<InputIt>::value_type::
+              edge_type::second_type>
+auto mean(InputIt first, InputIt last) -> RSym<T> {
+  const auto n = std::distance(first, last);
+  assert(n > 0);
+
+  const T weight = T{1} / static_cast<T>(n);
+  std::vector<typename RSym<T>::edge_type> edges{};
+  edges.reserve(n);
+
+  T result{};
+  for (; first != last; ++first) {
+    result += first->value();
+    edges.emplace_back(*first, weight);
+  }
+  return {Op::Mean, result * weight, std::move(edges)};
+}
+
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto mean(const std::vector<RSym<T>> &t_values) -> RSym<T> {
+  return mean(t_values.cbegin(), t_values.cend());
+}
+
+/**
+ * @brief Creates a single node for the inner product of [first1, last1) and
+ * the range starting at first2, which must be at least as long.
+ */
+template <typename InputIt1, typename InputIt2,
+          typename T = typename std::iterator_traits<InputIt1>::value_type::
+              edge_type::second_type>
+auto dot(InputIt1 first1, InputIt1 last1, InputIt2 first2) -> RSym<T> {
+  std::vector<typename RSym<T>::edge_type> edges{};
+  edges.reserve(2 * std::distance(first1, last1));
+
+  T result{};
+  for (; first1 != last1; ++first1, ++first2) {
+    result += first1->value() * first2->value();
+    edges.emplace_back(*first1, first2->value());
+    edges.emplace_back(*first2, first1->value());
+  }
+  return {Op::Dot, result, std::move(edges)};
+}
+
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto dot(const std::vector<RSym<T>> &lhs, const std::vector<RSym<T>> &rhs)
+    -> RSym<T> {
+  assert(lhs.size() == rhs.size());
+  return dot(lhs.cbegin(), lhs.cend(), rhs.cbegin());
+}
+
+/**
+ * @brief Creates a single node for the euclidean norm of [first, last). The
+ * partials at the origin are taken to be zero.
+ */
+template <typename InputIt,
+          typename T = typename std::iterator_traits<InputIt>::value_type::
+              edge_type::second_type>
+auto norm2(InputIt first, InputIt last) -> RSym<T> {
+  std::vector<typename RSym<T>::edge_type> edges{};
+  edges.reserve(std::distance(first, last));
+
+  T squares{};
+  for (auto it = first; it != last; ++it) {
+    squares += it->value() * it->value();
+  }
+
+  const T result = std::sqrt(squares);
+  const T scale = result == T{} ? T{} : T{1} / result;
+  for (; first != last; ++first) {
+    edges.emplace_back(*first, first->value() * scale);
+  }
+  return {Op::Norm2, result, std::move(edges)};
+}
+
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto norm2(const std::vector<RSym<T>> &t_values) -> RSym<T> {
+  return norm2(t_values.cbegin(), t_values.cend());
+}
+
+/**
+ * @brief Open-addressing map from node identity to a dense index, used by the
+ * graph traversals in place of `std::unordered_map` to avoid one allocation
+ * per visited node.
+ */
+class NodeIndex {
+public:
+  /**
+   * @brief Inserts `t_id` with `t_index` unless already present.
+   *
+   * @return the index stored for `t_id` and whether it was inserted.
+   */
+  auto emplace(const void *t_id, std::size_t t_index)
+      -> std::pair<std::size_t, bool> {
+    if (2 * (m_size + 1) > m_slots.size()) {
+      grow();
+    }
+    std::size_t i = probe(t_id);
+    if (m_slots[i].first == t_id) {
+      return {m_slots[i].second, false};
+    }
+    m_slots[i] = {t_id, t_index};
+    ++m_size;
+    return {t_index, true};
+  }
+
+  auto find(const void *t_id) const noexcept -> const std::size_t * {
+    if (m_slots.empty()) {
+      return nullptr;
+    }
+    const auto &slot = m_slots[probe(t_id)];
+    return slot.first == t_id ? &slot.second : nullptr;
+  }
+
+  auto size() const noexcept -> std::size_t { return m_size; }
+
+private:
+  auto probe(const void *t_id) const noexcept -> std::size_t {
+    const std::size_t mask = m_slots.size() - 1;
+    // nodes are heap allocated, so the low bits carry no information
+    auto hash = reinterpret_cast<std::uintptr_t>(t_id) >> 4;
+    hash *= 0x9E3779B97F4A7C15ull;
+    std::size_t i = static_cast<std::size_t>(hash >> 16) & mask;
+    while (m_slots[i].first != nullptr && m_slots[i].first != t_id) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  auto grow() -> void {
+    std::vector<std::pair<const void *, std::size_t>> old{};
+    old.swap(m_slots);
+    m_slots.assign(old.empty() ? 64 : 2 * old.size(), {nullptr, 0});
+    for (const auto &slot : old) {
+      if (slot.first != nullptr) {
+        m_slots[probe(slot.first)] = slot;
+      }
+    }
+  }
+
+  std::vector<std::pair<const void *, std::size_t>> m_slots{};
+  std::size_t m_size{};
+};
+
+/**
+ * @brief Nodes reachable from a symbol ordered such that every node precedes
+ * its operands (the root comes first). The operands of `nodes[i]` are
+ * `nodes[operands[k]]` for k in [offsets[i], offsets[i + 1]), in the same
+ * order as its edges.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+struct TopologicalOrder {
+  std::vector<const RSym<T> *> nodes{};
+  std::vector<std::size_t> offsets{};
+  std::vector<std::size_t> operands{};
+};
+
+/**
+ * @brief Linearizes the graph of `variable`, visiting each shared node once
+ * and resolving every edge with a single hash lookup.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto topological_order(const RSym<T> &variable) -> TopologicalOrder<T> {
+  AD_TRACE_SCOPE("ad::topological_order");
+  // nodes and edges numbered in discovery order
+  std::vector<const RSym<T> *> found{&variable};
+  std::vector<std::size_t> found_offsets{0};
+  std::vector<std::size_t> found_operands(variable.edges().size());
+  NodeIndex discovered{};
+  discovered.emplace(variable.id(), 0);
+
+  std::vector<std::size_t> post_order{};
+  std::vector<std::pair<std::size_t, std::size_t>> stack{{0, 0}};
+
+  while (!stack.empty()) {
+    auto &[current, next] = stack.back();
+    const auto &edges = found[current]->edges();
+    if (next == edges.size()) {
+      post_order.push_back(current);
+      stack.pop_back();
+      continue;
+    }
+    const RSym<T> &child = edges[next].first;
+    const std::size_t slot = found_offsets[current] + next++;
+
+    const auto [index, inserted] = discovered.emplace(child.id(), found.size());
+    found_operands[slot] = index;
+    if (inserted) {
+      found.push_back(&child);
+      found_offsets.push_back(found_operands.size());
+      if (child.edges().empty()) {
+        post_order.push_back(index);
+      } else {
+        found_operands.resize(found_operands.size() + child.edges().size());
+        stack.emplace_back(index, 0);
+      }
+    }
+  }
+
+  std::vector<std::size_t> rank(found.size());
+  for (std::size_t i = 0; i < post_order.size(); ++i) {
+    rank[post_order[i]] = post_order.size() - 1 - i;
+  }
+
+  TopologicalOrder<T> result{};
+  result.nodes.resize(found.size());
+  result.offsets.reserve(found.size() + 1);
+  result.operands.reserve(found_operands.size());
+  result.offsets.push_back(0);
+
+  for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+    const std::size_t begin = found_offsets[*it];
+    const std::size_t end = begin + found[*it]->edges().size();
+    for (std::size_t k = begin; k < end; ++k) {
+      result.operands.push_back(rank[found_operands[k]]);
+    }
+    result.nodes[rank[*it]] = found[*it];
+    result.offsets.push_back(result.operands.size());
+  }
+  return result;
+}
+
+/**
+ * @brief Number of nodes on the longest path from the root of `t_order` to a
+ * leaf.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto graph_depth(const TopologicalOrder<T> &t_order) -> std::size_t {
+  std::vector<std::size_t> depth(t_order.nodes.size(), 1);
+  std::size_t result = depth.empty() ? 0 : 1;
+  for (std::size_t i = 0; i < t_order.nodes.size(); ++i) {
+    for (std::size_t k = t_order.offsets[i]; k < t_order.offsets[i + 1]; ++k) {
+      auto &operand = depth[t_order.operands[k]];
+      operand = std::max(operand, depth[i] + 1);
+      result = std::max(result, operand);
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Publishes the `Stats` of a gradient call that started its sweep at
+ * `t_begin`.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto record_sweep(const TopologicalOrder<T> &t_order,
+                  Stats::clock::time_point t_begin) -> void {
+  const auto end = Stats::clock::now();
+  Stats::sweep_end(t_begin, end, t_order.operands.size(),
+                   graph_depth(t_order));
+}
+
+/**
+ * @brief Propagates adjoints from the root through the graph in reverse
+ * topological order. Every node and edge is visited once, so the sweep is
+ * O(nodes + edges) even when subexpressions are shared. Adjoints are
+ * accumulated as `A`, which may be wider than the stored partials.
+ *
+ * @return adjoints indexed like `t_order.nodes`.
+ */
+template <typename T, typename A = T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T> &&
+                                               std::is_floating_point_v<A>>>
+auto backward(const TopologicalOrder<T> &t_order) -> std::vector<A> {
+  AD_TRACE_SCOPE("ad::backward");
+  std::vector<A> adjoints(t_order.nodes.size(), A{});
+  if (!adjoints.empty()) {
+    adjoints.front() = A{1};
+  }
+
+  for (std::size_t i = 0; i < t_order.nodes.size(); ++i) {
+    const auto &edges = t_order.nodes[i]->edges();
+    const std::size_t offset = t_order.offsets[i];
+    for (std::size_t k = 0; k < edges.size(); ++k) {
+      adjoints[t_order.operands[offset + k]] +=
+          adjoints[i] * static_cast<A>(edges[k].second);
+    }
+  }
+  return adjoints;
+}
+
 template <typename T,
           typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
 auto gradient(const RSym<T> &variable) -> std::map<RSym<T>, T> {
+  AD_TRACE_SCOPE("ad::gradient");
   std::map<RSym<T>, T> _gradients{};
 
-  std::function<auto(const RSym<T> &, T)->void> _compute_gradient =
-      [&_compute_gradient, &_gradients](const RSym<T> &variable, T path_value) {
-        T value_of_path_to_child{};
+  Stats::clock::time_point begin{};
+  if constexpr (stats_enabled) {
+    begin = Stats::sweep_begin();
+  }
+  const auto order = topological_order(variable);
+  const auto adjoints = backward(order);
 
-        for (auto &[child, local_gradient] : variable.local_gradient()) {
-          value_of_path_to_child = path_value * local_gradient;
-          _gradients[child] += value_of_path_to_child;
+  for (std::size_t i = 1; i < order.nodes.size(); ++i) {
+    _gradients[*order.nodes[i]] += adjoints[i];
+  }
 
-          _compute_gradient(child, value_of_path_to_child);
-        }
-      };
+  if constexpr (stats_enabled) {
+    record_sweep(order, begin);
+  }
+  return _gradients;
+}
+
+/**
+ * @brief Picks the adjoints of the symbols of `wrt` out of `t_adjoints`,
+ * which is indexed like `t_order.nodes`, matching by node identity. Symbols
+ * outside of the graph get 0.
+ */
+template <typename T, typename A,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto select_adjoints(const TopologicalOrder<T> &t_order,
+                     const std::vector<A> &t_adjoints,
+                     const std::vector<RSym<T>> &wrt) -> std::vector<A> {
+  NodeIndex by_node{};
+  std::vector<std::size_t> slots{};
+  slots.reserve(wrt.size());
+  for (const auto &w : wrt) {
+    slots.push_back(by_node.emplace(w.id(), by_node.size()).first);
+  }
 
-  _compute_gradient(variable, 1);
+  std::vector<A> unique(by_node.size(), A{});
+  for (std::size_t i = 0; i < t_order.nodes.size(); ++i) {
+    if (const auto *slot = by_node.find(t_order.nodes[i]->id())) {
+      unique[*slot] = t_adjoints[i];
+    }
+  }
 
-  return _gradients;
+  std::vector<A> result{};
+  result.reserve(wrt.size());
+  for (const auto slot : slots) {
+    result.push_back(unique[slot]);
+  }
+  return result;
+}
+
+/**
+ * @brief Computes the partial derivatives of `variable` with respect to each
+ * symbol of `wrt`, matched by node identity rather than by value. E.g.
+ * `gradient<float, double>(y, wrt)` accumulates a float graph in double.
+ */
+template <typename T, typename A = T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T> &&
+                                               std::is_floating_point_v<A>>>
+auto gradient(const RSym<T> &variable, const std::vector<RSym<T>> &wrt)
+    -> std::vector<A> {
+  AD_TRACE_SCOPE("ad::gradient");
+  Stats::clock::time_point begin{};
+  if constexpr (stats_enabled) {
+    begin = Stats::sweep_begin();
+  }
+  const auto order = topological_order(variable);
+  auto result = select_adjoints(order, backward<T, A>(order), wrt);
+
+  if constexpr (stats_enabled) {
+    record_sweep(order, begin);
+  }
+  return result;
 }
 
 }; // namespace ad
 
-#endif // __RSYMBOL_H__
\ No newline at end of file
+#endif // __RSYMBOL_H__
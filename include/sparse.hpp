@@ -0,0 +1,518 @@
+#ifndef __SPARSE_H__
+#define __SPARSE_H__
+
+#include "../include/matrix.hpp"
+#include "../include/parallel.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/**
+ * @brief Whether a `SparseMatrix` compresses its rows (CSR) or its columns
+ * (CSC).
+ */
+enum class SparseLayout { Row, Column };
+
+/** @brief A nonzero given by its coordinates */
+template <typename T> struct SparseEntry {
+  std::size_t row;
+  std::size_t col;
+  T value;
+};
+
+/** @brief Rows processed per chunk by the parallel kernels */
+constexpr std::size_t sparse_grain = 4096;
+
+/**
+ * @brief A sparse matrix in compressed sparse row or column form. The
+ * nonzeros of outer index `o` (a row for CSR, a column for CSC) are
+ * `values[offsets[o] .. offsets[o + 1]]`, at the inner indices `indices` of
+ * the same range, sorted and unique. The CSR form of a matrix is the CSC form
+ * of its transpose over the same arrays.
+ *
+ * @tparam T
+ * @tparam L the compressed dimension
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
+template <typename T, SparseLayout L = SparseLayout::Row,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class SparseMatrix {
+public:
+  static constexpr SparseLayout layout = L;
+  /** @brief The layout of the transpose over the same arrays */
+  static constexpr SparseLayout transposed_layout =
+      L == SparseLayout::Row ? SparseLayout::Column : SparseLayout::Row;
+
+  SparseMatrix(std::size_t t_rows, std::size_t t_cols)
+      : m_rows(t_rows), m_cols(t_cols), m_offsets(outer(t_rows, t_cols) + 1) {}
+
+  /**
+   * @brief Adopts compressed arrays, which are checked for consistent sizes,
+   * non-decreasing offsets and sorted, in-range inner indices.
+   */
+  SparseMatrix(std::size_t t_rows, std::size_t t_cols,
+               std::vector<std::size_t> t_offsets,
+               std::vector<std::size_t> t_indices, std::vector<T> t_values)
+      : m_rows(t_rows), m_cols(t_cols), m_offsets(std::move(t_offsets)),
+        m_indices(std::move(t_indices)), m_values(std::move(t_values)) {
+    const std::size_t inner_size = inner(m_rows, m_cols);
+    if (m_offsets.size() != outer(m_rows, m_cols) + 1 ||
+        m_offsets.front() != 0 || m_offsets.back() != m_indices.size() ||
+        m_indices.size() != m_values.size()) {
+      throw std::invalid_argument("ad::SparseMatrix: inconsistent arrays");
+    }
+    for (std::size_t o = 0; o + 1 < m_offsets.size(); ++o) {
+      if (m_offsets[o] > m_offsets[o + 1] ||
+          m_offsets[o + 1] > m_indices.size()) {
+        throw std::invalid_argument("ad::SparseMatrix: decreasing offsets");
+      }
+      for (std::size_t k = m_offsets[o]; k < m_offsets[o + 1]; ++k) {
+        if (m_indices[k] >= inner_size ||
+            (k > m_offsets[o] && m_indices[k] <= m_indices[k - 1])) {
+          throw std::invalid_argument(
+              "ad::SparseMatrix: unsorted or out of range indices");
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Builds the matrix from nonzeros in any order, summing duplicates.
+   */
+  static auto from_entries(std::size_t t_rows, std::size_t t_cols,
+                           const std::vector<SparseEntry<T>> &t_entries)
+      -> SparseMatrix {
+    SparseMatrix result{t_rows, t_cols};
+    auto &offsets = result.m_offsets;
+    for (const auto &entry : t_entries) {
+      if (entry.row >= t_rows || entry.col >= t_cols) {
+        throw std::out_of_range("ad::SparseMatrix: entry out of range");
+      }
+      ++offsets[major(entry) + 1];
+    }
+    for (std::size_t o = 1; o < offsets.size(); ++o) {
+      offsets[o] += offsets[o - 1];
+    }
+
+    // counting sort by outer index, then sort and merge within each
+    std::vector<std::pair<std::size_t, T>> sorted(t_entries.size());
+    std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+    for (const auto &entry : t_entries) {
+      sorted[next[major(entry)]++] = {minor(entry), entry.value};
+    }
+    std::vector<std::size_t> merged{0};
+    merged.reserve(offsets.size());
+    for (std::size_t o = 0; o + 1 < offsets.size(); ++o) {
+      const auto first = sorted.begin() + offsets[o];
+      const auto last = sorted.begin() + offsets[o + 1];
+      std::sort(first, last, [](const auto &a, const auto &b) {
+        return a.first < b.first;
+      });
+      for (auto it = first; it != last; ++it) {
+        if (result.m_indices.size() > merged.back() &&
+            result.m_indices.back() == it->first) {
+          result.m_values.back() += it->second;
+        } else {
+          result.m_indices.push_back(it->first);
+          result.m_values.push_back(it->second);
+        }
+      }
+      merged.push_back(result.m_indices.size());
+    }
+    offsets = std::move(merged);
+    return result;
+  }
+
+  auto rows() const noexcept -> std::size_t { return m_rows; }
+  auto cols() const noexcept -> std::size_t { return m_cols; }
+  auto dims() const noexcept -> std::pair<std::size_t, std::size_t> {
+    return {m_rows, m_cols};
+  }
+  auto nonzeros() const noexcept -> std::size_t { return m_values.size(); }
+
+  auto offsets() const noexcept -> const std::vector<std::size_t> & {
+    return m_offsets;
+  }
+  auto indices() const noexcept -> const std::vector<std::size_t> & {
+    return m_indices;
+  }
+  auto values() const noexcept -> const std::vector<T> & { return m_values; }
+  /** @brief The nonzeros may be updated in place; the pattern is fixed */
+  auto values() noexcept -> std::vector<T> & { return m_values; }
+
+  /** @brief The entry at (`t_row`, `t_col`), zero if not stored */
+  auto at(std::size_t t_row, std::size_t t_col) const -> T {
+    assert(t_row < m_rows && t_col < m_cols);
+    const std::size_t o = L == SparseLayout::Row ? t_row : t_col;
+    const std::size_t i = L == SparseLayout::Row ? t_col : t_row;
+    const auto first = m_indices.begin() + m_offsets[o];
+    const auto last = m_indices.begin() + m_offsets[o + 1];
+    const auto it = std::lower_bound(first, last, i);
+    return it != last && *it == i ? m_values[it - m_indices.begin()] : T{};
+  }
+
+  /** @brief The transpose: a copy of the arrays, read in the other layout */
+  auto transpose() const -> SparseMatrix<T, transposed_layout> {
+    using Result = SparseMatrix<T, transposed_layout>;
+    return Result{typename Result::Unchecked{}, m_cols, m_rows, m_offsets,
+                  m_indices, m_values};
+  }
+
+  /** @brief The same matrix compressed the other way */
+  auto convert() const -> SparseMatrix<T, transposed_layout> {
+    const std::size_t inner_size = inner(m_rows, m_cols);
+    std::vector<std::size_t> offsets(inner_size + 1, 0);
+    for (const auto i : m_indices) {
+      ++offsets[i + 1];
+    }
+    for (std::size_t i = 1; i < offsets.size(); ++i) {
+      offsets[i] += offsets[i - 1];
+    }
+    std::vector<std::size_t> indices(nonzeros());
+    std::vector<T> values(nonzeros());
+    std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+    for (std::size_t o = 0; o + 1 < m_offsets.size(); ++o) {
+      for (std::size_t k = m_offsets[o]; k < m_offsets[o + 1]; ++k) {
+        const std::size_t slot = next[m_indices[k]]++;
+        indices[slot] = o;
+        values[slot] = m_values[k];
+      }
+    }
+    using Result = SparseMatrix<T, transposed_layout>;
+    return Result{typename Result::Unchecked{}, m_rows, m_cols,
+                  std::move(offsets), std::move(indices), std::move(values)};
+  }
+
+  /** @brief The row of each nonzero, in storage order */
+  auto row_of(std::size_t t_nonzero) const noexcept -> std::size_t {
+    return L == SparseLayout::Row ? outer_of(t_nonzero) : m_indices[t_nonzero];
+  }
+  /** @brief The column of each nonzero, in storage order */
+  auto col_of(std::size_t t_nonzero) const noexcept -> std::size_t {
+    return L == SparseLayout::Row ? m_indices[t_nonzero] : outer_of(t_nonzero);
+  }
+
+private:
+  template <typename, SparseLayout, typename> friend class SparseMatrix;
+
+  // arrays known to be valid, e.g. those of another matrix, are adopted
+  // without the checks of the public constructor
+  struct Unchecked {};
+  SparseMatrix(Unchecked, std::size_t t_rows, std::size_t t_cols,
+               std::vector<std::size_t> t_offsets,
+               std::vector<std::size_t> t_indices, std::vector<T> t_values)
+      : m_rows(t_rows), m_cols(t_cols), m_offsets(std::move(t_offsets)),
+        m_indices(std::move(t_indices)), m_values(std::move(t_values)) {}
+
+  static constexpr auto outer(std::size_t t_rows, std::size_t t_cols) noexcept
+      -> std::size_t {
+    return L == SparseLayout::Row ? t_rows : t_cols;
+  }
+  static constexpr auto inner(std::size_t t_rows, std::size_t t_cols) noexcept
+      -> std::size_t {
+    return L == SparseLayout::Row ? t_cols : t_rows;
+  }
+  static auto major(const SparseEntry<T> &t_entry) noexcept -> std::size_t {
+    return L == SparseLayout::Row ? t_entry.row : t_entry.col;
+  }
+  static auto minor(const SparseEntry<T> &t_entry) noexcept -> std::size_t {
+    return L == SparseLayout::Row ? t_entry.col : t_entry.row;
+  }
+  auto outer_of(std::size_t t_nonzero) const noexcept -> std::size_t {
+    const auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(),
+                                     t_nonzero);
+    return static_cast<std::size_t>(it - m_offsets.begin()) - 1;
+  }
+
+  std::size_t m_rows;
+  std::size_t m_cols;
+  std::vector<std::size_t> m_offsets;
+  std::vector<std::size_t> m_indices{};
+  std::vector<T> m_values{};
+};
+
+template <typename T> using CsrMatrix = SparseMatrix<T, SparseLayout::Row>;
+template <typename T> using CscMatrix = SparseMatrix<T, SparseLayout::Column>;
+
+/**
+ * @brief y = M x for the matrix M whose outer index is the row, i.e. a CSR
+ * matrix or the transpose of a CSC one. Rows are independent, so they are
+ * split across threads.
+ */
+template <typename T, SparseLayout L>
+auto sparse_gather(const SparseMatrix<T, L> &t_matrix, const T *x, T *y,
+                   std::size_t t_outer) -> void {
+  const std::size_t *offsets = t_matrix.offsets().data();
+  const std::size_t *indices = t_matrix.indices().data();
+  const T *values = t_matrix.values().data();
+  const auto gather = [=](std::size_t t_begin, std::size_t t_end,
+                          std::size_t) {
+    for (std::size_t o = t_begin; o < t_end; ++o) {
+      T sum{};
+      for (std::size_t k = offsets[o]; k < offsets[o + 1]; ++k) {
+        sum += values[k] * x[indices[k]];
+      }
+      y[o] = sum;
+    }
+  };
+  parallel_for(t_outer, sparse_grain, gather);
+}
+
+/**
+ * @brief y = M x for the matrix M whose outer index is the column, i.e. a CSC
+ * matrix or the transpose of a CSR one. Each thread scatters its columns into
+ * a private copy of y, summed at the end.
+ */
+template <typename T, SparseLayout L>
+auto sparse_scatter(const SparseMatrix<T, L> &t_matrix, const T *x, T *y,
+                    std::size_t t_outer, std::size_t t_inner) -> void {
+  const std::size_t *offsets = t_matrix.offsets().data();
+  const std::size_t *indices = t_matrix.indices().data();
+  const T *values = t_matrix.values().data();
+  const std::size_t chunks = parallel_chunks(t_outer, sparse_grain);
+  std::vector<T> partial((chunks - 1) * t_inner, T{});
+  std::fill(y, y + t_inner, T{});
+  const auto scatter = [&](std::size_t t_begin, std::size_t t_end,
+                           std::size_t t_chunk) {
+    T *target = t_chunk == 0 ? y : partial.data() + (t_chunk - 1) * t_inner;
+    for (std::size_t o = t_begin; o < t_end; ++o) {
+      for (std::size_t k = offsets[o]; k < offsets[o + 1]; ++k) {
+        target[indices[k]] += values[k] * x[o];
+      }
+    }
+  };
+  parallel_for(t_outer, sparse_grain, scatter);
+  for (std::size_t c = 1; c < chunks; ++c) {
+    const T *source = partial.data() + (c - 1) * t_inner;
+    for (std::size_t i = 0; i < t_inner; ++i) {
+      y[i] += source[i];
+    }
+  }
+}
+
+/** @brief Sparse matrix-vector product A x */
+template <typename T, SparseLayout L>
+auto multiply(const SparseMatrix<T, L> &A, const std::vector<T> &x)
+    -> std::vector<T> {
+  AD_TRACE_SCOPE("ad::SparseMatrix::multiply");
+  assert(x.size() == A.cols());
+  std::vector<T> y(A.rows());
+  if constexpr (L == SparseLayout::Row) {
+    sparse_gather(A, x.data(), y.data(), A.rows());
+  } else {
+    sparse_scatter(A, x.data(), y.data(), A.cols(), A.rows());
+  }
+  return y;
+}
+
+/** @brief A^T x, without forming the transpose */
+template <typename T, SparseLayout L>
+auto multiply_transpose(const SparseMatrix<T, L> &A, const std::vector<T> &x)
+    -> std::vector<T> {
+  AD_TRACE_SCOPE("ad::SparseMatrix::multiply_transpose");
+  assert(x.size() == A.rows());
+  std::vector<T> y(A.cols());
+  if constexpr (L == SparseLayout::Row) {
+    sparse_scatter(A, x.data(), y.data(), A.rows(), A.cols());
+  } else {
+    sparse_gather(A, x.data(), y.data(), A.cols());
+  }
+  return y;
+}
+
+/**
+ * @brief Sparse times dense product A B. A CSC matrix is converted to CSR
+ * first, so that every row of the result is written by a single thread.
+ */
+template <typename T, SparseLayout L>
+auto multiply(const SparseMatrix<T, L> &A, const RectMatrix<T> &B)
+    -> RectMatrix<T> {
+  AD_TRACE_SCOPE("ad::SparseMatrix::multiply");
+  if constexpr (L == SparseLayout::Column) {
+    return multiply(A.convert(), B);
+  } else {
+    const std::size_t width = B.dims().second;
+    assert(B.dims().first == A.cols());
+    RectMatrix<T> C(A.rows(), width);
+    if (width == 0) {
+      return C;
+    }
+    parallel_for(A.rows(), sparse_grain,
+                 [&](std::size_t t_begin, std::size_t t_end, std::size_t) {
+                   for (std::size_t i = t_begin; i < t_end; ++i) {
+                     T *row = &C.at(i, 0);
+                     for (std::size_t k = A.offsets()[i];
+                          k < A.offsets()[i + 1]; ++k) {
+                       const T a = A.values()[k];
+                       const T *b = &B.at(A.indices()[k], 0);
+                       for (std::size_t j = 0; j < width; ++j) {
+                         row[j] += a * b[j];
+                       }
+                     }
+                   }
+                 });
+    return C;
+  }
+}
+
+/**
+ * @brief Gradients of a scalar loss through a sparse product, given the
+ * adjoint of the product: `values` follows the nonzeros of the matrix in
+ * storage order and `operand` has the shape of the dense operand.
+ */
+template <typename T, typename D> struct SparseAdjoint {
+  std::vector<T> values;
+  D operand;
+};
+
+/**
+ * @brief u_i v_j for every nonzero (i, j) of `A`, in storage order: the
+ * gradient of u^T A v with respect to the nonzeros.
+ */
+template <typename T, SparseLayout L>
+auto sparse_outer(const SparseMatrix<T, L> &A, const std::vector<T> &u,
+                  const std::vector<T> &v) -> std::vector<T> {
+  std::vector<T> result(A.nonzeros());
+  const auto &offsets = A.offsets();
+  const auto &indices = A.indices();
+  const auto &outer = L == SparseLayout::Row ? u : v;
+  const auto &inner = L == SparseLayout::Row ? v : u;
+  const auto products = [&](std::size_t t_begin, std::size_t t_end,
+                            std::size_t) {
+    for (std::size_t o = t_begin; o < t_end; ++o) {
+      for (std::size_t k = offsets[o]; k < offsets[o + 1]; ++k) {
+        result[k] = outer[o] * inner[indices[k]];
+      }
+    }
+  };
+  parallel_for(offsets.size() - 1, sparse_grain, products);
+  return result;
+}
+
+/**
+ * @brief Reverse mode rule of y = A x: given ybar = dL/dy, returns
+ * dL/dA_ij = ybar_i x_j on the nonzeros of A only, and dL/dx = A^T ybar.
+ */
+template <typename T, SparseLayout L>
+auto multiply_adjoint(const SparseMatrix<T, L> &A, const std::vector<T> &x,
+                      const std::vector<T> &t_adjoint)
+    -> SparseAdjoint<T, std::vector<T>> {
+  AD_TRACE_SCOPE("ad::SparseMatrix::multiply_adjoint");
+  assert(x.size() == A.cols() && t_adjoint.size() == A.rows());
+  return {sparse_outer(A, t_adjoint, x), multiply_transpose(A, t_adjoint)};
+}
+
+/**
+ * @brief Reverse mode rule of y = A^T x: given ybar, returns
+ * dL/dA_ij = x_i ybar_j on the nonzeros of A, and dL/dx = A ybar.
+ */
+template <typename T, SparseLayout L>
+auto multiply_transpose_adjoint(const SparseMatrix<T, L> &A,
+                                const std::vector<T> &x,
+                                const std::vector<T> &t_adjoint)
+    -> SparseAdjoint<T, std::vector<T>> {
+  AD_TRACE_SCOPE("ad::SparseMatrix::multiply_transpose_adjoint");
+  assert(x.size() == A.rows() && t_adjoint.size() == A.cols());
+  return {sparse_outer(A, x, t_adjoint), multiply(A, t_adjoint)};
+}
+
+/**
+ * @brief Reverse mode rule of C = A B: given Cbar, returns
+ * dL/dA_ij = <Cbar_i, B_j> over the rows of Cbar and B on the nonzeros of A,
+ * and dL/dB = A^T Cbar.
+ */
+template <typename T, SparseLayout L>
+auto multiply_adjoint(const SparseMatrix<T, L> &A, const RectMatrix<T> &B,
+                      const RectMatrix<T> &t_adjoint)
+    -> SparseAdjoint<T, RectMatrix<T>> {
+  AD_TRACE_SCOPE("ad::SparseMatrix::multiply_adjoint");
+  const std::size_t width = B.dims().second;
+  assert(t_adjoint.dims() == std::make_pair(A.rows(), width));
+  std::vector<T> values(A.nonzeros());
+  RectMatrix<T> operand(A.cols(), width);
+  if (width == 0) {
+    return {std::move(values), std::move(operand)};
+  }
+  // dL/dB = A^T Cbar scatters into the rows of B, so it stays serial
+  for (std::size_t k = 0; k < A.nonzeros(); ++k) {
+    const T *c = &t_adjoint.at(A.row_of(k), 0);
+    const T *b = &B.at(A.col_of(k), 0);
+    T *target = &operand.at(A.col_of(k), 0);
+    T sum{};
+    for (std::size_t j = 0; j < width; ++j) {
+      sum += c[j] * b[j];
+      target[j] += A.values()[k] * c[j];
+    }
+    values[k] = sum;
+  }
+  return {std::move(values), std::move(operand)};
+}
+
+/**
+ * @brief A x for a vector of symbols: one node per row whose edges lead to
+ * the entries of x it reads, weighted by the nonzeros, so reverse mode visits
+ * only the nonzeros.
+ */
+template <typename T, SparseLayout L>
+auto multiply(const SparseMatrix<T, L> &A, const std::vector<RSym<T>> &x)
+    -> std::vector<RSym<T>> {
+  if constexpr (L == SparseLayout::Column) {
+    return multiply(A.convert(), x);
+  } else {
+    assert(x.size() == A.cols());
+    std::vector<RSym<T>> y{};
+    y.reserve(A.rows());
+    for (std::size_t i = 0; i < A.rows(); ++i) {
+      std::vector<typename RSym<T>::edge_type> edges{};
+      edges.reserve(A.offsets()[i + 1] - A.offsets()[i]);
+      T value{};
+      for (std::size_t k = A.offsets()[i]; k < A.offsets()[i + 1]; ++k) {
+        const auto &operand = x[A.indices()[k]];
+        value += A.values()[k] * operand.value();
+        edges.emplace_back(operand, A.values()[k]);
+      }
+      y.emplace_back(value, std::move(edges));
+    }
+    return y;
+  }
+}
+
+/**
+ * @brief A x where the nonzeros of A are themselves symbols, given in the
+ * storage order of the pattern `A`, whose values are ignored. Each row node
+ * has two edges per nonzero, to its value and to the entry of x.
+ */
+template <typename T, SparseLayout L>
+auto multiply(const SparseMatrix<T, L> &A, const std::vector<RSym<T>> &values,
+              const std::vector<RSym<T>> &x) -> std::vector<RSym<T>> {
+  assert(values.size() == A.nonzeros() && x.size() == A.cols());
+  std::vector<T> sums(A.rows(), T{});
+  std::vector<std::vector<typename RSym<T>::edge_type>> edges(A.rows());
+  for (std::size_t k = 0; k < A.nonzeros(); ++k) {
+    const std::size_t i = A.row_of(k);
+    const auto &a = values[k];
+    const auto &operand = x[A.col_of(k)];
+    sums[i] += a.value() * operand.value();
+    edges[i].emplace_back(a, operand.value());
+    edges[i].emplace_back(operand, a.value());
+  }
+  std::vector<RSym<T>> y{};
+  y.reserve(A.rows());
+  for (std::size_t i = 0; i < A.rows(); ++i) {
+    y.emplace_back(sums[i], std::move(edges[i]));
+  }
+  return y;
+}
+
+} // namespace ad
+
+#endif // __SPARSE_H__
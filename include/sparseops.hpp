@@ -0,0 +1,37 @@
+#ifndef __SPARSEOPS_H__
+#define __SPARSEOPS_H__
+
+#include "../include/ops.hpp"
+#include "../include/ssymbol.hpp"
+
+#include <cmath>
+#include <cstddef>
+
+using ad::SSym;
+
+template <typename T, std::size_t N>
+auto pow(const SSym<T, N> &base, const SSym<T, N> &exp) -> SSym<T, N> {
+  const T value = std::pow(base.value(), exp.value());
+  const auto [df_base, df_exp] =
+      ad::pow_partials(base.value(), exp.value(), value);
+  return {value, ad::SparseTangent<T, N>::combine(df_base, base.tangent(),
+                                                  df_exp, exp.tangent())};
+}
+
+template <typename T, std::size_t N>
+auto pow(const SSym<T, N> &base, T exp) -> SSym<T, N> {
+  const auto [value, df] = ad::local<ad::Op::PowConst>(base.value(), exp);
+  return {value, base.tangent().scaled(df)};
+}
+
+// exp, ln, sin, ..., acsch from the table in `ops.hpp`
+#define AD_SPARSE_UNARY(NAME, OP, VALUE, PARTIAL)                              \
+  template <typename T, std::size_t N>                                         \
+  auto NAME(const SSym<T, N> &rhs) -> SSym<T, N> {                             \
+    const auto [value, df] = ad::local<ad::Op::OP>(rhs.value(), T{});          \
+    return {value, rhs.tangent().scaled(df)};                                  \
+  }
+AD_UNARY_OPS(AD_SPARSE_UNARY)
+#undef AD_SPARSE_UNARY
+
+#endif // __SPARSEOPS_H__
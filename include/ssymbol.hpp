@@ -0,0 +1,248 @@
+#ifndef __SSYMBOL_H__
+#define __SSYMBOL_H__
+
+#include "../include/allocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/**
+ * @brief A sparse vector of partial derivatives, as entries sorted by index.
+ * Up to `N` entries are stored inline; longer vectors spill to a buffer from
+ * the `BufferPool` of the thread. Entries that cancel to 0 are kept, so the
+ * indices are the structural nonzeros of the derivative.
+ */
+template <typename T, std::size_t N = 4> class SparseTangent {
+public:
+  struct Entry {
+    std::size_t index;
+    T value;
+  };
+
+public:
+  SparseTangent() = default;
+  /** @brief The tangent `t_value` e_`t_index` */
+  SparseTangent(std::size_t t_index, T t_value) : m_size(1) {
+    m_inline[0] = {t_index, t_value};
+  }
+  SparseTangent(const SparseTangent &) = default;
+  auto operator=(const SparseTangent &) -> SparseTangent & = default;
+  /** @brief Takes the entries of `other`, which is left empty */
+  SparseTangent(SparseTangent &&other) noexcept
+      : m_size(std::exchange(other.m_size, 0)), m_inline(other.m_inline),
+        m_spilled(std::move(other.m_spilled)) {
+    other.m_spilled.clear();
+  }
+  auto operator=(SparseTangent &&other) noexcept -> SparseTangent & {
+    if (this == &other) {
+      return *this;
+    }
+    m_size = std::exchange(other.m_size, 0);
+    m_inline = other.m_inline;
+    m_spilled = std::move(other.m_spilled);
+    other.m_spilled.clear();
+    return *this;
+  }
+
+  auto size() const noexcept -> std::size_t { return m_size; }
+  auto empty() const noexcept -> bool { return m_size == 0; }
+  /** @brief Whether the entries live in a pooled buffer */
+  auto spilled() const noexcept -> bool { return !m_spilled.empty(); }
+
+  auto begin() const noexcept -> const Entry * { return data(); }
+  auto end() const noexcept -> const Entry * { return data() + m_size; }
+
+  /** @brief The entry at `t_index`, 0 where there is none */
+  auto coefficient(std::size_t t_index) const noexcept -> T {
+    const Entry *it = std::lower_bound(
+        begin(), end(), t_index,
+        [](const Entry &e, std::size_t i) { return e.index < i; });
+    return it != end() && it->index == t_index ? it->value : T{};
+  }
+
+  auto scaled(T a) const -> SparseTangent {
+    SparseTangent result{*this};
+    for (Entry *e = result.data(); e != result.data() + result.m_size; ++e) {
+      e->value *= a;
+    }
+    return result;
+  }
+
+  /** @brief a x + b y, by merging the sorted entries of x and y */
+  static auto combine(T a, const SparseTangent &x, T b,
+                      const SparseTangent &y) -> SparseTangent {
+    if (y.empty()) {
+      return x.scaled(a);
+    }
+    if (x.empty()) {
+      return y.scaled(b);
+    }
+    SparseTangent result{};
+    Entry *out = result.reserve(x.size() + y.size());
+    const Entry *i = x.begin();
+    const Entry *j = y.begin();
+    while (i != x.end() && j != y.end()) {
+      if (i->index < j->index) {
+        *out++ = {i->index, a * i->value};
+        ++i;
+      } else if (j->index < i->index) {
+        *out++ = {j->index, b * j->value};
+        ++j;
+      } else {
+        *out++ = {i->index, a * i->value + b * j->value};
+        ++i;
+        ++j;
+      }
+    }
+    for (; i != x.end(); ++i) {
+      *out++ = {i->index, a * i->value};
+    }
+    for (; j != y.end(); ++j) {
+      *out++ = {j->index, b * j->value};
+    }
+    result.finish(out);
+    return result;
+  }
+
+private:
+  auto data() noexcept -> Entry * {
+    return spilled() ? m_spilled.data() : m_inline.data();
+  }
+  auto data() const noexcept -> const Entry * {
+    return spilled() ? m_spilled.data() : m_inline.data();
+  }
+
+  /** @brief Room for `t_count` entries, to be closed by `finish` */
+  auto reserve(std::size_t t_count) -> Entry * {
+    if (t_count > N) {
+      m_spilled.resize(t_count);
+    }
+    return data();
+  }
+
+  // moves back inline what fits after indices merged
+  auto finish(Entry *t_end) -> void {
+    m_size = static_cast<std::size_t>(t_end - data());
+    if (!spilled()) {
+      return;
+    }
+    if (m_size <= N) {
+      std::copy(m_spilled.begin(), m_spilled.begin() + m_size,
+                m_inline.begin());
+      m_spilled = {};
+    } else {
+      m_spilled.resize(m_size);
+    }
+  }
+
+  std::size_t m_size{};
+  std::array<Entry, N> m_inline{};
+  std::vector<Entry, PoolAllocator<Entry>> m_spilled{};
+};
+
+/**
+ * @brief Forward mode with a sparse tangent: the partial derivatives of the
+ * value with respect to every input it depends on, e.g. thousands of inputs
+ * of which each intermediate touches a few. Seeding each input with its own
+ * unit tangent (`variable`, `sparse_variables`) yields the whole gradient in
+ * one pass, each operation costing time proportional to the nonzeros of its
+ * operands, and a vector of outputs yields the rows of a sparse Jacobian.
+ *
+ * @tparam T
+ * @tparam N entries stored without allocating
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
+template <typename T, std::size_t N = 4,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+struct SSym {
+public:
+  using tangent_type = SparseTangent<T, N>;
+
+public:
+  SSym(T t_value) : m_value(t_value) {}
+  SSym(T t_value, tangent_type t_tangent)
+      : m_value(t_value), m_tangent(std::move(t_tangent)) {}
+
+  /** @brief Input `t_index` at `t_value`, with tangent e_`t_index` */
+  static auto variable(T t_value, std::size_t t_index) -> SSym {
+    return {t_value, tangent_type{t_index, T{1}}};
+  }
+
+  auto value() const noexcept -> T { return m_value; }
+  auto tangent() const noexcept -> const tangent_type & { return m_tangent; }
+  /** @brief The partial derivative with respect to input `t_index` */
+  auto df(std::size_t t_index) const noexcept -> T {
+    return m_tangent.coefficient(t_index);
+  }
+
+  auto operator<(const SSym &other) const noexcept -> bool {
+    return m_value < other.m_value;
+  }
+
+  auto operator>(const SSym &other) const noexcept -> bool {
+    return m_value > other.m_value;
+  }
+  auto operator==(const SSym &other) const noexcept -> bool {
+    return m_value == other.m_value;
+  }
+
+  auto operator!=(const SSym &other) const noexcept -> bool {
+    return m_value != other.m_value;
+  }
+
+private:
+  T m_value;
+  tangent_type m_tangent{};
+};
+
+/** @brief Input i of the result is `t_values[i]`, seeded with e_i */
+template <std::size_t N = 4, typename T>
+auto sparse_variables(const std::vector<T> &t_values)
+    -> std::vector<SSym<T, N>> {
+  std::vector<SSym<T, N>> result{};
+  result.reserve(t_values.size());
+  for (std::size_t i = 0; i < t_values.size(); ++i) {
+    result.push_back(SSym<T, N>::variable(t_values[i], i));
+  }
+  return result;
+}
+
+template <typename T, std::size_t N>
+auto operator+(const SSym<T, N> &lhs, const SSym<T, N> &rhs) -> SSym<T, N> {
+  return {lhs.value() + rhs.value(),
+          SparseTangent<T, N>::combine(T{1}, lhs.tangent(), T{1},
+                                       rhs.tangent())};
+}
+
+template <typename T, std::size_t N>
+auto operator-(const SSym<T, N> &lhs, const SSym<T, N> &rhs) -> SSym<T, N> {
+  return {lhs.value() - rhs.value(),
+          SparseTangent<T, N>::combine(T{1}, lhs.tangent(), T{-1},
+                                       rhs.tangent())};
+}
+
+template <typename T, std::size_t N>
+auto operator*(const SSym<T, N> &lhs, const SSym<T, N> &rhs) -> SSym<T, N> {
+  return {lhs.value() * rhs.value(),
+          SparseTangent<T, N>::combine(rhs.value(), lhs.tangent(),
+                                       lhs.value(), rhs.tangent())};
+}
+
+template <typename T, std::size_t N>
+auto operator/(const SSym<T, N> &lhs, const SSym<T, N> &rhs) -> SSym<T, N> {
+  const T inverse = T{1} / rhs.value();
+  const T value = lhs.value() * inverse;
+  return {value, SparseTangent<T, N>::combine(inverse, lhs.tangent(),
+                                              -value * inverse,
+                                              rhs.tangent())};
+}
+
+} // namespace ad
+
+#endif // __SSYMBOL_H__
@@ -0,0 +1,112 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "../include/ops.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace ad {
+
+/**
+ * @brief Whether reverse mode instrumentation is compiled in. Define `AD_STATS`
+ * before including any header of the library to enable it; otherwise every
+ * hook is discarded at compile time and `Stats` only reports zeros.
+ */
+#if defined(AD_STATS)
+constexpr bool stats_enabled = true;
+#else
+constexpr bool stats_enabled = false;
+#endif
+
+/** @brief Number of entries of `Op` */
+constexpr std::size_t op_count = static_cast<std::size_t>(Op::Chain) + 1;
+
+/**
+ * @brief What the reverse mode did for one call of `gradient`. The recording
+ * counters cover the nodes constructed on the thread since the previous call
+ * (or `Stats::reset`); the sweep counters cover the call itself.
+ */
+struct GradientStats {
+  std::size_t nodes{};
+  /** @brief Bytes of the nodes and their edge lists, without the
+   * `shared_ptr` control blocks */
+  std::size_t bytes{};
+  std::array<std::size_t, op_count> ops{};
+  std::chrono::nanoseconds recording{};
+
+  /** @brief Longest path from the root to a leaf, counted in nodes */
+  std::size_t max_depth{};
+  std::size_t edges{};
+  std::chrono::nanoseconds sweep{};
+
+  auto count(Op t_op) const noexcept -> std::size_t {
+    return ops[static_cast<std::size_t>(t_op)];
+  }
+};
+
+/**
+ * @brief Per-thread counters fed by the reverse mode. Recording time is the
+ * wall time between two gradient calls, so it also includes whatever else the
+ * caller did in between.
+ */
+class Stats {
+public:
+  using clock = std::chrono::steady_clock;
+
+  /** @brief Statistics of the last `gradient` call on this thread */
+  static auto last() noexcept -> const GradientStats & { return state().last; }
+
+  /** @brief Recording counters accumulated since the last `gradient` call */
+  static auto pending() noexcept -> const GradientStats & {
+    return state().pending;
+  }
+
+  static auto reset() noexcept -> void { state() = State{}; }
+
+  /** @brief Counts a node of `t_op` occupying `t_bytes` */
+  static auto node(Op t_op, std::size_t t_bytes) noexcept -> void {
+    auto &pending = state().pending;
+    ++pending.nodes;
+    pending.bytes += t_bytes;
+    ++pending.ops[static_cast<std::size_t>(t_op)];
+  }
+
+  /** @brief Closes the recording window and returns the sweep start time */
+  static auto sweep_begin() noexcept -> clock::time_point {
+    auto &s = state();
+    const auto now = clock::now();
+    s.pending.recording = now - s.mark;
+    return now;
+  }
+
+  /** @brief Publishes the statistics of a sweep over [t_begin, t_end) */
+  static auto sweep_end(clock::time_point t_begin, clock::time_point t_end,
+                        std::size_t t_edges, std::size_t t_depth) noexcept
+      -> void {
+    auto &s = state();
+    s.last = s.pending;
+    s.last.edges = t_edges;
+    s.last.max_depth = t_depth;
+    s.last.sweep = t_end - t_begin;
+    s.pending = GradientStats{};
+    s.mark = clock::now();
+  }
+
+private:
+  struct State {
+    GradientStats pending{};
+    GradientStats last{};
+    clock::time_point mark{clock::now()};
+  };
+
+  static auto state() noexcept -> State & {
+    thread_local State s{};
+    return s;
+  }
+};
+
+} // namespace ad
+
+#endif // __STATS_H__
@@ -0,0 +1,354 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include "../include/rsymbol.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ad {
+
+/**
+ * @brief A chunk of samples stored row-major, `columns` values per sample.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+struct SampleChunk {
+  const T *data{};
+  std::size_t rows{};
+  std::size_t columns{};
+
+  auto row(std::size_t t_index) const noexcept -> const T * {
+    return data + t_index * columns;
+  }
+};
+
+/**
+ * @brief A file read front to back through a POSIX descriptor, which can ask
+ * the kernel to read ahead while the caller computes.
+ */
+class FileSource {
+public:
+  explicit FileSource(const std::string &t_path)
+      : m_fd(::open(t_path.c_str(), O_RDONLY)) {
+    if (m_fd < 0) {
+      throw std::runtime_error("ad::FileSource: cannot open " + t_path);
+    }
+  }
+  FileSource(const FileSource &) = delete;
+  auto operator=(const FileSource &) -> FileSource & = delete;
+  ~FileSource() { ::close(m_fd); }
+
+  /** @brief Size of the file in bytes */
+  auto size() const -> std::size_t {
+    struct stat info {};
+    if (::fstat(m_fd, &info) != 0) {
+      throw std::runtime_error("ad::FileSource: cannot stat file");
+    }
+    return static_cast<std::size_t>(info.st_size);
+  }
+
+  /**
+   * @brief Reads up to `t_bytes` bytes into `t_data`.
+   *
+   * @return the number of bytes read, less than `t_bytes` only at the end.
+   */
+  auto read(char *t_data, std::size_t t_bytes) -> std::size_t {
+    std::size_t total = 0;
+    while (total < t_bytes) {
+      const auto n = ::read(m_fd, t_data + total, t_bytes - total);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::runtime_error("ad::FileSource: read failed");
+      }
+      if (n == 0) {
+        break;
+      }
+      total += static_cast<std::size_t>(n);
+    }
+    m_offset += total;
+    return total;
+  }
+
+  /**
+   * @brief Hints that the next `t_bytes` bytes will be read soon. The kernel
+   * reads them in the background, without a thread of our own.
+   */
+  auto prefetch(std::size_t t_bytes) const noexcept -> void {
+#if defined(POSIX_FADV_WILLNEED)
+    ::posix_fadvise(m_fd, static_cast<off_t>(m_offset),
+                    static_cast<off_t>(t_bytes), POSIX_FADV_WILLNEED);
+#else
+    static_cast<void>(t_bytes);
+#endif
+  }
+
+private:
+  int m_fd;
+  std::size_t m_offset{};
+};
+
+/**
+ * @brief Reads samples from a file of raw `T` values in host byte order,
+ * `t_columns` values per sample. A file ending in a partial sample is
+ * rejected when that sample is read.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class BinaryReader {
+public:
+  BinaryReader(const std::string &t_path, std::size_t t_columns)
+      : m_file(t_path), m_columns(t_columns) {
+    if (m_columns == 0) {
+      throw std::invalid_argument("ad::BinaryReader: no columns");
+    }
+  }
+
+  auto columns() const noexcept -> std::size_t { return m_columns; }
+
+  /**
+   * @brief Reads up to `t_count` samples into `t_rows`.
+   *
+   * @return the number of samples read, 0 at the end of the file.
+   */
+  auto read(std::vector<T> &t_rows, std::size_t t_count) -> std::size_t {
+    t_rows.resize(t_count * m_columns);
+    const std::size_t bytes = m_file.read(
+        reinterpret_cast<char *>(t_rows.data()), t_rows.size() * sizeof(T));
+    const std::size_t row_bytes = m_columns * sizeof(T);
+    if (bytes % row_bytes != 0) {
+      throw std::runtime_error("ad::BinaryReader: truncated sample");
+    }
+    const std::size_t rows = bytes / row_bytes;
+    t_rows.resize(rows * m_columns);
+    return rows;
+  }
+
+  /** @brief Starts reading the next `t_count` samples in the background */
+  auto prefetch(std::size_t t_count) const noexcept -> void {
+    m_file.prefetch(t_count * m_columns * sizeof(T));
+  }
+
+private:
+  FileSource m_file;
+  std::size_t m_columns;
+};
+
+/**
+ * @brief `std::from_chars`, except for subnormal values, which some runtimes
+ * report as out of range; those are parsed by `strtod` instead, which reads
+ * on from `t_first` until the number ends.
+ */
+template <typename T>
+auto parse_number(const char *t_first, const char *t_last, T &t_value)
+    -> std::from_chars_result {
+  auto result = std::from_chars(t_first, t_last, t_value);
+  if (result.ec == std::errc::result_out_of_range) {
+    char *end = nullptr;
+    T value{};
+    if constexpr (std::is_same_v<T, float>) {
+      value = std::strtof(t_first, &end);
+    } else if constexpr (std::is_same_v<T, double>) {
+      value = std::strtod(t_first, &end);
+    } else {
+      value = std::strtold(t_first, &end);
+    }
+    if (end == result.ptr && std::isfinite(value)) {
+      t_value = value;
+      result.ec = std::errc{};
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Reads samples from a comma separated file with `t_columns` numbers
+ * per line, skipping blank lines and, if `t_header` is set, the first line.
+ * Numbers are parsed independently of the locale; a line with fewer or more
+ * values is rejected.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class CsvReader {
+public:
+  CsvReader(const std::string &t_path, std::size_t t_columns,
+            bool t_header = false)
+      : m_file(t_path), m_columns(t_columns) {
+    if (t_header) {
+      next_line();
+    }
+  }
+
+  auto columns() const noexcept -> std::size_t { return m_columns; }
+
+  /** @copydoc BinaryReader::read */
+  auto read(std::vector<T> &t_rows, std::size_t t_count) -> std::size_t {
+    t_rows.clear();
+    std::size_t rows = 0;
+    while (rows < t_count) {
+      const auto [line, end] = next_line();
+      if (line == nullptr) {
+        break;
+      }
+      const char *cursor = skip_blanks(line, end);
+      if (cursor == end) {
+        continue;
+      }
+      const auto malformed = [line, end]() {
+        return std::runtime_error("ad::CsvReader: malformed line " +
+                                  std::string(line, end));
+      };
+      for (std::size_t c = 0; c < m_columns; ++c) {
+        if (c > 0) {
+          if (cursor == end || *cursor != ',') {
+            throw malformed();
+          }
+          cursor = skip_blanks(cursor + 1, end);
+        }
+        if (cursor != end && *cursor == '+') {
+          ++cursor;
+        }
+        T value{};
+        const auto [parsed, error] = parse_number(cursor, end, value);
+        if (error != std::errc{}) {
+          throw malformed();
+        }
+        t_rows.push_back(value);
+        cursor = skip_blanks(parsed, end);
+      }
+      if (cursor != end) {
+        throw malformed();
+      }
+      ++rows;
+    }
+    m_rows += rows;
+    return rows;
+  }
+
+  /** @copydoc BinaryReader::prefetch */
+  auto prefetch(std::size_t t_count) const noexcept -> void {
+    const std::size_t row_bytes = m_rows == 0 ? 64 : m_bytes / m_rows + 1;
+    m_file.prefetch(t_count * row_bytes);
+  }
+
+private:
+  static constexpr std::size_t block = std::size_t{1} << 16;
+
+  static auto skip_blanks(const char *t_first, const char *t_last) noexcept
+      -> const char * {
+    while (t_first != t_last &&
+           (*t_first == ' ' || *t_first == '\t' || *t_first == '\r')) {
+      ++t_first;
+    }
+    return t_first;
+  }
+
+  // the next line of the file without its terminator, as [begin, end), which
+  // stays valid until the next call; {nullptr, nullptr} at the end
+  auto next_line() -> std::pair<const char *, const char *> {
+    std::size_t newline = m_buffer.find('\n', m_position);
+    while (newline == std::string::npos) {
+      m_buffer.erase(0, m_position);
+      m_position = 0;
+      const std::size_t size = m_buffer.size();
+      m_buffer.resize(size + block);
+      const std::size_t read = m_file.read(m_buffer.data() + size, block);
+      m_buffer.resize(size + read);
+      if (read == 0) {
+        if (m_buffer.empty()) {
+          return {nullptr, nullptr};
+        }
+        m_buffer.push_back('\n');
+      }
+      newline = m_buffer.find('\n', size);
+    }
+    const char *line = m_buffer.data() + m_position;
+    m_bytes += newline + 1 - m_position;
+    m_position = newline + 1;
+    return {line, m_buffer.data() + newline};
+  }
+
+  FileSource m_file;
+  std::size_t m_columns;
+  std::string m_buffer{};
+  std::size_t m_position{};
+  std::size_t m_rows{};
+  std::size_t m_bytes{};
+};
+
+/**
+ * @brief Loss and gradient accumulated by `stream_gradient`.
+ */
+template <typename T,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+struct StreamGradient {
+  T value{};
+  std::vector<T> gradient{};
+  std::size_t samples{};
+  std::size_t chunks{};
+};
+
+/**
+ * @brief Accumulates the value and dense gradient of a loss summed over every
+ * sample of `t_reader`, reading `t_chunk` samples at a time. For each chunk
+ * `t_loss(w, chunk)` builds the reverse graph of the chunk's loss from fresh
+ * leaves `w` holding `t_weights`; the graph is released before the next
+ * chunk is read, so memory stays bounded by one graph and one buffer of
+ * `t_chunk` samples.
+ *
+ * The next chunk is prefetched by the kernel while the current one is
+ * differentiated. A reader thread would overlap as well, but once a process
+ * has started a thread every `shared_ptr` reference count of the graph
+ * becomes atomic, which costs more than the I/O it hides.
+ *
+ * @tparam Reader e.g. `BinaryReader` or `CsvReader`
+ * @tparam Loss callable as `RSym<T>(const std::vector<RSym<T>> &, const
+ * SampleChunk<T> &)`
+ */
+template <typename T, typename Reader, typename Loss,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+auto stream_gradient(Reader &t_reader, const std::vector<T> &t_weights,
+                     std::size_t t_chunk, Loss &&t_loss) -> StreamGradient<T> {
+  StreamGradient<T> result{};
+  result.gradient.assign(t_weights.size(), T{});
+
+  std::vector<T> samples{};
+  std::size_t rows = t_reader.read(samples, t_chunk);
+  while (rows > 0) {
+    t_reader.prefetch(t_chunk);
+    {
+      const std::vector<RSym<T>> w(t_weights.begin(), t_weights.end());
+      const RSym<T> y =
+          t_loss(w, SampleChunk<T>{samples.data(), rows, t_reader.columns()});
+      const auto df = gradient(y, w);
+
+      result.value += y.value();
+      for (std::size_t i = 0; i < df.size(); ++i) {
+        result.gradient[i] += df[i];
+      }
+    }
+    result.samples += rows;
+    ++result.chunks;
+    rows = t_reader.read(samples, t_chunk);
+  }
+  return result;
+}
+
+} // namespace ad
+
+#endif // __STREAM_H__
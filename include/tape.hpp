@@ -0,0 +1,660 @@
+#ifndef __TAPE_H__
+#define __TAPE_H__
+
+#include "../include/ops.hpp"
+#include "../include/reverseops.hpp"
+#include "../include/rsymbol.hpp"
+#include "../include/trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/**
+ * @brief Node counts reported by `Tape::optimize`.
+ */
+struct TapeOptimization {
+  std::size_t nodes_before{};
+  std::size_t nodes_after{};
+  std::size_t edges_before{};
+  std::size_t edges_after{};
+  std::size_t folded{};
+  std::size_t simplified{};
+  std::size_t fused{};
+  std::size_t eliminated{};
+};
+
+/**
+ * @brief Read-only view of the instruction arrays of a tape, either owned by a
+ * `Tape` or mapped from a file by `MappedTape`. Instruction `i` reads the
+ * operands `operands[offsets[i]] .. operands[offsets[i + 1]]`; an `Op::Chain`
+ * applies the steps `chain_offsets[i] .. chain_offsets[i + 1]`.
+ */
+template <typename S, typename I> struct TapeView {
+  const Op *ops{};
+  const S *constants{};
+  const I *offsets{};
+  const I *operands{};
+  const I *chain_offsets{};
+  const Op *chain_ops{};
+  const S *chain_constants{};
+  std::size_t size{};
+  std::size_t output{};
+};
+
+/**
+ * @brief Evaluates instruction `i` of `t_tape` from the values of its
+ * operands, storing its value and its local partials.
+ */
+template <typename S, typename I>
+inline auto forward_instruction(const TapeView<S, I> &t_tape, std::size_t i,
+                                S *t_values, S *t_partials) -> void {
+  const std::size_t offset = t_tape.offsets[i];
+  const std::size_t arity = t_tape.offsets[i + 1] - offset;
+  const I *args = t_tape.operands + offset;
+  S *partials = t_partials + offset;
+
+  switch (t_tape.ops[i]) {
+  case Op::Variable:
+    break;
+  case Op::Constant:
+    t_values[i] = t_tape.constants[i];
+    break;
+  case Op::Add:
+    t_values[i] = t_values[args[0]] + t_values[args[1]];
+    partials[0] = S{1};
+    partials[1] = S{1};
+    break;
+  case Op::Sub:
+    t_values[i] = t_values[args[0]] - t_values[args[1]];
+    partials[0] = S{1};
+    partials[1] = S{-1};
+    break;
+  case Op::Mul:
+    t_values[i] = t_values[args[0]] * t_values[args[1]];
+    partials[0] = t_values[args[1]];
+    partials[1] = t_values[args[0]];
+    break;
+  case Op::Pow: {
+    const S x = t_values[args[0]];
+    const S y = t_values[args[1]];
+    t_values[i] = std::pow(x, y);
+    std::tie(partials[0], partials[1]) = pow_partials(x, y, t_values[i]);
+    break;
+  }
+  case Op::Sum:
+  case Op::Mean: {
+    const S weight =
+        t_tape.ops[i] == Op::Sum ? S{1} : S{1} / static_cast<S>(arity);
+    S result{};
+    for (std::size_t k = 0; k < arity; ++k) {
+      result += t_values[args[k]];
+      partials[k] = weight;
+    }
+    t_values[i] = result * weight;
+    break;
+  }
+  case Op::Dot: {
+    S result{};
+    for (std::size_t k = 0; k < arity; k += 2) {
+      result += t_values[args[k]] * t_values[args[k + 1]];
+      partials[k] = t_values[args[k + 1]];
+      partials[k + 1] = t_values[args[k]];
+    }
+    t_values[i] = result;
+    break;
+  }
+  case Op::Norm2: {
+    S squares{};
+    for (std::size_t k = 0; k < arity; ++k) {
+      squares += t_values[args[k]] * t_values[args[k]];
+    }
+    t_values[i] = std::sqrt(squares);
+    const S scale = t_values[i] == S{} ? S{} : S{1} / t_values[i];
+    for (std::size_t k = 0; k < arity; ++k) {
+      partials[k] = t_values[args[k]] * scale;
+    }
+    break;
+  }
+  case Op::Chain: {
+    S x = t_values[args[0]];
+    S df = S{1};
+    for (std::size_t s = t_tape.chain_offsets[i];
+         s < t_tape.chain_offsets[i + 1]; ++s) {
+      const auto [value, partial] =
+          local(t_tape.chain_ops[s], x, t_tape.chain_constants[s]);
+      x = value;
+      df *= partial;
+    }
+    t_values[i] = x;
+    partials[0] = df;
+    break;
+  }
+  default: {
+    const auto [value, partial] =
+        local(t_tape.ops[i], t_values[args[0]], t_tape.constants[i]);
+    t_values[i] = value;
+    partials[0] = partial;
+    break;
+  }
+  }
+}
+
+/**
+ * @brief Replays the instructions of `t_tape` in order, storing the value and
+ * the local partials of every instruction. The values of the inputs must be
+ * set beforehand.
+ */
+template <typename S, typename I>
+auto forward_sweep(const TapeView<S, I> &t_tape, S *t_values, S *t_partials)
+    -> void {
+  AD_TRACE_SCOPE("ad::forward_sweep");
+  for (std::size_t i = 0; i < t_tape.size; ++i) {
+    forward_instruction(t_tape, i, t_values, t_partials);
+  }
+}
+
+/**
+ * @brief Sweeps the adjoints back from the output of `t_tape`, given the
+ * partials of the last forward sweep. `t_adjoints` must be zeroed.
+ */
+template <typename A, typename S, typename I>
+auto backward_sweep(const TapeView<S, I> &t_tape, const S *t_partials,
+                    A *t_adjoints) -> void {
+  AD_TRACE_SCOPE("ad::backward_sweep");
+  t_adjoints[t_tape.output] = A{1};
+  for (std::size_t i = t_tape.output + 1; i-- > 0;) {
+    const A adjoint = t_adjoints[i];
+    for (std::size_t k = t_tape.offsets[i]; k < t_tape.offsets[i + 1]; ++k) {
+      t_adjoints[t_tape.operands[k]] +=
+          adjoint * static_cast<A>(t_partials[k]);
+    }
+  }
+}
+
+/**
+ * @brief Storage policy of a `Tape`: values, partials and constants are held
+ * as `Storage`, adjoints are accumulated as `Adjoint`, and operands are
+ * addressed with `Index`.
+ */
+template <typename Storage, typename Adjoint = Storage,
+          typename Index = std::size_t>
+struct Precision {
+  static_assert(std::is_floating_point_v<Storage> &&
+                std::is_floating_point_v<Adjoint> &&
+                std::is_unsigned_v<Index>);
+
+  using storage_type = Storage;
+  using adjoint_type = Adjoint;
+  using index_type = Index;
+};
+
+/**
+ * @brief Half the footprint of a double tape: float values and partials with
+ * 32-bit operand indices, while adjoints still accumulate in double.
+ */
+using MixedPrecision = Precision<float, double, std::uint32_t>;
+
+/**
+ * @brief A reverse mode graph frozen into a linear list of instructions
+ * (a Wengert list) that can be replayed for new input values without
+ * rebuilding `RSym` nodes. Instructions are stored in evaluation order as
+ * flat arrays of op codes, operand indices and constant arguments.
+ *
+ * @tparam T the scalar of the recorded graph and of the public interface
+ * @tparam P the `Precision` the tape is stored and swept with
+ * @tparam std::enable_if_t<std::is_floating_point_v<T>>
+ */
+template <typename T, typename P = Precision<T>,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+class Tape {
+  using S = typename P::storage_type;
+  using A = typename P::adjoint_type;
+  using I = typename P::index_type;
+
+public:
+  /**
+   * @brief Records the graph of `output`. The nodes of `inputs` become the
+   * replayable inputs of the tape; every other leaf is frozen as a constant.
+   * Nodes built from raw edge lists (`Op::Custom`) cannot be replayed and are
+   * rejected, as are graphs with more edges than `P::index_type` addresses.
+   */
+  static auto record(const RSym<T> &output, const std::vector<RSym<T>> &inputs)
+      -> Tape {
+    NodeIndex input_index{};
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+      input_index.emplace(inputs[i].id(), i);
+    }
+
+    const auto order = topological_order(output);
+    const std::size_t n = order.nodes.size();
+
+    Tape tape{};
+    tape.m_inputs.assign(inputs.size(), n);
+
+    // evaluation order is the reverse of the topological order
+    for (std::size_t r = n; r-- > 0;) {
+      const RSym<T> &node = *order.nodes[r];
+      const std::size_t index = tape.m_ops.size();
+
+      if (const auto *input = input_index.find(node.id())) {
+        tape.m_inputs[*input] = index;
+        tape.push(Op::Variable, static_cast<S>(node.value()), S{}, {});
+        continue;
+      }
+      if (node.op() == Op::Custom) {
+        throw std::invalid_argument(
+            "ad::Tape::record: custom nodes cannot be replayed");
+      }
+      if (node.op() == Op::Variable) {
+        const auto value = static_cast<S>(node.value());
+        tape.push(Op::Constant, value, value, {});
+        continue;
+      }
+
+      std::vector<std::size_t> operands{};
+      for (std::size_t k = order.offsets[r]; k < order.offsets[r + 1]; ++k) {
+        operands.push_back(n - 1 - order.operands[k]);
+      }
+      tape.push(node.op(), static_cast<S>(node.value()),
+                static_cast<S>(node.constant()), operands);
+    }
+
+    // duplicated or unreachable inputs still get a (dead) slot of their own
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+      if (tape.m_inputs[i] != n) {
+        continue;
+      }
+      if (const auto *first = input_index.find(inputs[i].id());
+          tape.m_inputs[*first] != n) {
+        tape.m_inputs[i] = tape.m_inputs[*first];
+      } else {
+        tape.m_inputs[i] = tape.m_ops.size();
+        tape.push(Op::Variable, static_cast<S>(inputs[i].value()), S{}, {});
+      }
+    }
+
+    tape.m_output = n - 1;
+    tape.m_partials.resize(tape.m_operands.size());
+    tape.forward_values();
+    return tape;
+  }
+
+  /**
+   * @brief Replays the forward pass for new input values, storing the value
+   * and the local partials of every instruction.
+   *
+   * @return the value of the output.
+   */
+  auto forward(const std::vector<T> &t_inputs) -> T {
+    assert(t_inputs.size() == m_inputs.size());
+    for (std::size_t i = 0; i < m_inputs.size(); ++i) {
+      m_values[m_inputs[i]] = static_cast<S>(t_inputs[i]);
+    }
+    forward_values();
+    return value();
+  }
+
+  /**
+   * @brief Sweeps the adjoints of the last forward pass back to the inputs,
+   * accumulating them as `P::adjoint_type`.
+   *
+   * @return the partial derivatives of the output with respect to each input.
+   */
+  auto backward() const -> std::vector<T> {
+    std::vector<A> adjoints(m_ops.size(), A{});
+    backward_sweep(view(), m_partials.data(), adjoints.data());
+
+    std::vector<T> result{};
+    result.reserve(m_inputs.size());
+    for (const auto index : m_inputs) {
+      result.push_back(static_cast<T>(adjoints[index]));
+    }
+    return result;
+  }
+
+  auto gradient(const std::vector<T> &t_inputs) -> std::vector<T> {
+    forward(t_inputs);
+    return backward();
+  }
+
+  auto value() const noexcept -> T {
+    return static_cast<T>(m_values[m_output]);
+  }
+
+  /** @brief The value of instruction `t_index` in the last forward pass */
+  auto value(std::size_t t_index) const noexcept -> T {
+    return static_cast<T>(m_values[t_index]);
+  }
+
+  auto size() const noexcept -> std::size_t { return m_ops.size(); }
+  auto edge_count() const noexcept -> std::size_t { return m_operands.size(); }
+  auto input_count() const noexcept -> std::size_t { return m_inputs.size(); }
+
+  /**
+   * @brief Bytes held by the instruction arrays, values and partials of the
+   * tape, i.e. what a replay streams through.
+   */
+  auto bytes() const noexcept -> std::size_t {
+    return m_ops.size() * sizeof(Op) + m_constants.size() * sizeof(S) +
+           m_offsets.size() * sizeof(I) + m_operands.size() * sizeof(I) +
+           m_chain_offsets.size() * sizeof(I) +
+           m_chain_ops.size() * sizeof(Op) +
+           m_chain_constants.size() * sizeof(S) +
+           m_inputs.size() * sizeof(std::size_t) +
+           m_values.size() * sizeof(S) + m_partials.size() * sizeof(S);
+  }
+
+  auto op(std::size_t t_index) const noexcept -> Op { return m_ops[t_index]; }
+  auto constant(std::size_t t_index) const noexcept -> T {
+    return static_cast<T>(m_constants[t_index]);
+  }
+  auto operands(std::size_t t_index) const noexcept
+      -> std::pair<const I *, const I *> {
+    return {m_operands.data() + m_offsets[t_index],
+            m_operands.data() + m_offsets[t_index + 1]};
+  }
+  auto inputs() const noexcept -> const std::vector<std::size_t> & {
+    return m_inputs;
+  }
+  auto output() const noexcept -> std::size_t { return m_output; }
+
+  /**
+   * @brief Read-only view of the instruction arrays, valid until the tape is
+   * modified.
+   */
+  auto view() const noexcept -> TapeView<S, I> {
+    return {m_ops.data(),
+            m_constants.data(),
+            m_offsets.data(),
+            m_operands.data(),
+            m_chain_offsets.data(),
+            m_chain_ops.data(),
+            m_chain_constants.data(),
+            size(),
+            m_output};
+  }
+
+  /**
+   * @brief Unary primitives fused into the `Op::Chain` instruction at
+   * `t_index`, applied in order to its operand.
+   */
+  auto chain(std::size_t t_index) const -> std::vector<std::pair<Op, T>> {
+    std::vector<std::pair<Op, T>> steps{};
+    for (std::size_t s = m_chain_offsets[t_index];
+         s < m_chain_offsets[t_index + 1]; ++s) {
+      steps.emplace_back(m_chain_ops[s],
+                         static_cast<T>(m_chain_constants[s]));
+    }
+    return steps;
+  }
+
+  /**
+   * @brief Rewrites the tape in place before replay:
+   *  - folds instructions whose operands are all constants,
+   *  - simplifies identities (x * 1, x + 0, pow(x, 1), single-operand
+   *    reductions) and strength-reduces pow(x, 2) and x * x to `Op::Square`,
+   *  - fuses chains of unary primitives into a single `Op::Chain`,
+   *  - drops instructions that do not reach the output.
+   * Input slots are always kept so that the gradient keeps its shape.
+   */
+  auto optimize() -> TapeOptimization {
+    TapeOptimization stats{};
+    stats.nodes_before = size();
+    stats.edges_before = edge_count();
+
+    const std::size_t n = size();
+    std::vector<std::size_t> alias(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      alias[i] = i;
+    }
+
+    const auto is_constant = [this](std::size_t i, S c) {
+      return m_ops[i] == Op::Constant && m_constants[i] == c;
+    };
+
+    for (std::size_t i = 0; i < n; ++i) {
+      auto &op = m_ops[i];
+      if (op == Op::Variable || op == Op::Constant) {
+        continue;
+      }
+      for (std::size_t k = m_offsets[i]; k < m_offsets[i + 1]; ++k) {
+        m_operands[k] = static_cast<I>(alias[m_operands[k]]);
+      }
+      const I *first = m_operands.data() + m_offsets[i];
+      const std::size_t arity = m_offsets[i + 1] - m_offsets[i];
+
+      if (std::all_of(first, first + arity, [this](std::size_t k) {
+            return m_ops[k] == Op::Constant;
+          })) {
+        op = Op::Constant;
+        m_constants[i] = m_values[i];
+        ++stats.folded;
+        continue;
+      }
+
+      if (op == Op::PowConst && m_constants[i] == S{2}) {
+        op = Op::Square;
+        ++stats.simplified;
+      } else if (op == Op::Mul && first[0] == first[1]) {
+        op = Op::Square;
+        ++stats.simplified;
+      } else if ((op == Op::PowConst && m_constants[i] == S{1}) ||
+                 ((op == Op::Sum || op == Op::Mean) && arity == 1)) {
+        alias[i] = first[0];
+        ++stats.simplified;
+      } else if (op == Op::Mul && is_constant(first[1], S{1})) {
+        alias[i] = first[0];
+        ++stats.simplified;
+      } else if (op == Op::Mul && is_constant(first[0], S{1})) {
+        alias[i] = first[1];
+        ++stats.simplified;
+      } else if ((op == Op::Add || op == Op::Sub) &&
+                 is_constant(first[1], S{})) {
+        alias[i] = first[0];
+        ++stats.simplified;
+      } else if (op == Op::Add && is_constant(first[0], S{})) {
+        alias[i] = first[1];
+        ++stats.simplified;
+      }
+    }
+    m_output = alias[m_output];
+
+    compact(alias, stats);
+
+    stats.nodes_after = size();
+    stats.edges_after = edge_count();
+    forward_values();
+    return stats;
+  }
+
+  /**
+   * @brief Renumbers the instructions in the order `t_order`, which must list
+   * each of them once and after its operands, e.g. to lay out the levels of a
+   * `LevelSchedule` contiguously. Inputs and the output follow their
+   * instructions.
+   */
+  auto reorder(const std::vector<std::size_t> &t_order) -> void {
+    const std::size_t n = size();
+    if (t_order.size() != n) {
+      throw std::invalid_argument("ad::Tape::reorder: not an evaluation order");
+    }
+    Tape result{};
+    std::vector<std::size_t> renumber(n, n);
+    for (const auto i : t_order) {
+      if (i >= n || renumber[i] != n) {
+        throw std::invalid_argument(
+            "ad::Tape::reorder: not an evaluation order");
+      }
+      std::vector<std::size_t> operands{};
+      for (std::size_t k = m_offsets[i]; k < m_offsets[i + 1]; ++k) {
+        if (renumber[m_operands[k]] == n) {
+          throw std::invalid_argument(
+              "ad::Tape::reorder: not an evaluation order");
+        }
+        operands.push_back(renumber[m_operands[k]]);
+      }
+      for (std::size_t s = m_chain_offsets[i]; s < m_chain_offsets[i + 1];
+           ++s) {
+        result.m_chain_ops.push_back(m_chain_ops[s]);
+        result.m_chain_constants.push_back(m_chain_constants[s]);
+      }
+      renumber[i] = result.size();
+      result.push(m_ops[i], m_values[i], m_constants[i], operands);
+    }
+
+    for (auto &index : m_inputs) {
+      index = renumber[index];
+    }
+    result.m_inputs = std::move(m_inputs);
+    result.m_output = renumber[m_output];
+    result.m_partials.resize(result.m_operands.size());
+    *this = std::move(result);
+    forward_values();
+  }
+
+private:
+  Tape() = default;
+
+  auto push(Op t_op, S t_value, S t_constant,
+            const std::vector<std::size_t> &t_operands) -> void {
+    if (m_operands.size() + t_operands.size() >
+        std::numeric_limits<I>::max()) {
+      throw std::length_error(
+          "ad::Tape: too many edges for the index type of the precision");
+    }
+    m_ops.push_back(t_op);
+    m_values.push_back(t_value);
+    m_constants.push_back(t_constant);
+    for (const auto operand : t_operands) {
+      m_operands.push_back(static_cast<I>(operand));
+    }
+    m_offsets.push_back(static_cast<I>(m_operands.size()));
+    m_chain_offsets.push_back(static_cast<I>(m_chain_ops.size()));
+  }
+
+  auto forward_values() -> void {
+    forward_sweep(view(), m_values.data(), m_partials.data());
+  }
+
+  // Fuses unary chains and removes the instructions that are aliased away or
+  // do not reach the output, renumbering the remaining ones.
+  auto compact(const std::vector<std::size_t> &t_alias, TapeOptimization &stats)
+      -> void {
+    const std::size_t n = size();
+
+    std::vector<std::size_t> uses(n, 0);
+    std::vector<bool> live(n, false);
+    live[m_output] = true;
+    // folded constants no longer read their operands
+    for (std::size_t i = n; i-- > 0;) {
+      if (!live[i] || m_ops[i] == Op::Constant) {
+        continue;
+      }
+      for (std::size_t k = m_offsets[i]; k < m_offsets[i + 1]; ++k) {
+        live[m_operands[k]] = true;
+        ++uses[m_operands[k]];
+      }
+    }
+    for (const auto index : m_inputs) {
+      live[index] = true;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      stats.eliminated += !live[i] && t_alias[i] == i;
+    }
+
+    // a unary instruction absorbs its operand when it is the only user of an
+    // intermediate unary instruction
+    std::vector<std::vector<std::pair<Op, S>>> chains(n);
+    std::vector<std::size_t> source(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      source[i] = i;
+      if (!live[i] || !(is_unary(m_ops[i]) || m_ops[i] == Op::Chain)) {
+        continue;
+      }
+      if (m_ops[i] == Op::Chain) {
+        for (std::size_t s = m_chain_offsets[i]; s < m_chain_offsets[i + 1];
+             ++s) {
+          chains[i].emplace_back(m_chain_ops[s], m_chain_constants[s]);
+        }
+      } else {
+        chains[i] = {{m_ops[i], m_constants[i]}};
+      }
+
+      const std::size_t operand = m_operands[m_offsets[i]];
+      if (uses[operand] == 1 && !chains[operand].empty()) {
+        chains[operand].insert(chains[operand].end(), chains[i].begin(),
+                               chains[i].end());
+        chains[i] = std::move(chains[operand]);
+        chains[operand].clear();
+        source[i] = source[operand];
+        live[operand] = false;
+        ++stats.fused;
+      }
+    }
+
+    Tape result{};
+    std::vector<std::size_t> renumber(n, n);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (!live[i]) {
+        continue;
+      }
+      renumber[i] = result.size();
+
+      std::vector<std::size_t> operands{};
+      if (chains[i].size() > 1 || m_ops[i] == Op::Chain) {
+        operands.push_back(renumber[m_operands[m_offsets[source[i]]]]);
+        for (const auto &[step, constant] : chains[i]) {
+          result.m_chain_ops.push_back(step);
+          result.m_chain_constants.push_back(constant);
+        }
+        result.push(Op::Chain, m_values[i], S{}, operands);
+        continue;
+      }
+      // unary instructions rewritten from binary ones keep a single operand
+      const std::size_t arity =
+          m_ops[i] == Op::Constant ? 0
+          : is_unary(m_ops[i])     ? 1
+                                   : m_offsets[i + 1] - m_offsets[i];
+      for (std::size_t k = m_offsets[i]; k < m_offsets[i] + arity; ++k) {
+        operands.push_back(renumber[m_operands[k]]);
+      }
+      result.push(m_ops[i], m_values[i], m_constants[i], operands);
+    }
+
+    for (auto &index : m_inputs) {
+      index = renumber[index];
+    }
+    result.m_inputs = std::move(m_inputs);
+    result.m_output = renumber[m_output];
+    result.m_partials.resize(result.m_operands.size());
+    *this = std::move(result);
+  }
+
+  std::vector<Op> m_ops{};
+  std::vector<S> m_constants{};
+  std::vector<I> m_offsets{0};
+  std::vector<I> m_operands{};
+  std::vector<I> m_chain_offsets{0};
+  std::vector<Op> m_chain_ops{};
+  std::vector<S> m_chain_constants{};
+  std::vector<std::size_t> m_inputs{};
+  std::size_t m_output{};
+
+  std::vector<S> m_values{};
+  std::vector<S> m_partials{};
+};
+
+} // namespace ad
+
+#endif // __TAPE_H__
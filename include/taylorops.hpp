@@ -0,0 +1,243 @@
+#ifndef __TAYLOROPS_H__
+#define __TAYLOROPS_H__
+
+#include "../include/ops.hpp"
+#include "../include/tsymbol.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+using ad::TSym;
+
+namespace ad {
+
+/**
+ * @brief The series of f(a) from f(a0) = `t_value` and the series `t_slope`
+ * of f'(a), by integrating f' = f'(a) a' term by term:
+ * f_k = 1/k sum_{j=1..k} j a_j h_{k-j}. Only the first K coefficients of
+ * `t_slope` are read.
+ */
+template <typename T, std::size_t K>
+auto taylor_integrate(T t_value, const TSym<T, K> &a,
+                      const TSym<T, K> &t_slope) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type c{};
+  c[0] = t_value;
+  for (std::size_t k = 1; k <= K; ++k) {
+    T sum{};
+    for (std::size_t j = 1; j <= k; ++j) {
+      sum += static_cast<T>(j) * a.coefficient(j) * t_slope.coefficient(k - j);
+    }
+    c[k] = sum / static_cast<T>(k);
+  }
+  return TSym<T, K>{c};
+}
+
+/** @brief The series of sqrt(a), for a0 > 0 */
+template <typename T, std::size_t K>
+auto taylor_sqrt(const TSym<T, K> &a) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type c{};
+  c[0] = std::sqrt(a.value());
+  for (std::size_t k = 1; k <= K; ++k) {
+    T sum = a.coefficient(k);
+    for (std::size_t j = 1; j < k; ++j) {
+      sum -= c[j] * c[k - j];
+    }
+    c[k] = sum / (T{2} * c[0]);
+  }
+  return TSym<T, K>{c};
+}
+
+/** @brief The series of |a|, for a0 != 0 */
+template <typename T, std::size_t K>
+auto taylor_abs(const TSym<T, K> &a) -> TSym<T, K> {
+  return a.value() < T{} ? TSym<T, K>{T{}} - a : a;
+}
+
+/**
+ * @brief The series of (sin(a), cos(a)) or, with `t_hyperbolic`,
+ * (sinh(a), cosh(a)), computed together as each is the other's derivative.
+ */
+template <typename T, std::size_t K>
+auto taylor_sin_cos(const TSym<T, K> &a, bool t_hyperbolic)
+    -> std::pair<TSym<T, K>, TSym<T, K>> {
+  typename TSym<T, K>::coefficients_type s{};
+  typename TSym<T, K>::coefficients_type c{};
+  s[0] = t_hyperbolic ? std::sinh(a.value()) : std::sin(a.value());
+  c[0] = t_hyperbolic ? std::cosh(a.value()) : std::cos(a.value());
+  const T sign = t_hyperbolic ? T{1} : T{-1};
+  for (std::size_t k = 1; k <= K; ++k) {
+    T ds{};
+    T dc{};
+    for (std::size_t j = 1; j <= k; ++j) {
+      const T ja = static_cast<T>(j) * a.coefficient(j);
+      ds += ja * c[k - j];
+      dc += ja * s[k - j];
+    }
+    s[k] = ds / static_cast<T>(k);
+    c[k] = sign * dc / static_cast<T>(k);
+  }
+  return {TSym<T, K>{s}, TSym<T, K>{c}};
+}
+
+/**
+ * @brief The series of tan(a) or, with `t_hyperbolic`, tanh(a), from
+ * t' = (1 +- t^2) a' with the square accumulated alongside.
+ */
+template <typename T, std::size_t K>
+auto taylor_tan(const TSym<T, K> &a, bool t_hyperbolic) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type t{};
+  typename TSym<T, K>::coefficients_type slope{};
+  const T sign = t_hyperbolic ? T{-1} : T{1};
+  t[0] = t_hyperbolic ? std::tanh(a.value()) : std::tan(a.value());
+  slope[0] = T{1} + sign * t[0] * t[0];
+  for (std::size_t k = 1; k <= K; ++k) {
+    T sum{};
+    for (std::size_t j = 1; j <= k; ++j) {
+      sum += static_cast<T>(j) * a.coefficient(j) * slope[k - j];
+    }
+    t[k] = sum / static_cast<T>(k);
+
+    T square{};
+    for (std::size_t j = 0; j <= k; ++j) {
+      square += t[j] * t[k - j];
+    }
+    slope[k] = sign * square;
+  }
+  return TSym<T, K>{t};
+}
+
+} // namespace ad
+
+template <typename T, std::size_t K>
+auto exp(const TSym<T, K> &rhs) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type c{};
+  c[0] = std::exp(rhs.value());
+  for (std::size_t k = 1; k <= K; ++k) {
+    T sum{};
+    for (std::size_t j = 1; j <= k; ++j) {
+      sum += static_cast<T>(j) * rhs.coefficient(j) * c[k - j];
+    }
+    c[k] = sum / static_cast<T>(k);
+  }
+  return TSym<T, K>{c};
+}
+
+template <typename T, std::size_t K>
+auto ln(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return ad::taylor_integrate(std::log(rhs.value()), rhs,
+                              TSym<T, K>{T{1}} / rhs);
+}
+
+template <typename T, std::size_t K>
+auto pow(const TSym<T, K> &base, T exponent) -> TSym<T, K> {
+  // p a' = c a p', for a0 != 0
+  typename TSym<T, K>::coefficients_type c{};
+  c[0] = std::pow(base.value(), exponent);
+  for (std::size_t k = 1; k <= K; ++k) {
+    T sum{};
+    for (std::size_t j = 1; j <= k; ++j) {
+      sum += (exponent * static_cast<T>(j) - static_cast<T>(k - j)) *
+             base.coefficient(j) * c[k - j];
+    }
+    c[k] = sum / (static_cast<T>(k) * base.value());
+  }
+  return TSym<T, K>{c};
+}
+
+template <typename T, std::size_t K>
+auto pow(const TSym<T, K> &base, const TSym<T, K> &exponent)
+    -> TSym<T, K> {
+  return exp(exponent * ln(base));
+}
+
+template <typename T, std::size_t K>
+auto sin(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return ad::taylor_sin_cos(rhs, false).first;
+}
+
+template <typename T, std::size_t K>
+auto cos(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return ad::taylor_sin_cos(rhs, false).second;
+}
+
+template <typename T, std::size_t K>
+auto tan(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return ad::taylor_tan(rhs, false);
+}
+
+template <typename T, std::size_t K>
+auto cot(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return TSym<T, K>{T{1}} / ad::taylor_tan(rhs, false);
+}
+
+template <typename T, std::size_t K>
+auto sec(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return TSym<T, K>{T{1}} / ad::taylor_sin_cos(rhs, false).second;
+}
+
+template <typename T, std::size_t K>
+auto csc(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return TSym<T, K>{T{1}} / ad::taylor_sin_cos(rhs, false).first;
+}
+
+template <typename T, std::size_t K>
+auto sinh(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return ad::taylor_sin_cos(rhs, true).first;
+}
+
+template <typename T, std::size_t K>
+auto cosh(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return ad::taylor_sin_cos(rhs, true).second;
+}
+
+template <typename T, std::size_t K>
+auto tanh(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return ad::taylor_tan(rhs, true);
+}
+
+template <typename T, std::size_t K>
+auto coth(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return TSym<T, K>{T{1}} / ad::taylor_tan(rhs, true);
+}
+
+template <typename T, std::size_t K>
+auto sech(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return TSym<T, K>{T{1}} / ad::taylor_sin_cos(rhs, true).second;
+}
+
+template <typename T, std::size_t K>
+auto csch(const TSym<T, K> &rhs) -> TSym<T, K> {
+  return TSym<T, K>{T{1}} / ad::taylor_sin_cos(rhs, true).first;
+}
+
+// inverse functions: the value from the table in `ops.hpp`, the higher
+// coefficients by integrating the series of the derivative (the last argument)
+#define AD_TAYLOR_INVERSE(NAME, OP, ...)                                       \
+  template <typename T, std::size_t K>                                         \
+  auto NAME(const TSym<T, K> &x) -> TSym<T, K> {                               \
+    const TSym<T, K> one{T{1}};                                                \
+    return ad::taylor_integrate(ad::primal<ad::Op::OP>(x.value(), T{}), x,     \
+                                __VA_ARGS__);                                  \
+  }
+AD_TAYLOR_INVERSE(asin, Asin, one / ad::taylor_sqrt(one - x * x))
+AD_TAYLOR_INVERSE(acos, Acos, TSym<T, K>{T{-1}} / ad::taylor_sqrt(one - x * x))
+AD_TAYLOR_INVERSE(atan, Atan, one / (one + x * x))
+AD_TAYLOR_INVERSE(acot, Acot, TSym<T, K>{T{-1}} / (one + x * x))
+AD_TAYLOR_INVERSE(asec, Asec,
+                  one / (ad::taylor_abs(x) * ad::taylor_sqrt(x * x - one)))
+AD_TAYLOR_INVERSE(acsc, Acsc,
+                  TSym<T, K>{T{-1}} /
+                      (ad::taylor_abs(x) * ad::taylor_sqrt(x * x - one)))
+AD_TAYLOR_INVERSE(asinh, Asinh, one / ad::taylor_sqrt(x * x + one))
+AD_TAYLOR_INVERSE(acosh, Acosh, one / ad::taylor_sqrt(x * x - one))
+AD_TAYLOR_INVERSE(atanh, Atanh, one / (one - x * x))
+AD_TAYLOR_INVERSE(acoth, Acoth, one / (one - x * x))
+AD_TAYLOR_INVERSE(asech, Asech,
+                  TSym<T, K>{T{-1}} / (x * ad::taylor_sqrt(one - x * x)))
+AD_TAYLOR_INVERSE(acsch, Acsch,
+                  TSym<T, K>{T{-1}} /
+                      (ad::taylor_abs(x) * ad::taylor_sqrt(one + x * x)))
+#undef AD_TAYLOR_INVERSE
+
+#endif // __TAYLOROPS_H__
@@ -0,0 +1,234 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/**
+ * @brief Opens a trace scope named by the string literal `NAME` until the end
+ * of the enclosing block. Expands to nothing unless `AD_TRACE` is defined.
+ */
+#if defined(AD_TRACE)
+#define AD_TRACE_CONCAT_(A, B) A##B
+#define AD_TRACE_CONCAT(A, B) AD_TRACE_CONCAT_(A, B)
+#define AD_TRACE_SCOPE(NAME)                                                   \
+  const ::ad::TraceScope AD_TRACE_CONCAT(ad_trace_scope_, __LINE__) { NAME }
+#else
+#define AD_TRACE_SCOPE(NAME) static_cast<void>(0)
+#endif
+
+namespace ad {
+
+/**
+ * @brief A completed scope, in nanoseconds since the start of the trace.
+ */
+struct TraceEvent {
+  const char *name;
+  std::int64_t begin;
+  std::int64_t duration;
+};
+
+/**
+ * @brief Events of one thread. Only the owning thread appends, into blocks
+ * that never move, and publishes each event by a release store of the size,
+ * so a writer may read the buffer concurrently without a lock. A block holds
+ * 4096 events in about 96 KB; the first is allocated with the buffer.
+ */
+class TraceBuffer {
+public:
+  explicit TraceBuffer(std::uint32_t t_thread)
+      : m_head(new Block{}), m_tail(m_head), m_thread(t_thread) {}
+  TraceBuffer(const TraceBuffer &) = delete;
+  auto operator=(const TraceBuffer &) -> TraceBuffer & = delete;
+  ~TraceBuffer() {
+    while (m_head != nullptr) {
+      delete std::exchange(m_head, m_head->next);
+    }
+  }
+
+  auto push(const TraceEvent &t_event) -> void {
+    const std::size_t size = m_size.load(std::memory_order_relaxed);
+    const std::size_t slot = size % block_size;
+    if (size != 0 && slot == 0) {
+      m_tail->next = new Block{};
+      m_tail = m_tail->next;
+    }
+    m_tail->events[slot] = t_event;
+    m_size.store(size + 1, std::memory_order_release);
+  }
+
+  /** @brief Calls `f` with every event published so far */
+  template <typename Fn> auto for_each(Fn &&f) const -> void {
+    std::size_t size = m_size.load(std::memory_order_acquire);
+    for (const Block *block = m_head; size > 0; block = block->next) {
+      const std::size_t count = size < block_size ? size : block_size;
+      for (std::size_t i = 0; i < count; ++i) {
+        f(block->events[i]);
+      }
+      size -= count;
+    }
+  }
+
+  /** @brief Drops every event, keeping only the first block */
+  auto clear() noexcept -> void {
+    while (m_head->next != nullptr) {
+      delete std::exchange(m_head->next, m_head->next->next);
+    }
+    m_tail = m_head;
+    m_size.store(0, std::memory_order_release);
+  }
+
+  auto thread() const noexcept -> std::uint32_t { return m_thread; }
+
+  // next buffer of the registry of `Trace`
+  TraceBuffer *next{};
+
+private:
+  static constexpr std::size_t block_size = 4096;
+
+  struct Block {
+    std::array<TraceEvent, block_size> events;
+    Block *next{};
+  };
+
+  Block *m_head;
+  Block *m_tail;
+  std::atomic<std::size_t> m_size{};
+  std::uint32_t m_thread;
+};
+
+/**
+ * @brief Process-wide collector of trace events, written in the Chrome trace
+ * event format (`chrome://tracing`, Perfetto) with one lane per thread. Each
+ * thread records into its own `TraceBuffer`; the only shared write is the
+ * lock-free registration of a thread's buffer on its first event.
+ *
+ * Every thread that records an event costs a buffer of at least one 96 KB
+ * block, growing by one block per 4096 events. Buffers are kept after their
+ * thread exits, so that its events can still be written, and are released
+ * only by the operating system at exit; `reset` shrinks them back to one
+ * block.
+ */
+class Trace {
+public:
+  using clock = std::chrono::steady_clock;
+
+  static auto record(const char *t_name, clock::time_point t_begin,
+                     clock::time_point t_end) -> void {
+    thread_local TraceBuffer &buffer = attach();
+    buffer.push({t_name, since_start(t_begin), since_start(t_end) -
+                                                   since_start(t_begin)});
+  }
+
+  /**
+   * @brief Writes the events recorded so far as a JSON trace. Scopes still
+   * open are not included.
+   */
+  static auto write(std::ostream &os) -> std::ostream & {
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    const auto separator = [&]() -> std::ostream & {
+      os << (first ? "\n" : ",\n");
+      first = false;
+      return os;
+    };
+
+    for (const TraceBuffer *buffer = s_buffers.load(std::memory_order_acquire);
+         buffer != nullptr; buffer = buffer->next) {
+      const auto tid = buffer->thread();
+      separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                  << "\"tid\":" << tid << ",\"args\":{\"name\":\"thread "
+                  << tid << "\"}}";
+      buffer->for_each([&](const TraceEvent &event) {
+        separator() << "{\"name\":\"" << event.name
+                    << "\",\"cat\":\"ad\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << tid << ",\"ts\":" << microseconds(event.begin)
+                    << ",\"dur\":" << microseconds(event.duration) << "}";
+      });
+    }
+    return os << "\n]}\n";
+  }
+
+  /** @brief Writes the trace to the file `t_path` */
+  static auto write(const std::string &t_path) -> void {
+    std::ofstream os(t_path);
+    if (!os) {
+      throw std::runtime_error("ad::Trace: cannot open " + t_path);
+    }
+    write(os);
+  }
+
+  /**
+   * @brief Discards the events recorded so far, releasing all but the first
+   * block of every buffer, e.g. between the phases of a long run. No other
+   * thread may record or write the trace meanwhile.
+   */
+  static auto reset() noexcept -> void {
+    for (TraceBuffer *buffer = s_buffers.load(std::memory_order_acquire);
+         buffer != nullptr; buffer = buffer->next) {
+      buffer->clear();
+    }
+  }
+
+private:
+  // Buffers are never deleted: a scope closing during static destruction,
+  // e.g. in the destructor of another static, still records through the
+  // reference its thread holds. They stay reachable from `s_buffers`.
+  static auto attach() -> TraceBuffer & {
+    auto *buffer = new TraceBuffer(s_threads.fetch_add(1) + 1);
+    buffer->next = s_buffers.load(std::memory_order_relaxed);
+    while (!s_buffers.compare_exchange_weak(buffer->next, buffer,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+    }
+    return *buffer;
+  }
+
+  static auto since_start(clock::time_point t_time) noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t_time -
+                                                                s_start)
+        .count();
+  }
+
+  // fixed point microseconds, as expected by the format
+  static auto microseconds(std::int64_t t_nanoseconds) -> std::string {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%lld.%03lld",
+                  static_cast<long long>(t_nanoseconds / 1000),
+                  static_cast<long long>(t_nanoseconds % 1000));
+    return text;
+  }
+
+  inline static const clock::time_point s_start = clock::now();
+  inline static std::atomic<TraceBuffer *> s_buffers{};
+  inline static std::atomic<std::uint32_t> s_threads{};
+};
+
+/**
+ * @brief Records the lifetime of the scope as a trace event named `t_name`,
+ * which must outlive the trace (e.g. a string literal).
+ */
+class TraceScope {
+public:
+  explicit TraceScope(const char *t_name) noexcept
+      : m_name(t_name), m_begin(Trace::clock::now()) {}
+  TraceScope(const TraceScope &) = delete;
+  auto operator=(const TraceScope &) -> TraceScope & = delete;
+  ~TraceScope() { Trace::record(m_name, m_begin, Trace::clock::now()); }
+
+private:
+  const char *m_name;
+  Trace::clock::time_point m_begin;
+};
+
+} // namespace ad
+
+#endif // __TRACE_H__
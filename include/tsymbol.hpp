@@ -0,0 +1,122 @@
+#ifndef __TSYMBOL_H__
+#define __TSYMBOL_H__
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+namespace ad {
+
+/**
+ * @brief Represents a Taylor polynomial truncated after degree `K`, i.e. the
+ * coefficients f_k = f^(k)(x) / k! of a function along one direction. The
+ * arithmetic and the functions of `taylorops.hpp` propagate all coefficients
+ * with the usual O(K^2) recurrences, where nesting `K` levels of forward mode
+ * would cost O(2^K). To differentiate f at x, evaluate it at
+ * `TSym<T, K>(x, 1.0)`.
+ *
+ * @tparam T
+ * @tparam K the highest degree kept
+ */
+template <typename T, std::size_t K,
+          typename = typename std::enable_if_t<std::is_floating_point_v<T>>>
+struct TSym {
+public:
+  static_assert(K > 0, "a Taylor polynomial needs degree at least 1");
+  using coefficients_type = std::array<T, K + 1>;
+
+public:
+  TSym(T t_value, T t_dot) : m_coefficients{} {
+    m_coefficients[0] = t_value;
+    m_coefficients[1] = t_dot;
+  }
+  TSym(T t_value) : m_coefficients{} { m_coefficients[0] = t_value; }
+  explicit TSym(const coefficients_type &t_coefficients)
+      : m_coefficients(t_coefficients) {}
+
+  auto value() const noexcept -> T { return m_coefficients[0]; }
+
+  /** @brief The `t_order`th Taylor coefficient f^(k)(x) / k! */
+  auto coefficient(std::size_t t_order) const noexcept -> T {
+    return m_coefficients[t_order];
+  }
+
+  /** @brief The `t_order`th derivative f^(k)(x) */
+  auto derivative(std::size_t t_order) const noexcept -> T {
+    T result = m_coefficients[t_order];
+    for (std::size_t k = 2; k <= t_order; ++k) {
+      result *= static_cast<T>(k);
+    }
+    return result;
+  }
+
+  auto coefficients() const noexcept -> const coefficients_type & {
+    return m_coefficients;
+  }
+
+  auto operator<(const TSym &other) const noexcept -> bool {
+    return value() < other.value();
+  }
+
+  auto operator>(const TSym &other) const noexcept -> bool {
+    return value() > other.value();
+  }
+  auto operator==(const TSym &other) const noexcept -> bool {
+    return value() == other.value();
+  }
+
+  auto operator!=(const TSym &other) const noexcept -> bool {
+    return value() != other.value();
+  }
+
+private:
+  coefficients_type m_coefficients;
+};
+
+template <typename T, std::size_t K>
+auto operator+(const TSym<T, K> &lhs, const TSym<T, K> &rhs) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type c{};
+  for (std::size_t k = 0; k <= K; ++k) {
+    c[k] = lhs.coefficient(k) + rhs.coefficient(k);
+  }
+  return TSym<T, K>{c};
+}
+
+template <typename T, std::size_t K>
+auto operator-(const TSym<T, K> &lhs, const TSym<T, K> &rhs) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type c{};
+  for (std::size_t k = 0; k <= K; ++k) {
+    c[k] = lhs.coefficient(k) - rhs.coefficient(k);
+  }
+  return TSym<T, K>{c};
+}
+
+template <typename T, std::size_t K>
+auto operator*(const TSym<T, K> &lhs, const TSym<T, K> &rhs) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type c{};
+  for (std::size_t k = 0; k <= K; ++k) {
+    for (std::size_t j = 0; j <= k; ++j) {
+      c[k] += lhs.coefficient(j) * rhs.coefficient(k - j);
+    }
+  }
+  return TSym<T, K>{c};
+}
+
+template <typename T, std::size_t K>
+auto operator/(const TSym<T, K> &lhs, const TSym<T, K> &rhs) -> TSym<T, K> {
+  typename TSym<T, K>::coefficients_type c{};
+  const T inverse = T{1} / rhs.value();
+  for (std::size_t k = 0; k <= K; ++k) {
+    T sum = lhs.coefficient(k);
+    for (std::size_t j = 0; j < k; ++j) {
+      sum -= c[j] * rhs.coefficient(k - j);
+    }
+    c[k] = sum * inverse;
+  }
+  return TSym<T, K>{c};
+}
+
+}; // namespace ad
+
+#endif // __TSYMBOL_H__
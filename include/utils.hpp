@@ -2,54 +2,67 @@
 #define __UTILS_H__
 
 #include "../include/matrix.hpp"
+#include "../include/trace.hpp"
 #include "../include/vector.hpp"
 
 #include <algorithm>
-#include <iomanip>
+#include <charconv>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <type_traits>
 #include <vector>
 
-template <typename T>
-auto operator<<(std::ostream &os, const ad::Matrix<T> &Matrix)
+/**
+ * @brief Prints `t_matrix` with its columns aligned. Every element is formatted
+ * once with `std::to_chars`; the strings are then padded to the widest.
+ */
+template <typename T, typename A>
+auto operator<<(std::ostream &os, const ad::Matrix<T, A> &t_matrix)
     -> std::ostream & {
   static_assert(std::is_arithmetic_v<T>,
                 "template parameter must be of type arithmetic");
 
-  if (Matrix.empty()) {
-    os << "[]" << std::endl;
-    return os;
-  }
-
+  std::string text{};
+  std::vector<std::size_t> ends{};
   std::size_t max_width = 0;
-  for (const auto &row : Matrix) {
-    for (const auto &element : row) {
-      std::size_t width = std::to_string(element).size();
-      if (width > max_width) {
-        max_width = width;
-      }
+  for (auto row = t_matrix.cbegin(); row != t_matrix.cend(); ++row) {
+    for (const auto &element : *row) {
+      char buffer[64];
+      const char *end = std::to_chars(buffer, buffer + 64, element).ptr;
+      const auto width = static_cast<std::size_t>(end - buffer);
+      text.append(buffer, width);
+      max_width = std::max(max_width, width);
+      ends.push_back(text.size());
     }
   }
 
-  os << "[";
-  for (std::size_t i = 0; i < Matrix.size(); ++i) {
-    if (i != 0) {
-      os << " ";
-    }
-    os << "[";
-    for (std::size_t j = 0; j < Matrix[i].size(); ++j) {
-      os << std::setw(max_width) << Matrix[i][j];
-      if (j != Matrix[i].size() - 1) {
-        os << ", ";
+  if (ends.empty()) {
+    os << "[]" << std::endl;
+    return os;
+  }
+
+  // laid out by the rows themselves rather than by `dims`
+  std::string out{};
+  out.reserve(ends.size() * (max_width + 2) + 4 * t_matrix.dims().first + 2);
+  out += '[';
+  std::size_t begin = 0;
+  std::size_t next = 0;
+  for (auto row = t_matrix.cbegin(); row != t_matrix.cend(); ++row) {
+    out += row == t_matrix.cbegin() ? "[" : " [";
+    for (std::size_t j = 0; j < row->size(); ++j) {
+      const std::size_t end = ends[next++];
+      out.append(max_width - (end - begin), ' ');
+      out.append(text, begin, end - begin);
+      begin = end;
+      if (j + 1 != row->size()) {
+        out += ", ";
       }
     }
-    os << "]";
-    if (i != Matrix.size() - 1) {
-      os << '\n';
-    }
+    out += std::next(row) == t_matrix.cend() ? "]" : "]\n";
   }
-  return os << "]\n";
+  out += "]\n";
+  return os.write(out.data(), static_cast<std::streamsize>(out.size()));
 }
 
 template <typename T>
@@ -64,6 +77,7 @@ auto operator<<(std::ostream &os, const std::vector<T> &v) -> std::ostream & {
 template <typename Fn, typename ArgType>
 constexpr auto apply_fn(Fn &&fn, const ad::vector<ArgType> &v)
     -> ad::vector<std::invoke_result_t<Fn &, const ArgType &>> {
+  AD_TRACE_SCOPE("ad::apply_fn");
 
   using ResultType = std::invoke_result_t<Fn &, const ArgType &>;
   ad::vector<ResultType> result;
@@ -77,6 +91,7 @@ constexpr auto apply_fn(Fn &&fn, const ad::vector<ArgType> &v)
 template <typename Fn, typename ArgType>
 constexpr auto apply_fn(Fn &&functor, const ad::Matrix<ArgType> &v)
     -> ad::Matrix<std::invoke_result_t<Fn &, const ArgType &>> {
+  AD_TRACE_SCOPE("ad::apply_fn");
 
   using ResultType = std::invoke_result_t<Fn &, const ArgType &>;
   ad::Matrix<ResultType> result{};
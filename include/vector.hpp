@@ -22,13 +22,14 @@ constexpr auto operator!=(const vector<T> &lhs, const vector<T> &rhs) -> bool {
   return !(lhs == rhs);
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator+(const vector<T> &lhs, const vector<T> &rhs)
-    -> vector<T> {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator+(const vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> {
 
   assert(lhs.size() == rhs.size());
 
-  vector<T> result;
+  vector<T, A> result(lhs.get_allocator());
   result.reserve(lhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -37,12 +38,13 @@ constexpr auto operator+(const vector<T> &lhs, const vector<T> &rhs)
   return result;
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator-(const vector<T> &lhs, const vector<T> &rhs)
-    -> vector<T> {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator-(const vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> {
   assert(lhs.size() == rhs.size());
 
-  vector<T> result;
+  vector<T, A> result(lhs.get_allocator());
   result.reserve(lhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -51,12 +53,13 @@ constexpr auto operator-(const vector<T> &lhs, const vector<T> &rhs)
   return result;
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator*(const vector<T> &lhs, const vector<T> &rhs)
-    -> vector<T> {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator*(const vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> {
   assert(lhs.size() == rhs.size());
 
-  vector<T> result;
+  vector<T, A> result(lhs.get_allocator());
   result.reserve(lhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -65,12 +68,13 @@ constexpr auto operator*(const vector<T> &lhs, const vector<T> &rhs)
   return result;
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator/(const vector<T> &lhs, const vector<T> &rhs)
-    -> vector<T> {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator/(const vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> {
   assert(lhs.size() == rhs.size());
 
-  vector<T> result;
+  vector<T, A> result(lhs.get_allocator());
   result.reserve(lhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -79,8 +83,10 @@ constexpr auto operator/(const vector<T> &lhs, const vector<T> &rhs)
   return result;
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator+=(vector<T> &lhs, const vector<T> &rhs) -> vector<T> & {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator+=(vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> & {
   assert(lhs.size() == rhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -88,8 +94,10 @@ constexpr auto operator+=(vector<T> &lhs, const vector<T> &rhs) -> vector<T> & {
   return lhs;
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator-=(vector<T> &lhs, const vector<T> &rhs) -> vector<T> & {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator-=(vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> & {
   assert(lhs.size() == rhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -97,8 +105,10 @@ constexpr auto operator-=(vector<T> &lhs, const vector<T> &rhs) -> vector<T> & {
   return lhs;
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator*=(vector<T> &lhs, const vector<T> &rhs) -> vector<T> & {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator*=(vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> & {
   assert(lhs.size() == rhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -106,8 +116,10 @@ constexpr auto operator*=(vector<T> &lhs, const vector<T> &rhs) -> vector<T> & {
   return lhs;
 }
 
-template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-constexpr auto operator/=(vector<T> &lhs, const vector<T> &rhs) -> vector<T> & {
+template <typename T, typename A,
+          typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+auto operator/=(vector<T, A> &lhs, const vector<T, A> &rhs)
+    -> vector<T, A> & {
   assert(lhs.size() == rhs.size());
 
   std::transform(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs),
@@ -0,0 +1,6 @@
+#include "../../include/autodiff.hpp"
+
+// The double instantiations declared extern by autodiff.hpp
+#define AD_EXTERN
+#define AD_SCALAR double
+#include "../../include/instantiate.hpp"
@@ -0,0 +1,6 @@
+#include "../../include/autodiff.hpp"
+
+// The float instantiations declared extern by autodiff.hpp
+#define AD_EXTERN
+#define AD_SCALAR float
+#include "../../include/instantiate.hpp"
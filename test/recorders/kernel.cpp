@@ -0,0 +1,19 @@
+#include "../../include/codegen.hpp"
+#include "kernel.hpp"
+
+#include <fstream>
+
+auto main(int argc, char **argv) -> int {
+  if (argc != 2) {
+    return 1;
+  }
+  std::ofstream out(argv[1]);
+
+  auto tape = record_kernel();
+  ad::write_header(out, tape, "test_kernel");
+
+  tape.optimize();
+  ad::generate(out, tape, "test_kernel_optimized");
+
+  return out ? 0 : 1;
+}
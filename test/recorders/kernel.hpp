@@ -0,0 +1,24 @@
+#ifndef __TEST_KERNEL_H__
+#define __TEST_KERNEL_H__
+
+#include "../../include/reverseops.hpp"
+#include "../../include/rsymbol.hpp"
+#include "../../include/tape.hpp"
+
+#include <vector>
+
+// Exercises every instruction kind of a tape, before and after optimization.
+template <typename P = ad::Precision<double>>
+inline auto record_kernel() -> ad::Tape<double, P> {
+  const std::vector<ad::RSym<double>> x{0.5, 1.5, 0.25};
+  const ad::RSym<double> one{1.0};
+  const ad::RSym<double> two{2.0};
+
+  auto y = sin(x[0]) * x[1] + pow(x[0], x[1]) + exp(cos(x[2] * one)) -
+           ln(x[1]) + x[0] * x[0] + pow(x[2], 2.0) * (two * two) +
+           tan(x[1]) / x[2] + ad::norm2(x) + ad::mean(x) + ad::dot(x, x);
+
+  return ad::Tape<double, P>::record(y, x);
+}
+
+#endif // __TEST_KERNEL_H__